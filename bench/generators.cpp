@@ -0,0 +1,70 @@
+#include "generators.hpp"
+#include <random>
+
+/* Generates randomly placed and oriented small triangles. */
+void RandomTriangles(size_t count, uint32_t seed, std::vector<Vector>* vertices)
+{
+    std::mt19937 prng(seed);
+    std::uniform_real_distribution<float> position(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+
+    /* Keep the triangles roughly as large as if they tiled a surface through the cube. */
+    float size = 2.0f / sqrtf((float)count + 1.0f);
+    for (size_t t = 0; t < count; ++t)
+    {
+        Vector center = Vector(position(prng), position(prng), position(prng));
+        for (int v = 0; v < 3; ++v)
+            vertices->push_back(center + Vector(offset(prng), offset(prng), offset(prng)) * size);
+    }
+}
+
+/* Generates a regular cubic grid of spheres. */
+void SphereGrid(size_t side, std::vector<Vector>* spheres)
+{
+    /* The spheres are spaced evenly, with a small gap between them. */
+    float spacing = 2.0f / side;
+    for (size_t z = 0; z < side; ++z)
+        for (size_t y = 0; y < side; ++y)
+            for (size_t x = 0; x < side; ++x)
+                spheres->push_back(Vector(-1.0f + spacing * (x + 0.5f), -1.0f + spacing * (y + 0.5f),
+                                          -1.0f + spacing * (z + 0.5f), spacing * 0.4f));
+}
+
+/* Recursively subdivides a spherical triangle into four. */
+static void Subdivide(Vector a, Vector b, Vector c, int depth, std::vector<Vector>* vertices)
+{
+    if (depth == 0)
+    {
+        vertices->push_back(a);
+        vertices->push_back(b);
+        vertices->push_back(c);
+        return;
+    }
+
+    /* Split each edge at its midpoint, projected back onto the sphere. */
+    Vector ab = normalize(a + b), bc = normalize(b + c), ca = normalize(c + a);
+    Subdivide(a, ab, ca, depth - 1, vertices);
+    Subdivide(ab, b, bc, depth - 1, vertices);
+    Subdivide(ca, bc, c, depth - 1, vertices);
+    Subdivide(ab, bc, ca, depth - 1, vertices);
+}
+
+/* Generates a unit icosphere mesh, i.e. a subdivided icosahedron. */
+void Icosphere(int subdivisions, std::vector<Vector>* vertices)
+{
+    /* The twelve vertices of the icosahedron. */
+    const float g = (1.0f + sqrtf(5.0f)) * 0.5f;
+    const Vector v[12] = {
+        normalize(Vector(-1,  g,  0)), normalize(Vector( 1,  g,  0)), normalize(Vector(-1, -g,  0)),
+        normalize(Vector( 1, -g,  0)), normalize(Vector( 0, -1,  g)), normalize(Vector( 0,  1,  g)),
+        normalize(Vector( 0, -1, -g)), normalize(Vector( 0,  1, -g)), normalize(Vector( g,  0, -1)),
+        normalize(Vector( g,  0,  1)), normalize(Vector(-g,  0, -1)), normalize(Vector(-g,  0,  1))};
+
+    /* And its twenty faces. */
+    const int f[20][3] = {
+        {0, 11, 5}, {0, 5, 1}, {0, 1, 7}, {0, 7, 10}, {0, 10, 11}, {1, 5, 9}, {5, 11, 4}, {11, 10, 2},
+        {10, 7, 6}, {7, 1, 8}, {3, 9, 4}, {3, 4, 2}, {3, 2, 6}, {3, 6, 8}, {3, 8, 9}, {4, 9, 5},
+        {2, 4, 11}, {6, 2, 10}, {8, 6, 7}, {9, 8, 1}};
+
+    for (int t = 0; t < 20; ++t) Subdivide(v[f[t][0]], v[f[t][1]], v[f[t][2]], subdivisions, vertices);
+}
@@ -0,0 +1,34 @@
+/**
+ * @file generators.hpp
+ *
+ * \brief Procedural benchmark geometry
+ *
+ * These generate deterministic synthetic geometry of configurable size for the benchmarks, so that performance
+ * can be measured without large scene files. Triangles are returned as consecutive triples of vertices, and
+ * spheres as their center with the radius in the fourth component. All of it fits in the [-1, 1] cube.
+ */
+
+#ifndef GENERATORS_H
+#define GENERATORS_H
+
+#include <util/vec3.hpp>
+#include <stdint.h>
+#include <vector>
+
+/*! Generates randomly placed and oriented small triangles.
+ \param count The number of triangles.
+ \param seed The random seed.
+ \param vertices This receives three vertices per triangle. */
+void RandomTriangles(size_t count, uint32_t seed, std::vector<Vector>* vertices);
+
+/*! Generates a regular cubic grid of spheres.
+ \param side The number of spheres along each axis.
+ \param spheres This receives the spheres, as center and radius. */
+void SphereGrid(size_t side, std::vector<Vector>* spheres);
+
+/*! Generates a unit icosphere mesh, i.e. a subdivided icosahedron.
+ \param subdivisions The number of subdivisions, each of which multiplies the triangle count by four.
+ \param vertices This receives three vertices per triangle. */
+void Icosphere(int subdivisions, std::vector<Vector>* vertices);
+
+#endif
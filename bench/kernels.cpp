@@ -0,0 +1,294 @@
+/* This is a standalone microbenchmark of the ray tracing kernels (ray-box, ray-triangle and ray-sphere tests, vector
+ * normalization and rotation, and BVH traversal), on procedurally generated scenes and deterministic ray sets. */
+
+#include <primitives/sphere.hpp>
+#include <primitives/triangle.hpp>
+#include <scenegraph/bvh.hpp>
+#include "generators.hpp"
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <chrono>
+#include <random>
+
+using namespace std;
+
+/* These are the benchmark options, which can be changed from the command line. */
+struct BenchmarkOptions
+{
+    /* The number of random triangles. */
+    size_t triangles;
+    /* The number of spheres along each axis of the sphere grid. */
+    size_t sphereSide;
+    /* The number of subdivisions of the icosphere mesh. */
+    int subdivisions;
+    /* The number of rays in each ray set (rounded down to a square). */
+    size_t rays;
+    /* The number of times each kernel is timed, of which the fastest is kept. */
+    int repeat;
+};
+
+/* This is a set of primitives, with a bounding volume hierarchy over them. */
+struct BenchmarkScene
+{
+    string name;
+    vector<Primitive*> primitives;
+    BVH* bvh;
+};
+
+/* This keeps the results of the kernels alive, so the compiler can't optimize them away. */
+static volatile float sink;
+
+/* Times a kernel over some number of operations, returning the fastest time per operation in nanoseconds. */
+template <typename Kernel>
+double Measure(size_t operations, int repeat, Kernel kernel)
+{
+    double best = 1e30;
+    for (int r = 0; r < repeat; ++r)
+    {
+        chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+        sink = kernel();
+        chrono::duration<double> elapsed = chrono::high_resolution_clock::now() - start;
+        best = min(best, elapsed.count());
+    }
+
+    return best * 1e9 / operations;
+}
+
+/* Prints a line of results. */
+void Report(const char* kernel, const string& scene, const char* rays, double nanoseconds)
+{
+    printf("    | %-10s %-22s %-11s %10.2f %10.2f\n", kernel, scene.c_str(), rays, nanoseconds,
+           1e3 / nanoseconds);
+}
+
+/* Generates coherent camera rays, from a pinhole camera looking at the scene from outside of it. */
+vector<Ray> CoherentRays(size_t count)
+{
+    vector<Ray> rays;
+    int side = (int)sqrtf((float)count);
+    float fov = tanf(0.4f);
+    for (int y = 0; y < side; ++y)
+        for (int x = 0; x < side; ++x)
+        {
+            float u = (2.0f * (x + 0.5f) / side - 1.0f) * fov;
+            float v = (2.0f * (y + 0.5f) / side - 1.0f) * fov;
+            rays.push_back(Ray(Vector(0.0f, 0.0f, -3.0f), normalize(Vector(u, v, 1.0f))));
+        }
+
+    return rays;
+}
+
+/* Generates incoherent rays, as diffuse bounces off wherever the camera rays hit the scene. Camera rays which miss
+ * are replaced by rays with random origins inside the scene, in uniformly random directions. */
+vector<Ray> IncoherentRays(const BenchmarkScene& scene, const vector<Ray>& cameraRays, uint32_t seed)
+{
+    vector<Ray> rays;
+    mt19937 prng(seed);
+    uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    for (size_t t = 0; t < cameraRays.size(); ++t)
+    {
+        Intersection intersection;
+        float u1 = uniform(prng), u2 = uniform(prng);
+        if (scene.bvh->getIntersection(cameraRays[t], &intersection, false))
+        {
+            /* Bounce off the surface, as the diffuse material would. */
+            Vector point = cameraRays[t].o + cameraRays[t].d * intersection.t;
+            Vector normal = intersection.primitive->Normal(point);
+            if (cameraRays[t].d * normal > 0.0f) normal = ZERO - normal;
+
+            float r = sqrtf(u1), theta = 2.0f * PI * u2;
+            Vector direction = rotate(Vector(r * cosf(theta), sqrtf(1.0f - u1), r * sinf(theta)), normal);
+            rays.push_back(Ray(point + normal * EPSILON, normalize(direction)));
+        }
+        else
+        {
+            Vector origin = Vector(uniform(prng), uniform(prng), uniform(prng)) * 2.0f - Vector(1, 1, 1);
+            rays.push_back(Ray(origin, spherical(2.0f * PI * u1, acosf(1.0f - 2.0f * u2))));
+        }
+    }
+
+    return rays;
+}
+
+/* Builds a scene out of a triangle vertex list. */
+BenchmarkScene TriangleScene(string name, const vector<Vector>& vertices)
+{
+    BenchmarkScene scene;
+    scene.name = name;
+    for (size_t t = 0; t + 2 < vertices.size(); t += 3)
+        scene.primitives.push_back(new Triangle(vertices[t], vertices[t + 1], vertices[t + 2], nullptr, nullptr));
+
+    scene.bvh = new BVH(&scene.primitives, 2);
+    return scene;
+}
+
+/* Builds a scene out of a sphere list. */
+BenchmarkScene SphereScene(string name, const vector<Vector>& spheres)
+{
+    BenchmarkScene scene;
+    scene.name = name;
+    for (size_t t = 0; t < spheres.size(); ++t)
+        scene.primitives.push_back(new Sphere(Vector(spheres[t].x, spheres[t].y, spheres[t].z), spheres[t].w,
+                                              nullptr, nullptr));
+
+    scene.bvh = new BVH(&scene.primitives, 2);
+    return scene;
+}
+
+/* Times a primitive's intersection test, cycling through the scene's primitives. */
+void BenchmarkPrimitives(const char* kernel, const BenchmarkScene& scene, const vector<Ray>& rays,
+                         const char* raySet, int repeat)
+{
+    Report(kernel, scene.name, raySet, Measure(rays.size(), repeat, [&]() {
+        float sum = 0.0f;
+        for (size_t t = 0; t < rays.size(); ++t)
+            sum += scene.primitives[t % scene.primitives.size()]->Intersect(rays[t]);
+        return sum;
+    }));
+}
+
+/* Times the ray-box test, cycling through the bounding boxes of the scene's primitives. */
+void BenchmarkBoxes(const BenchmarkScene& scene, const vector<Ray>& rays, const char* raySet, int repeat)
+{
+    vector<AABB> boxes;
+    for (size_t t = 0; t < scene.primitives.size(); ++t) boxes.push_back(scene.primitives[t]->BoundingBox());
+
+    Report("aabb", scene.name, raySet, Measure(rays.size(), repeat, [&]() {
+        float sum = 0.0f, tnear, tfar;
+        for (size_t t = 0; t < rays.size(); ++t)
+            if (boxes[t % boxes.size()].intersect(rays[t], &tnear, &tfar)) sum += tnear;
+        return sum;
+    }));
+}
+
+/* Times the closest-hit BVH traversal. */
+void BenchmarkTraversal(const BenchmarkScene& scene, const vector<Ray>& rays, const char* raySet, int repeat)
+{
+    Report("bvh", scene.name, raySet, Measure(rays.size(), repeat, [&]() {
+        float sum = 0.0f;
+        Intersection intersection;
+        for (size_t t = 0; t < rays.size(); ++t)
+            if (scene.bvh->getIntersection(rays[t], &intersection, false)) sum += intersection.t;
+        return sum;
+    }));
+}
+
+/* Parses a whole number no smaller than the given minimum, returning whether it was valid. */
+static bool ParseCount(const char* text, long minimum, long* value)
+{
+    char* end;
+    errno = 0;
+    *value = strtol(text, &end, 10);
+    return (end != text) && (*end == '\0') && (errno == 0) && (*value >= minimum) && (*value <= 0x7FFFFFFF);
+}
+
+/* Parses the command line options. */
+bool ParseOptions(int argc, char* argv[], BenchmarkOptions* options)
+{
+    for (int t = 1; t < argc; ++t)
+    {
+        /* Every option takes a value. */
+        if (t + 1 >= argc)
+        {
+            cout << "[!] Missing value for option <" << argv[t] << ">." << endl;
+            return false;
+        }
+
+        /* Every value is a count of at least one, except that the icosphere may not be subdivided at all. */
+        long minimum = strcmp(argv[t], "--subdivisions") ? 1 : 0, value;
+        bool valid = ParseCount(argv[t + 1], minimum, &value);
+
+        if (!strcmp(argv[t], "--triangles")) options->triangles = value; else
+        if (!strcmp(argv[t], "--spheres")) options->sphereSide = value; else
+        if (!strcmp(argv[t], "--subdivisions")) options->subdivisions = value; else
+        if (!strcmp(argv[t], "--rays")) options->rays = value; else
+        if (!strcmp(argv[t], "--repeat")) options->repeat = value; else
+        {
+            cout << "[!] Unknown option <" << argv[t] << ">." << endl;
+            cout << "    | Options are --triangles, --spheres (per axis), --subdivisions, --rays and --repeat."
+                 << endl;
+            return false;
+        }
+
+        if (!valid)
+        {
+            cout << "[!] Invalid value <" << argv[t + 1] << "> for option <" << argv[t] << ">, expected a whole "
+                 << "number of at least " << minimum << "." << endl;
+            return false;
+        }
+
+        ++t;
+    }
+
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    /* These defaults take a few seconds in total. */
+    BenchmarkOptions options = {100000, 24, 6, 512 * 512, 5};
+    if (!ParseOptions(argc, argv, &options)) return 1;
+
+    /* Generate the scenes. */
+    cout << "[+] Generating scenes..." << flush;
+    vector<Vector> triangles, spheres, icosphere;
+    RandomTriangles(options.triangles, 0x530FD819, &triangles);
+    SphereGrid(options.sphereSide, &spheres);
+    Icosphere(options.subdivisions, &icosphere);
+
+    BenchmarkScene scenes[3] = {
+        TriangleScene("triangles/" + to_string(options.triangles), triangles),
+        SphereScene("spheres/" + to_string(spheres.size()), spheres),
+        TriangleScene("icosphere/" + to_string(icosphere.size() / 3), icosphere)};
+    cout << " done!" << endl;
+
+    /* Generate the ray sets, the incoherent rays bouncing off the random triangles. */
+    cout << "[+] Generating ray sets..." << flush;
+    vector<Ray> coherent = CoherentRays(options.rays);
+    vector<Ray> incoherent = IncoherentRays(scenes[0], coherent, 0x5EED);
+    cout << " " << coherent.size() << " rays each." << endl << endl;
+
+    printf("[+] Results (fastest of %d runs):\n", options.repeat);
+    printf("    | %-10s %-22s %-11s %10s %10s\n", "Kernel", "Scene", "Rays", "ns/ray", "Mrays/s");
+
+    /* The vector kernels, per operation. */
+    Report("normalize", "-", "coherent", Measure(coherent.size(), options.repeat, [&]() {
+        Vector sum = ZERO;
+        for (size_t t = 0; t < coherent.size(); ++t) sum += normalize(coherent[t].d * 3.0f);
+        return sum.x;
+    }));
+
+    Report("rotate", "-", "incoherent", Measure(incoherent.size(), options.repeat, [&]() {
+        Vector sum = ZERO;
+        for (size_t t = 0; t < incoherent.size(); ++t)
+            sum += rotate(coherent[t].d, incoherent[t].d);
+        return sum.x;
+    }));
+
+    /* The intersection kernels, on their own. */
+    BenchmarkBoxes(scenes[0], coherent, "coherent", options.repeat);
+    BenchmarkBoxes(scenes[0], incoherent, "incoherent", options.repeat);
+    BenchmarkPrimitives("triangle", scenes[0], coherent, "coherent", options.repeat);
+    BenchmarkPrimitives("triangle", scenes[0], incoherent, "incoherent", options.repeat);
+    BenchmarkPrimitives("sphere", scenes[1], coherent, "coherent", options.repeat);
+    BenchmarkPrimitives("sphere", scenes[1], incoherent, "incoherent", options.repeat);
+
+    /* And the full traversal, on every scene. */
+    for (int s = 0; s < 3; ++s)
+    {
+        BenchmarkTraversal(scenes[s], coherent, "coherent", options.repeat);
+        BenchmarkTraversal(scenes[s], incoherent, "incoherent", options.repeat);
+    }
+
+    /* Free everything. */
+    for (int s = 0; s < 3; ++s)
+    {
+        for (size_t t = 0; t < scenes[s].primitives.size(); ++t) delete scenes[s].primitives[t];
+        delete scenes[s].bvh;
+    }
+
+    return 0;
+}
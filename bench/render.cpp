@@ -0,0 +1,363 @@
+/* This is an end-to-end render benchmark. It renders the sample scenes and a few generated heavy scenes at a fixed
+ * number of samples and seed, records the time spent in each phase, and compares the linear renders against stored
+ * references, so that speedups can be measured without silently changing the image. The results go to a CSV file
+ * which can be compared across commits. */
+
+#include <renderer/renderer.hpp>
+#include <util/imageio.hpp>
+#include "generators.hpp"
+#include <iostream>
+#include <cstring>
+#include <cstdio>
+#include <omp.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#define MakeDirectory(path) _mkdir(path)
+#else
+#include <sys/stat.h>
+#define MakeDirectory(path) mkdir(path, 0755)
+#endif
+
+using namespace std;
+
+/* These are the scene file entity types (they must match the renderer's scene file format). */
+enum EntityType { COLORSYSTEM = 0, CAMERA = 1, DISTRIBUTION = 2, MATERIAL = 3, LIGHT = 4, PRIMITIVE = 5 };
+
+/* These are the ways a render can be compared to its reference. */
+enum ImageMetric { METRIC_RMSE = 0, METRIC_MRE = 1 };
+
+/* These are the benchmark options, which can be changed from the command line. */
+struct BenchmarkOptions
+{
+    /* The number of threads (zero for all of them). */
+    size_t threads;
+    /* The render settings (the samples per pixel and the seed are fixed). */
+    RenderSettings settings;
+    /* The directory containing the sample scenes. */
+    string scenes;
+    /* The directory containing the reference renders. */
+    string references;
+    /* The directory to write the generated scenes and the renders to. */
+    string output;
+    /* The CSV file to write the results to. */
+    string csv;
+    /* The metric to compare renders with, and the largest error for which they are considered equivalent. */
+    ImageMetric metric;
+    double threshold;
+    /* Whether to replace the reference renders by the new ones. */
+    bool update;
+    /* The width and height of the generated scenes. */
+    int32_t size;
+};
+
+/* This is one scene of the benchmark. */
+struct BenchmarkScene
+{
+    /* The name of the scene, which names its render and reference. */
+    string name;
+    /* The scene file, if it already exists, otherwise it is generated. */
+    string file;
+    /* The generated triangles and spheres (as center and radius), if any. */
+    vector<Vector> triangles, spheres;
+};
+
+/* Writes a value to a scene file. */
+template <typename T>
+void Write(FILE* file, const T& value)
+{
+    fwrite(&value, sizeof(T), 1, file);
+}
+
+/* Writes an entity header to a scene file. */
+void WriteHeader(FILE* file, EntityType type, uint32_t subtype)
+{
+    Write(file, (uint32_t)type);
+    Write(file, subtype);
+}
+
+/* Writes a primitive header to a scene file. */
+void WritePrimitive(FILE* file, uint32_t subtype, int32_t material, int32_t light)
+{
+    WriteHeader(file, PRIMITIVE, subtype);
+    Write(file, material);
+    Write(file, light);
+}
+
+/* Writes a sphere to a scene file. */
+void WriteSphere(FILE* file, Vector center, float radius, int32_t material, int32_t light)
+{
+    WritePrimitive(file, ID_SPHERE, material, light);
+    float definition[4] = {center.x, center.y, center.z, radius};
+    fwrite(definition, sizeof(float), 4, file);
+}
+
+/* Writes a generated scene file. The generated geometry, which fits in the [-1, 1] cube, is made of a white diffuse
+ * material and stands on a diffuse floor, lit by a large spherical light overhead. */
+bool WriteGeneratedScene(const BenchmarkScene& scene, string path, int32_t size, int32_t samples)
+{
+    /* Create the scene file. */
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == 0) return false;
+
+    /* The render parameters. */
+    RenderParams params = {size, size, samples};
+    Write(file, params);
+
+    /* The color system, and a camera looking at the geometry from slightly above. */
+    WriteHeader(file, COLORSYSTEM, ID_HDTV);
+    WriteHeader(file, CAMERA, ID_PERSPECTIVE);
+    float camera[7] = {0.0f, 0.8f, -3.2f, 0.0f, 0.0f, 0.0f, 0.9f};
+    fwrite(camera, sizeof(float), 7, file);
+
+    /* The reflectance and emittance distributions. */
+    WriteHeader(file, DISTRIBUTION, ID_FLAT);
+    Write(file, 0.75f);
+    WriteHeader(file, DISTRIBUTION, ID_FLAT);
+    Write(file, 10.0f);
+
+    /* A diffuse material, with no extinction. */
+    WriteHeader(file, MATERIAL, ID_DIFFUSE);
+    float extinction[2] = {0.0f, 0.0f};
+    fwrite(extinction, sizeof(float), 2, file);
+    Write(file, (uint32_t)0);
+
+    /* An omni light. */
+    WriteHeader(file, LIGHT, ID_OMNI);
+    Write(file, (uint32_t)1);
+
+    /* The light source overhead, and the floor (a very large sphere). */
+    WriteSphere(file, Vector(0.0f, 8.0f, -2.0f), 4.0f, -1, 0);
+    WriteSphere(file, Vector(0.0f, -1001.0f, 0.0f), 1000.0f, 0, -1);
+
+    /* And the generated geometry. */
+    for (size_t t = 0; t < scene.spheres.size(); ++t)
+        WriteSphere(file, scene.spheres[t], scene.spheres[t].w, 0, -1);
+
+    for (size_t t = 0; t + 2 < scene.triangles.size(); t += 3)
+    {
+        WritePrimitive(file, ID_TRIANGLE, 0, -1);
+        for (int v = 0; v < 3; ++v)
+        {
+            float vertex[3] = {scene.triangles[t + v].x, scene.triangles[t + v].y, scene.triangles[t + v].z};
+            fwrite(vertex, sizeof(float), 3, file);
+        }
+    }
+
+    /* Close the file. */
+    bool success = !ferror(file);
+    fclose(file);
+    return success;
+}
+
+/* Compares a render to its reference, computing the relative root mean square error (the RMS of the difference over
+ * the RMS of the reference) and the mean relative error (the average of each component's absolute difference over
+ * its reference value, the latter being clamped to 1% of the average so that dark pixels don't dominate). */
+bool CompareRenders(const vector<Vector>& render, const vector<Vector>& reference, double* rmse, double* mre)
+{
+    if (render.size() != reference.size()) return false;
+
+    /* Find the average reference component first. */
+    double average = 0.0;
+    for (size_t t = 0; t < reference.size(); ++t)
+        average += fabs(reference[t].x) + fabs(reference[t].y) + fabs(reference[t].z);
+    average /= reference.size() * 3;
+
+    double squaredError = 0.0, squaredReference = 0.0, relativeError = 0.0;
+    for (size_t t = 0; t < reference.size(); ++t)
+    {
+        const float a[3] = {render[t].x, render[t].y, render[t].z};
+        const float b[3] = {reference[t].x, reference[t].y, reference[t].z};
+        for (int c = 0; c < 3; ++c)
+        {
+            double error = (double)a[c] - (double)b[c];
+            squaredError += error * error;
+            squaredReference += (double)b[c] * b[c];
+            relativeError += fabs(error) / max(fabs((double)b[c]), 0.01 * average);
+        }
+    }
+
+    *rmse = (squaredReference > 0.0) ? sqrt(squaredError / squaredReference) : sqrt(squaredError);
+    *mre = relativeError / (reference.size() * 3);
+    return true;
+}
+
+/* Parses the command line options. */
+bool ParseOptions(int argc, char* argv[], BenchmarkOptions* options)
+{
+    if (argc < 2)
+    {
+        cout << "[!] Usage: LambdaRenderBench <threads> [options]" << endl;
+        cout << "    | Options are --samples, --seed, --resolution, --size, --scenes, --references, --output, --csv,"
+             << endl << "    | --metric (rmse or mre), --threshold, --hugepages (on or off) and --update (which takes no"
+             << endl << "    | value)." << endl;
+        return false;
+    }
+
+    options->threads = atoi(argv[1]);
+    for (int t = 2; t < argc; ++t)
+    {
+        /* This is the only option without a value. */
+        if (!strcmp(argv[t], "--update"))
+        {
+            options->update = true;
+            continue;
+        }
+
+        /* Every other option takes a value. */
+        if (t + 1 >= argc)
+        {
+            cout << "[!] Missing value for option <" << argv[t] << ">." << endl;
+            return false;
+        }
+
+        if (!strcmp(argv[t], "--samples")) options->settings.samples = atoi(argv[++t]); else
+        if (!strcmp(argv[t], "--seed")) options->settings.seed = strtoul(argv[++t], nullptr, 0); else
+        if (!strcmp(argv[t], "--resolution")) options->settings.resolution = atoi(argv[++t]); else
+        if (!strcmp(argv[t], "--size")) options->size = atoi(argv[++t]); else
+        if (!strcmp(argv[t], "--scenes")) options->scenes = argv[++t]; else
+        if (!strcmp(argv[t], "--references")) options->references = argv[++t]; else
+        if (!strcmp(argv[t], "--output")) options->output = argv[++t]; else
+        if (!strcmp(argv[t], "--csv")) options->csv = argv[++t]; else
+        if (!strcmp(argv[t], "--threshold")) options->threshold = atof(argv[++t]); else
+        if (!strcmp(argv[t], "--hugepages")) options->settings.hugePages = !strcmp(argv[++t], "on"); else
+        if (!strcmp(argv[t], "--metric"))
+        {
+            ++t;
+            if (!strcmp(argv[t], "rmse")) options->metric = METRIC_RMSE; else
+            if (!strcmp(argv[t], "mre")) options->metric = METRIC_MRE; else
+            {
+                cout << "[!] Unknown metric <" << argv[t] << ">, expected rmse or mre." << endl;
+                return false;
+            }
+        }
+        else
+        {
+            cout << "[!] Unknown option <" << argv[t] << ">." << endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    /* The defaults render every scene in a few minutes on a desktop machine. */
+    BenchmarkOptions options;
+    options.settings.samples = 16;
+    options.scenes = "scenes/";
+    options.references = "bench/references/";
+    options.output = "bench/output/";
+    options.csv = "bench/output/benchmark.csv";
+    options.metric = METRIC_RMSE;
+    options.threshold = 1e-3;
+    options.update = false;
+    options.size = 192;
+    if (!ParseOptions(argc, argv, &options)) return 1;
+
+    /* The sample scenes, and the generated ones. */
+    vector<BenchmarkScene> scenes(5);
+    scenes[0].name = "cornellbox";
+    scenes[0].file = options.scenes + "cornellbox";
+    scenes[1].name = "spheres";
+    scenes[1].file = options.scenes + "spheres";
+    scenes[2].name = "icosphere";
+    Icosphere(6, &scenes[2].triangles);
+    scenes[3].name = "triangles";
+    RandomTriangles(200000, 0x530FD819, &scenes[3].triangles);
+    scenes[4].name = "spheregrid";
+    SphereGrid(24, &scenes[4].spheres);
+
+    /* Create the output directories, if they don't exist yet. */
+    MakeDirectory(options.output.c_str());
+    if (options.update) MakeDirectory(options.references.c_str());
+
+    /* Create the results file. */
+    FILE* csv = fopen(options.csv.c_str(), "w");
+    if (csv == 0)
+    {
+        cout << "[!] Failed to create <" << options.csv << ">." << endl;
+        return 1;
+    }
+
+    fprintf(csv, "scene,width,height,samples,resolution,threads,seed,wall,load,bvh,trace,tonemap,write,"
+                 "paths_per_second,rays_per_second,rmse,mre,status\n");
+
+    int failures = 0, skipped = 0;
+    for (size_t s = 0; s < scenes.size(); ++s)
+    {
+        BenchmarkScene& scene = scenes[s];
+
+        /* Generate the scene file, if needed. */
+        if (scene.file.empty())
+        {
+            scene.file = options.output + scene.name + ".scene";
+            if (!WriteGeneratedScene(scene, scene.file, options.size, options.settings.samples))
+            {
+                cout << "[!] Failed to generate <" << scene.file << ">, skipping." << endl;
+                continue;
+            }
+        }
+
+        /* Make sure the scene file exists, as the renderer does not check. */
+        FILE* file = fopen(scene.file.c_str(), "rb");
+        if (file == 0)
+        {
+            cout << "[!] Scene file <" << scene.file << "> not found, skipping." << endl;
+            continue;
+        }
+        fclose(file);
+
+        /* Load and render the scene, timing the whole thing. */
+        RenderSettings settings = options.settings;
+        settings.linear = options.output + scene.name + ".pfm";
+        double wallTime = omp_get_wtime();
+        Renderer* renderer = new Renderer(scene.file, settings.hugePages);
+        renderer->Render(options.output + scene.name + ".ppm", options.threads, settings);
+        wallTime = omp_get_wtime() - wallTime;
+        StatisticsReport report = renderer->Report();
+        delete renderer;
+
+        /* Compare the linear render to the reference. */
+        string status, reference = options.references + scene.name + ".pfm";
+        vector<Vector> renderPixels, referencePixels;
+        int32_t width, height, referenceWidth, referenceHeight;
+        double rmse = -1.0, mre = -1.0;
+        if (!LoadPFM(settings.linear, &renderPixels, &width, &height)) status = "no render"; else
+        if (options.update)
+            status = SavePFM(reference, &renderPixels[0], width, height) ? "updated" : "update failed";
+        else if (!LoadPFM(reference, &referencePixels, &referenceWidth, &referenceHeight)) status = "no reference";
+        else if ((width != referenceWidth) || (height != referenceHeight)
+              || !CompareRenders(renderPixels, referencePixels, &rmse, &mre)) status = "size mismatch";
+        else status = (((options.metric == METRIC_RMSE) ? rmse : mre) <= options.threshold) ? "pass" : "fail";
+
+        /* Scenes without a reference (like the generated ones, until references are stored for them) are skipped. */
+        if (status == "no reference") ++skipped;
+        else if ((status != "pass") && (status != "updated")) ++failures;
+
+        /* The number of light paths is known, but rays are only counted with statistics compiled in. */
+        double paths = (double)report.width * report.height * report.samples * report.wavelengths;
+        double rays = StatisticsEnabled() ? report.counters.rays / report.seconds : 0.0;
+
+        fprintf(csv, "%s,%d,%d,%d,%d,%u,%u,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.0f,%.0f,%.6g,%.6g,%s\n",
+                scene.name.c_str(), report.width, report.height, report.samples, report.resolution,
+                (unsigned)report.threads, (unsigned)settings.seed, wallTime, report.loadSeconds, report.buildSeconds,
+                report.seconds, report.tonemapSeconds, report.writeSeconds, paths / report.seconds, rays, rmse, mre,
+                status.c_str());
+        fflush(csv);
+
+        cout << endl << "[+] Benchmark <" << scene.name << ">: " << status;
+        if (status == "no reference") cout << " (not compared, run with --update to store one)";
+        if (rmse >= 0.0) printf(" (RMSE %.3g, MRE %.3g)", rmse, mre);
+        printf(", %.2fs wall time.\n\n", wallTime);
+    }
+
+    /* Close the results file. */
+    fclose(csv);
+    cout << "[+] Results saved in <" << options.csv << ">";
+    if (failures > 0) cout << ", " << failures << " scene(s) did not match their reference";
+    if (skipped > 0) cout << ", " << skipped << " scene(s) had no reference to compare to";
+    cout << "." << endl;
+    return (failures > 0) ? 1 : 0;
+}
@@ -8,6 +8,24 @@
 #include <util/vec3.hpp>
 #include <iostream>
 #include <fstream>
+#include <string>
+#include <vector>
+
+/* This overrides some of a camera's parameters for a render, the others being left as in the scene file. */
+struct CameraOverride
+{
+    /* Which parameters are overridden. */
+    bool hasPosition, hasTarget, hasFieldOfView;
+    /* The camera position and target, and field of view (in radians). */
+    Vector position, target;
+    float fieldOfView;
+
+    /* Creates an empty override. */
+    CameraOverride() : hasPosition(false), hasTarget(false), hasFieldOfView(false), fieldOfView(0.0f) { }
+
+    /* Returns whether nothing is overridden. */
+    bool Empty() const { return !hasPosition && !hasTarget && !hasFieldOfView; }
+};
 
 /* This is the base class for a camera. */
 class Camera
@@ -15,9 +33,30 @@ class Camera
     public:
         /* This function returns the camera ray corresponding to the normalized screen coordinates (u, v). */
         virtual Ray Trace(float u, float v) = 0;
+
+        /* This function projects a point onto the normalized screen coordinates (u, v) of the camera ray through it,
+         * also returning the ray's origin. It returns the density of the screen coordinates per unit solid angle
+         * around the ray, or zero if the point can't be seen by the camera. */
+        virtual float Project(Vector point, float* u, float* v, Vector* origin) = 0;
+
+        /* This function returns a new camera, with some of this camera's parameters overridden. */
+        virtual Camera* Override(const CameraOverride& override) const = 0;
+
+        /* This function returns all of this camera's parameters, as an override setting every one of them. */
+        virtual CameraOverride Pose() const = 0;
+
+        virtual ~Camera() { }
 };
 
 /* This creates the correct camera type based on a scene file entity subtype. */
 Camera* GetCamera(uint32_t subtype, std::fstream& file);
 
+/* This returns the poses of a camera orbiting its target at a constant height, in a full turn over some frames. */
+std::vector<CameraOverride> OrbitPoses(const CameraOverride& pose, int frames);
+
+/* This loads camera keyframes from a text file, and interpolates the poses of the frames between them. Each line of
+ * the file is a keyframe, as its frame number, position, target and field of view in degrees (for instance
+ * "24 0,1,-3 0,1,0 45"), in increasing frame order. Returns false if the file could not be read. */
+bool LoadKeyframes(std::string path, std::vector<CameraOverride>* poses);
+
 #endif
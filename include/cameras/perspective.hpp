@@ -7,20 +7,37 @@
 class Perspective : public Camera
 {
     private:
-        /* The camera position. */
-        Vector position;
+        /* The camera position and target, and field of view. */
+        Vector position, target;
+        float fieldOfView;
 
         /* The focal plane. */
         Vector focalPlane[4];
 
+        /* The camera's orthonormal basis, and the half-size of the focal plane (at unit distance). */
+        Vector xAxis, yAxis, zAxis;
+        float scale;
+
         /* Build the focal plane. */
         void buildFocalPlane(Vector target, float fieldOfView);
     public:
         /* Creates the perspective camera from a scene file. */
         Perspective(std::fstream& file);
 
+        /* Creates the perspective camera from its position and target, and field of view (in radians). */
+        Perspective(Vector position, Vector target, float fieldOfView);
+
         /* This will trace the camera ray. */
         virtual Ray Trace(float u, float v);
+
+        /* This will project a point onto the screen. */
+        virtual float Project(Vector point, float* u, float* v, Vector* origin);
+
+        /* This returns a perspective camera with some of this camera's parameters overridden. */
+        virtual Camera* Override(const CameraOverride& override) const;
+
+        /* This returns the camera's position, target and field of view. */
+        virtual CameraOverride Pose() const;
 };
 
 #endif // PERSPECTIVECG_H
@@ -16,8 +16,8 @@ class Light
         virtual double Emittance(Vector incident, Vector normal, double wavelength) = 0;
 };
 
-/* This creates the correct light type based on a scene file entity subtype. */
-Light* GetLight(uint32_t subtype, std::fstream& file, std::vector<Distribution*>* distributions);
+/* This creates the correct light type based on a scene file entity subtype, in an arena. */
+Light* GetLight(uint32_t subtype, std::fstream& file, std::vector<Distribution*>* distributions, Arena* arena);
 
 #endif // LIGHT_H
 
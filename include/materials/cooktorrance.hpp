@@ -17,10 +17,22 @@ class CookTorrance : public Material
         CookTorrance(std::fstream& file, std::vector<Distribution*>* distributions);
 
         /* This function returns an importance-sampled exitant vector. */
-        virtual Vector Sample(Vector* origin, Vector incident, Vector normal, float wavelength, std::mt19937* prng);
+        virtual Vector Sample(Vector* origin, Vector incident, Vector normal, float wavelength, Sampler* sampler);
 
         /* This returns the reflectance for an incident and exitant vector. */
         virtual float Reflectance(Vector incident, Vector exitant, Vector normal, float wavelength, bool sampled);
+
+        /* This material can be connected through. */
+        virtual bool Connectable() { return true; }
+
+        /* This returns the scattering function for an incident and exitant vector. */
+        virtual float Evaluate(Vector incident, Vector exitant, Vector normal, float wavelength);
+
+        /* This returns the density of sampling an exitant vector. */
+        virtual float Density(Vector incident, Vector exitant, Vector normal, float wavelength);
+
+        /* This returns the albedo of the material at a wavelength. */
+        virtual float Albedo(float wavelength);
 };
 
 #endif
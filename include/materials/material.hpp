@@ -16,10 +16,10 @@
 #define ID_FROSTEDGLASS 3
 #define ID_COOKTORRANCE 4
 
-/* We need vectors, pseudorandom number generation, and spectral distributions. */
+/* We need vectors, samplers, and spectral distributions. */
 #include <spectral/distribution.hpp>
+#include <samplers/sampler.hpp>
 #include <util/vec3.hpp>
-#include <random>
 
 /*! \class Material
  * This is the base class from which all materials are derived. */
@@ -41,10 +41,11 @@ class Material
           \param incident The incident vector.
           \param normal The surface normal.
           \param wavelength The ray's wavelength.
+          \param sampler The sampler to draw random numbers from (at most three, starting at the bounce's dimension).
           \return Returns an importance-sampled exitant vector.
           \remark The origin will be slightly displaced by this method to prevent self-intersection due to
           floating-point inaccuracies. This is important to prevent geometry intersection artifacts. */
-        virtual Vector Sample(Vector* origin, Vector incident, Vector normal, float wavelength, std::mt19937* prng) = 0;
+        virtual Vector Sample(Vector* origin, Vector incident, Vector normal, float wavelength, Sampler* sampler) = 0;
 
         /*! This method evaluates the material's reflectance function for an incident and exitant vector. This method
          * is wavelength-dependent.
@@ -57,9 +58,40 @@ class Material
           \remark This function must always return values in the interval [0, 1). Note 1 is exclusive, to ensure
           the light path always terminates eventually (and no surface reflects exactly 100% of incoming radiance). */
         virtual float Reflectance(Vector incident, Vector exitant, Vector normal, float wavelength, bool sampled) = 0;
+
+        /*! This method returns whether the material's scattering function can be evaluated for any pair of
+         * directions, which bidirectional path tracing needs to connect light paths through it. Specular and glass
+         * materials are not connectable, so light paths only go through them by being sampled.
+          \return Returns true if Evaluate and Density are implemented. */
+        virtual bool Connectable() { return false; }
+
+        /*! This method evaluates the material's scattering function, per unit solid angle of exitant directions
+         * (excluding the cosine term, unlike Reflectance). This method is wavelength-dependent.
+          \param incident The incident vector.
+          \param exitant The exitant vector.
+          \param normal The surface normal.
+          \param wavelength The ray's wavelength.
+          \return Returns the scattering function, which is zero unless the material is connectable.
+          \remark This is consistent with Sample and Reflectance, so that the reflectance of an importance-sampled
+          exitant vector is the scattering function times the cosine term, divided by the density. */
+        virtual float Evaluate(Vector incident, Vector exitant, Vector normal, float wavelength) { return 0.0f; }
+
+        /*! This method returns the probability density of Sample returning an exitant vector, per unit solid angle.
+          \param incident The incident vector.
+          \param exitant The exitant vector.
+          \param normal The surface normal.
+          \param wavelength The ray's wavelength.
+          \return Returns the density, which is zero unless the material is connectable. */
+        virtual float Density(Vector incident, Vector exitant, Vector normal, float wavelength) { return 0.0f; }
+
+        /*! This method returns the fraction of light the material scatters at a wavelength, whatever the directions,
+         * which guides image-space filters (it is not used to render).
+          \param wavelength The wavelength.
+          \return Returns the albedo, which is one for materials which scatter all light (like glass). */
+        virtual float Albedo(float wavelength) { return 1.0f; }
 };
 
-/* This creates the correct material type based on a scene file entity subtype. */
-Material* GetMaterial(uint32_t subtype, std::fstream& file, std::vector<Distribution*>* distributions);
+/* This creates the correct material type based on a scene file entity subtype, in an arena. */
+Material* GetMaterial(uint32_t subtype, std::fstream& file, std::vector<Distribution*>* distributions, Arena* arena);
 
 #endif
@@ -14,7 +14,7 @@ class SmoothGlass : public Material
         SmoothGlass(std::fstream& file, std::vector<Distribution*>* distributions);
 
         /* This function returns an importance-sampled exitant vector. */
-        virtual Vector Sample(Vector* origin, Vector incident, Vector normal, float wavelength, std::mt19937* prng);
+        virtual Vector Sample(Vector* origin, Vector incident, Vector normal, float wavelength, Sampler* sampler);
 
         /* This returns the reflectance for an incident and exitant vector. */
         virtual float Reflectance(Vector incident, Vector exitant, Vector normal, float wavelength, bool sampled);
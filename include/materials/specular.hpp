@@ -14,10 +14,13 @@ class Specular : public Material
         Specular(std::fstream& file, std::vector<Distribution*>* distributions);
 
         /* This function returns an importance-sampled exitant vector. */
-        virtual Vector Sample(Vector* origin, Vector incident, Vector normal, float wavelength, std::mt19937* prng);
+        virtual Vector Sample(Vector* origin, Vector incident, Vector normal, float wavelength, Sampler* sampler);
 
         /* This returns the reflectance for an incident and exitant vector. */
         virtual float Reflectance(Vector incident, Vector exitant, Vector normal, float wavelength, bool sampled);
+
+        /* This returns the albedo of the material at a wavelength. */
+        virtual float Albedo(float wavelength);
 };
 
 #endif // DIFFUSE_H
@@ -55,6 +55,12 @@ class Primitive
         /*! Creates a primitive, from a scene file and a list of materials and lights. */
         Primitive(std::fstream& file, std::vector<Material*>* materials, std::vector<Light*>* lights);
 
+        /*! Creates a primitive with a given material and light (either of which may be null). */
+        Primitive(Material* material, Light* light) : material(material), light(light) { }
+
+        /*! Primitives are deleted through base class pointers. */
+        virtual ~Primitive() { }
+
         /*! This method returns the closest intersection of a ray with the primitive.
          \param ray The ray to test intersection with.
          \returns The closest distance along the ray where an intersection occurs. If this is a negative value, the
@@ -69,17 +75,37 @@ class Primitive
         /*! This method returns the axis-aligned bounding box of the primitive.
          \return The primitive's bounding box.
          \remark The bounding box need not be ideal, but the bounding volume hierarchy is more efficient if the
-         returned bounding box tightly fits the primitive. The same bounding box must always be returned. */
+         returned bounding box tightly fits the primitive. The same bounding box must always be returned, until the
+         primitive's vertices are moved. */
         virtual AABB BoundingBox() = 0;
 
         /*! This method returns the centroid of the primitive.
          \return The primitive's centroid.
          \remark If the centroid is not well-defined, pass the best one and the bounding volume hierarchy will do its
-         best to handle it. The same centroid must always be returned. */
+         best to handle it. The same centroid must always be returned, until the primitive's vertices are moved. */
         virtual Vector Centroid() = 0;
+
+        /*! This method returns the number of vertices which define the primitive's position and shape.
+         \return The primitive's vertex count. */
+        virtual size_t VertexCount() = 0;
+
+        /*! This method moves the primitive's vertices, updating its bounding box and centroid.
+         \param vertices The new vertices, as many as the primitive's vertex count.
+         \remark The bounding volume hierarchy must be refitted or rebuilt afterwards. */
+        virtual void SetVertices(const Vector* vertices) = 0;
+
+        /*! This method returns the surface area of the primitive.
+         \return The primitive's surface area. */
+        virtual float Area() = 0;
+
+        /*! This method selects a point on the primitive's surface, uniformly with respect to its area.
+         \param u1 A random number in [0, 1).
+         \param u2 Another random number in [0, 1).
+         \return A point on the primitive's surface. */
+        virtual Vector SamplePoint(float u1, float u2) = 0;
 };
 
-/* This creates the correct primitive type based on a scene file entity subtype. */
-Primitive* GetPrimitive(uint32_t subtype, std::fstream& file, std::vector<Material*>* materials, std::vector<Light*>* lights);
+/* This creates the correct primitive type based on a scene file entity subtype, in an arena. */
+Primitive* GetPrimitive(uint32_t subtype, std::fstream& file, std::vector<Material*>* materials, std::vector<Light*>* lights, Arena* arena);
 
 #endif
@@ -17,10 +17,16 @@ class Sphere : public Primitive
 
         /* The sphere's bounding box. */
         AABB boundingBox;
+
+        /* Sets up the sphere from its center and radius. */
+        void Initialize(Vector center, float radius);
     public:
         /* Creates the sphere from a scene file. */
         Sphere(std::fstream& file, std::vector<Material*>* materials, std::vector<Light*>* lights);
 
+        /* Creates the sphere from its center and radius. */
+        Sphere(Vector center, float radius, Material* material, Light* light);
+
         /* This function returns the closest intersection of a ray with the sphere. */
         virtual float Intersect(const Ray& ray);
 
@@ -32,6 +38,18 @@ class Sphere : public Primitive
 
         /* This function returns the centroid of the sphere. */
         virtual Vector Centroid(){ return this->center; }
+
+        /* A sphere is positioned by its center, its radius doesn't change. */
+        virtual size_t VertexCount(){ return 1; }
+
+        /* This function moves the sphere's center. */
+        virtual void SetVertices(const Vector* vertices){ Initialize(vertices[0], this->radius); }
+
+        /* This function returns the surface area of the sphere. */
+        virtual float Area(){ return 4.0f * PI * this->radiusSquared; }
+
+        /* This function returns a uniformly distributed point on the sphere. */
+        virtual Vector SamplePoint(float u1, float u2);
 };
 
 #endif // SPHERE_H
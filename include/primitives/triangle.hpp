@@ -12,12 +12,21 @@ class Triangle : public Primitive
         /* The triangle's precomputed edges, normal and centroid. */
         Vector edge1, edge2, normal, centroid;
 
+        /* The triangle's surface area. */
+        float area;
+
         /* The triangle's bounding box. */
         AABB boundingBox;
+
+        /* Sets up the triangle from its three vertices. */
+        void Initialize(Vector p1, Vector p2, Vector p3);
     public:
         /* Creates the triangle from a scene file. */
         Triangle(std::fstream& file, std::vector<Material*>* materials, std::vector<Light*>* lights);
 
+        /* Creates the triangle from its three vertices. */
+        Triangle(Vector p1, Vector p2, Vector p3, Material* material, Light* light);
+
         /* This function returns the closest intersection of a ray with the triangle. */
         virtual float Intersect(const Ray& ray);
 
@@ -29,6 +38,18 @@ class Triangle : public Primitive
 
         /* This function returns the centroid of the triangle. */
         virtual Vector Centroid(){ return this->centroid; }
+
+        /* A triangle is defined by its three vertices. */
+        virtual size_t VertexCount(){ return 3; }
+
+        /* This function moves the triangle's three vertices. */
+        virtual void SetVertices(const Vector* vertices){ Initialize(vertices[0], vertices[1], vertices[2]); }
+
+        /* This function returns the surface area of the triangle. */
+        virtual float Area(){ return this->area; }
+
+        /* This function returns a uniformly distributed point on the triangle. */
+        virtual Vector SamplePoint(float u1, float u2);
 };
 
 #endif // TRIANGLE_H
@@ -0,0 +1,58 @@
+/**
+ * @file bidirectional.hpp
+ *
+ * \brief Bidirectional path tracing
+ *
+ * These are the light subpaths traced by the bidirectional path tracer. For each pixel sample and wavelength, a camera
+ * subpath is traced from the camera and a light subpath from a point on an emissive primitive, and every vertex of
+ * one is connected to every vertex of the other (including the camera itself, in which case the connection is added
+ * to whichever pixel it projects to). Each way of building a light path out of two subpaths is weighted by multiple
+ * importance sampling according to how likely each of the other ways would have been to build it, with the balance
+ * heuristic, so that the strategy best suited to each path dominates. Light subpaths start on a light picked by power,
+ * and the direct connections from camera subpath vertices to a light may instead pick a light for each vertex with the
+ * light BVH (see lightbvh.hpp), which favors the lights near it.
+ *
+ * Materials which are not connectable (specular and glass materials) can't be connected through, so paths through
+ * them can only be built by sampling, as with the path tracer. Bidirectional path tracing mostly helps with paths
+ * which the path tracer is unlikely to find, like caustics seen on diffuse surfaces, and light through small openings.
+ */
+
+#ifndef BIDIRECTIONAL_H
+#define BIDIRECTIONAL_H
+
+#include <primitives/primitive.hpp>
+#include <util/vec3.hpp>
+#include <vector>
+
+/*! This is a vertex of a camera or light subpath. */
+struct PathVertex
+{
+    /*! The vertex's position, and the primitive's surface normal there. */
+    Vector point, normal;
+    /*! The primitive the vertex is on, which is null for the camera. */
+    Primitive* primitive;
+    /*! The throughput of the subpath up to this vertex, excluding its scattering (for the first vertex of a light
+     * subpath, this is the inverse of the density of its position, as the emittance depends on its direction). */
+    float beta;
+    /*! The density of this vertex being sampled from the previous vertex of its subpath, and from the next one, per
+     * unit area (zero when sampled through a material which is not connectable, which can't be evaluated). */
+    float pdfFwd, pdfRev;
+    /*! Whether the vertex is on a material which is not connectable. */
+    bool delta;
+};
+
+/*! These are the camera and light subpaths of a thread, kept between paths so they aren't reallocated. */
+struct BidirectionalPaths
+{
+    /*! The camera subpath, starting at the camera. */
+    std::vector<PathVertex> camera;
+    /*! The light subpath, starting on an emissive primitive. */
+    std::vector<PathVertex> light;
+    /*! The light vertex picked for the direct connection of each camera subpath vertex, when lights are picked with
+     * the light BVH (those of vertices which can't be connected have no primitive). */
+    std::vector<PathVertex> direct;
+    /*! Whether lights are picked with the light BVH for direct connections, instead of using the light subpath's. */
+    bool lightTree;
+};
+
+#endif
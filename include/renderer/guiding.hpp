@@ -0,0 +1,134 @@
+/**
+ * @file guiding.hpp
+ *
+ * \brief Path guiding
+ *
+ * This is an SD-tree, after Müller et al.'s "Practical Path Guiding", which learns where the light arriving at each
+ * part of the scene comes from, so that the path tracer can send its paths there rather than only where the materials
+ * scatter the most light. This matters in scenes lit indirectly through small openings, where cosine-weighted sampling
+ * of diffuse materials mostly finds walls which are themselves dimly lit.
+ *
+ * The scene's bounds are split into regions by a binary tree, halving along each axis in turn, and each region holds a
+ * quadtree over the square the sphere of directions is mapped to (with an equal-area cylindrical mapping). Each
+ * quadtree node holds the energy of each of its quadrants, so directions are sampled by descending from the root, and
+ * their density is found the same way.
+ *
+ * The tree is learned over passes of the render: during a pass, the path tracer records the radiance found along its
+ * paths into a second quadtree of each region, which becomes the one sampled from in the next pass. The regions
+ * which received many records are split in two, and the quadtree nodes holding a large share of the energy are split
+ * into quadrants (those holding little are merged), so the tree refines where the light is. The records are summed
+ * as fixed-point numbers, which add up to the same sums in any order, so the tree only depends on the seed, not on the
+ * number of threads.
+ */
+
+#ifndef GUIDING_H
+#define GUIDING_H
+
+#include <util/aabb.hpp>
+#include <util/vec3.hpp>
+#include <vector>
+
+/*! This is a node of a directional quadtree. The first quadrant is the lowest in both coordinates, and the second and
+ * third ones are next to it along the first and second coordinates. */
+struct QuadNode
+{
+    /*! The energy of each quadrant. */
+    float energy[4];
+    /*! The index of each quadrant's node, or zero if the quadrant is a leaf. */
+    uint32_t children[4];
+};
+
+/*! \class DirectionalTree
+ * This is the quadtree of a region, learning the directions light arrives from. */
+class DirectionalTree
+{
+    private:
+        /*! The nodes of the quadtree sampled from. */
+        std::vector<QuadNode> nodes;
+        /*! The nodes of the quadtree being recorded into (their energies are unused). */
+        std::vector<QuadNode> building;
+        /*! The fixed-point energy recorded in each quadrant of the quadtree being recorded into. */
+        std::vector<uint64_t> sums;
+        /*! The number of records made in the region during this pass. */
+        uint64_t records;
+    public:
+        /*! Creates a quadtree of a single node without energy, which is not sampled from. */
+        DirectionalTree();
+
+        /*! Samples a direction in proportion to the energy learned.
+         \param u1, u2 Two uniform numbers in [0, 1).
+         \return Returns the sampled direction. */
+        Vector Sample(float u1, float u2) const;
+
+        /*! Returns the density of sampling a direction, per unit solid angle. */
+        float Density(Vector direction) const;
+
+        /*! Returns whether any energy was learned, so that directions can be sampled. */
+        bool Trained() const;
+
+        /*! Records an amount of energy arriving from a direction (this can be called from any thread). */
+        void Record(Vector direction, uint64_t amount);
+
+        /*! Samples the energy recorded during the pass from then on, and starts recording into a quadtree refined
+         * where a node's quadrant holds more than some fraction of the energy, up to a depth. */
+        void Refine(float threshold, uint32_t depth);
+
+        /*! Returns the number of records made during the pass, and halves them (when the region is split). */
+        uint64_t Records() const { return records; }
+        void HalveRecords() { records /= 2; }
+
+        /*! Returns the number of nodes of the quadtree sampled from. */
+        size_t Nodes() const { return nodes.size(); }
+};
+
+/*! This is a node of the spatial binary tree. */
+struct SpatialNode
+{
+    /*! The index of the first child (the second follows it), or zero for leaves. */
+    uint32_t child;
+    /*! The index of the directional quadtree of leaves. */
+    uint32_t tree;
+};
+
+/*! \class GuidingTree
+ * This is the SD-tree, learning the light arriving anywhere in the scene. */
+class GuidingTree
+{
+    private:
+        /*! The bounds of the scene, which the nodes split in half along x, y and z in turn. */
+        AABB bounds;
+        /*! The nodes of the spatial tree, from the root. */
+        std::vector<SpatialNode> nodes;
+        /*! The directional quadtree of each region. */
+        std::vector<DirectionalTree> trees;
+        /*! The fixed-point scale the radiance is recorded at. */
+        float scale;
+    public:
+        /*! Whether the path tracer records its paths into the tree (during the training passes). */
+        bool recording;
+
+        /*! Creates a tree of a single region, which has not learned anything yet.
+         \param bounds The bounds of the scene.
+         \param radiance The highest radiance emitted in the scene, which sets the fixed-point scale. */
+        GuidingTree(const AABB& bounds, float radiance);
+
+        /*! Returns the index of the directional quadtree of the region holding a point. */
+        uint32_t Lookup(Vector point) const;
+
+        /*! Returns a directional quadtree. */
+        const DirectionalTree& Tree(uint32_t index) const { return trees[index]; }
+
+        /*! Records radiance arriving at a region from a direction, divided by the density it was sampled with. */
+        void Record(uint32_t tree, Vector direction, float radiance);
+
+        /*! Refines the tree with the records of a pass of some number of samples per pixel, and starts the next one. */
+        void Refine(int32_t samples);
+
+        /*! Returns the number of regions. */
+        size_t Regions() const { return trees.size(); }
+
+        /*! Returns the number of directional quadtree nodes sampled from, over all regions. */
+        size_t DirectionalNodes() const;
+};
+
+#endif
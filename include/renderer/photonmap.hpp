@@ -0,0 +1,86 @@
+/**
+ * @file photonmap.hpp
+ *
+ * \brief Caustic photon map
+ *
+ * This is a spectral photon map for caustics, which the path tracer would otherwise take forever to converge on. Before
+ * the render, photons are shot from the lights, each at a single wavelength, and followed through the materials which
+ * are not connectable (specular and glass materials). Those which then land on a connectable material are stored, so
+ * the map holds the light which reached a diffuse or glossy surface through glass or mirrors. The path tracer gathers
+ * this light from the map at every connectable material it hits, and ignores the same light when it finds it itself.
+ *
+ * The photons are stored in a hashed grid of cells twice the gathering radius across, so that a gathering disc only
+ * overlaps eight cells. They are sorted by cell and then by wavelength in a single array, so each cell's photons are
+ * contiguous, and only those within the spectral bandwidth of the wavelength being gathered are visited.
+ */
+
+#ifndef PHOTONMAP_H
+#define PHOTONMAP_H
+
+#include <materials/material.hpp>
+#include <util/vec3.hpp>
+#include <vector>
+#include <utility>
+
+/*! This is a photon, which landed on a connectable material. */
+struct Photon
+{
+    /*! Where the photon landed, and the direction it arrived from (pointing towards the surface). */
+    float position[3], direction[3];
+    /*! The photon's power, per unit wavelength. */
+    float power;
+    /*! The photon's wavelength, in nanometers. */
+    float wavelength;
+};
+
+/*! \class PhotonMap
+ * This stores photons in a hashed grid, and estimates the radiance they reflect off a surface. */
+class PhotonMap
+{
+    private:
+        /*! The photons, sorted by cell and then by wavelength. */
+        std::vector<Photon> photons;
+        /*! Where each hash table bucket's photons start in the photon array (with an extra entry for the end). */
+        std::vector<uint32_t> buckets;
+        /*! The gathering radius, and the spectral bandwidth (in nanometers). */
+        float radius, bandwidth;
+
+        /*! Returns the hash table bucket of a grid cell. */
+        uint32_t Bucket(int32_t x, int32_t y, int32_t z) const;
+    public:
+        /*! Builds the map from some photons.
+         \param photons The photons, which are moved into the map.
+         \param radius The radius within which photons are gathered.
+         \param bandwidth The width of the spectral window within which photons are gathered, in nanometers. */
+        PhotonMap(std::vector<Photon>* photons, float radius, float bandwidth);
+
+        /*! Estimates the radiance reflected by a surface, from the photons near a point on it.
+         \param point The point on the surface.
+         \param incident The incident vector, from the camera's side.
+         \param normal The surface normal.
+         \param wavelength The wavelength to estimate the radiance at.
+         \param material The surface's material, which must be connectable.
+         \return Returns the reflected radiance, towards the opposite of the incident vector. */
+        float Radiance(Vector point, Vector incident, Vector normal, float wavelength, Material* material) const;
+
+        /*! Returns the number of photons in the map. */
+        size_t Count() const { return photons.size(); }
+
+        /*! Returns the memory used by the map, in bytes. */
+        size_t Memory() const { return photons.size() * sizeof(Photon) + buckets.size() * sizeof(uint32_t); }
+
+        /*! Returns the memory a map of some number of photons would use, in bytes. */
+        static size_t Memory(size_t count) { return count * (sizeof(Photon) + 2 * sizeof(uint32_t)); }
+
+        /*! Returns the most memory building a map of some number of photons takes, in bytes: the photons shot and
+         * their sorted copy, the sort keys and order, and the hash table. */
+        static size_t PeakMemory(size_t count)
+        {
+            return count * (2 * sizeof(Photon) + sizeof(std::pair<uint32_t, float>) + 3 * sizeof(uint32_t));
+        }
+
+        /*! Returns the gathering radius. */
+        float Radius() const { return radius; }
+};
+
+#endif
@@ -0,0 +1,65 @@
+/**
+ * @file postprocess.hpp
+ *
+ * \brief Post-processing interface
+ *
+ * These are the image-space operations applied to a finished render before it is saved, namely denoising,
+ * tonemapping and gamma correction. They work on linear RGB pixel arrays, and are parallelized with OpenMP and
+ * vectorized.
+ */
+
+#ifndef POSTPROCESS_H
+#define POSTPROCESS_H
+
+#include <util/vec3.hpp>
+#include <util/cie.hpp>
+
+/* The number of intervals in the gamma correction lookup table, over [0, 1]. */
+#define TRANSFER_LUT_SIZE 4096
+
+/* The most iterations of the denoising filter, which then covers 16381 pixels across. */
+#define DENOISE_MAX_ITERATIONS 12
+
+/*! Denoises a pixel array with the edge-avoiding À-trous wavelet filter (after Dammertz et al., and Schied et al.'s
+ * spatiotemporal variance-guided filtering without the temporal part), guided by the features of the surfaces seen
+ * through each pixel. Each iteration blurs the pixels with a 5x5 B3-spline kernel whose taps are twice as far apart
+ * as the previous one's, weighting each tap down as its normal, depth and luminance differ from the pixel's. The
+ * luminance is compared to the pixel's standard deviation, estimated from its neighbors and filtered along.
+ *
+ * The pixels are divided by their albedo before being filtered and multiplied back after, so that the filter only
+ * blurs the lighting, not the textures.
+ \param pixels The pixel array, in linear RGB.
+ \param albedo The albedo of each pixel, in linear RGB (one for white).
+ \param normals The unit normal of each pixel.
+ \param depths The depth of each pixel, or zero where nothing was hit (these pixels are left as they are).
+ \param width, height The size of the pixel array.
+ \param iterations The number of iterations, the filter covering 4 * 2^iterations - 3 pixels across (those whose
+                   taps would all be outside of the pixel array are skipped).
+ \param colorSystem The color system the pixels are in. */
+void DenoisePixels(Vector* pixels, const Vector* albedo, const Vector* normals, const float* depths, int32_t width,
+                   int32_t height, int32_t iterations, ColorSystem colorSystem);
+
+/*! Applies the Reinhard tonemapping operator to a pixel array, keyed to its log-average luminance.
+ \param pixels The pixel array, in linear RGB.
+ \param count The number of pixels in the array.
+ \param colorSystem The color system the pixels are in. */
+void TonemapPixels(Vector* pixels, size_t count, ColorSystem colorSystem);
+
+/*! Gamma-corrects a pixel array according to a color system.
+ \param pixels The pixel array, in linear RGB.
+ \param count The number of pixels in the array.
+ \param colorSystem The color system the pixels are in.
+ \remark The Rec.709 transfer curve goes through a lookup table over [0, 1], so components above one are clamped to
+ one (which is the largest displayable value anyway). Other gamma curves are not clamped. */
+void GammaCorrectPixels(Vector* pixels, size_t count, ColorSystem colorSystem);
+
+/*! Maps an array of values to false colors, from black through blue, red and yellow to white.
+ \param values The values to map.
+ \param count The number of values.
+ \param pixels This receives the colors, which are ready for display.
+ \param low This receives the value mapped to black, which is the 1st percentile.
+ \param high This receives the value mapped to white, which is the 99th percentile.
+ \remark The range is clipped to percentiles so that a few outliers do not wash out the rest of the image. */
+void FalseColorPixels(const float* values, size_t count, Vector* pixels, float* low, float* high);
+
+#endif
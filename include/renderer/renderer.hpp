@@ -22,19 +22,35 @@
 #include <lights/omni.hpp>
 #include <cameras/camera.hpp>
 #include <cameras/perspective.hpp>
+#include <renderer/postprocess.hpp>
+#include <renderer/bidirectional.hpp>
+#include <renderer/photonmap.hpp>
+#include <renderer/guiding.hpp>
 #include <scenegraph/bvh.hpp>
+#include <scenegraph/lightbvh.hpp>
 #include <spectral/distribution.hpp>
 #include <spectral/blackbody.hpp>
 #include <spectral/flat.hpp>
 #include <spectral/peak.hpp>
 #include <spectral/sellmeier.hpp>
+#include <samplers/sampler.hpp>
 #include <util/aabb.hpp>
 #include <util/vec3.hpp>
 #include <util/cie.hpp>
+#include <util/statistics.hpp>
+#include <util/imageio.hpp>
+#include <util/accumulation.hpp>
+#include <util/timeline.hpp>
+#include <util/arena.hpp>
+#include <util/alias.hpp>
 
 /* And a few standard includes, too. */
+#include <unordered_map>
 #include <vector>
-#include <random>
+
+/* This is the width and height of the square tiles the render is split into. Spectra are converted to colors
+ * a tile at a time, so it should be large enough to amortize this, but small enough to balance the load. */
+#define TILESIZE 16
 
 /*! This contains global rendering information such as the width and height of the render. */
 #pragma pack(1)
@@ -47,6 +63,237 @@ struct RenderParams
     /*! THe number of samples in the render. */
     int32_t samples;
 };
+#pragma pack()
+
+/*! These are the ways wavelengths can be sampled for each pixel sample. */
+enum SpectralSampling
+{
+    /*! Every wavelength of the spectral grid is traced. */
+    SPECTRAL_GRID = 0,
+    /*! As many wavelengths are importance-sampled from the color-matching curves, with stratification. */
+    SPECTRAL_IMPORTANCE = 1
+};
+
+/*! These are the algorithms which can estimate the radiance along each camera ray. */
+enum Integrator
+{
+    /*! Unidirectional path tracing, from the camera (see Renderer::Radiance). */
+    INTEGRATOR_PATH = 0,
+    /*! Bidirectional path tracing, connecting camera and light subpaths (see bidirectional.hpp). The light subpaths
+     * add to any pixel from any thread, so the render depends on the number of threads through rounding. */
+    INTEGRATOR_BIDIRECTIONAL = 1
+};
+
+/*! These are the ways the bidirectional path tracer picks the light of each direct connection (from a camera subpath
+ * vertex to a light). Light subpaths and photons always start on lights picked by power. */
+enum LightSampling
+{
+    /*! The light subpath's first vertex, on a light picked by power. */
+    LIGHTS_POWER = 0,
+    /*! A light picked for each camera subpath vertex with the light BVH, which favors nearby lights. */
+    LIGHTS_BVH = 1
+};
+
+/*! These are the ways the path tracer decides whether to continue a light path after each bounce. */
+enum RussianRoulette
+{
+    /*! The path continues with the probability of the bounce's reflectance, whatever the path's throughput. */
+    ROULETTE_BOUNCE = 0,
+    /*! The path always continues while its throughput is over a threshold, and otherwise in proportion to it, its
+     * throughput being raised back to the threshold when it continues. */
+    ROULETTE_THROUGHPUT = 1
+};
+
+/*! These are the per-pixel costs which can be rendered as a heatmap, instead of the image itself. */
+enum HeatmapMetric
+{
+    /*! No heatmap, the image is rendered as usual. */
+    HEATMAP_NONE = 0,
+    /*! The time spent, in microseconds per pixel sample. */
+    HEATMAP_TIME = 1,
+    /*! The number of bounding volume hierarchy nodes visited per pixel sample. */
+    HEATMAP_NODES = 2,
+    /*! The number of ray-primitive intersection tests per pixel sample. */
+    HEATMAP_PRIMITIVES = 3
+};
+
+/*! These are the rays whose cost a heatmap measures. */
+enum HeatmapRays
+{
+    /*! Only the camera rays (this shows the cost of the geometry and of the BVH). */
+    HEATMAP_CAMERA = 0,
+    /*! The full light paths, for every wavelength (this also shows the cost of the materials). */
+    HEATMAP_PATHS = 1
+};
+
+/*! This is a rectangle of the render's pixels. */
+struct CropWindow
+{
+    /*! The column and row of its first pixel, and its width and height. */
+    int32_t x, y, width, height;
+
+    /*! Creates an empty window, which stands for the whole render. */
+    CropWindow() : x(0), y(0), width(0), height(0) { }
+
+    /*! Returns whether the window is empty. */
+    bool Empty() const { return (width <= 0) || (height <= 0); }
+};
+
+/*! This contains rendering options which are not part of the scene file, and can be changed between renders. */
+struct RenderSettings
+{
+    /*! The spectral resolution, in nanometers per wavelength (one of the RESOLUTION_* values). */
+    int32_t resolution;
+    /*! How wavelengths are chosen for each pixel sample. */
+    SpectralSampling spectralSampling;
+    /*! The sampler drawing the random numbers of each pixel sample. */
+    SamplerType sampler;
+    /*! The algorithm estimating the radiance along each camera ray. */
+    Integrator integrator;
+    /*! How the bidirectional path tracer picks the lights of its direct connections. */
+    LightSampling lightSampling;
+    /*! The file to write the statistics report to, if any (statistics must be compiled in). */
+    std::string statistics;
+    /*! The number of samples per pixel, or zero to use the scene file's. */
+    int32_t samples;
+    /*! The index of the first sample of each pixel to render, so that a render can be split into sample ranges
+     * (ranges starting on multiples of 16 samples trace exactly the same samples as a single render would). */
+    int32_t firstSample;
+    /*! Whether to save the render as an HDR accumulation buffer (see accumulation.hpp) instead of a PPM. */
+    bool accumulate;
+    /*! The random seed. The render only depends on this seed, not on the number of threads. */
+    uint32_t seed;
+    /*! The PFM file to write the linear (not tonemapped) render to, if any. */
+    std::string linear;
+    /*! The per-pixel cost to render as a false-color heatmap instead of the image, if any. The raw costs are saved
+     * as a grayscale PFM file, to the linear render file if one was given, otherwise next to the render. */
+    HeatmapMetric heatmap;
+    /*! The rays whose cost the heatmap measures. */
+    HeatmapRays heatmapRays;
+    /*! The file to write the render's timeline to, in the Chrome trace event format, if any. */
+    std::string timeline;
+    /*! The port to hand tiles out to workers on, if the render is to be distributed (zero to render locally). */
+    int32_t coordinatorPort;
+    /*! The coordinator to work for as host:port, if this is a worker (which gets the other settings from it). */
+    std::string worker;
+    /*! The longest time the coordinator waits for a worker to answer, in seconds, after which the worker is dropped
+     * and its tiles handed out again (a worker answers once it has rendered all of the tiles it asked for). */
+    int32_t workerTimeout;
+    /*! The camera parameters overriding the scene's, if any. */
+    CameraOverride camera;
+    /*! The number of frames of a turntable sequence to render, orbiting the camera around its target, if any. */
+    int32_t orbit;
+    /*! The camera keyframes of a sequence to render, if any (see LoadKeyframes). */
+    std::string keyframes;
+    /*! Whether the scene's primitives are stored in huge pages (this is only used when loading a scene). */
+    bool hugePages;
+    /*! The file to move the scene's vertices from before rendering, if any (see Renderer::LoadVertices). For
+     * sequences, a frame number in it (like "cloth%04d.bin") loads the vertices of every frame. The
+     * vertices stay moved after the render, so the render server unloads the scene afterwards. */
+    std::string vertices;
+    /*! The number of photons to shoot for the caustic photon map (see photonmap.hpp), or zero for none. The photon
+     * map is only used by the path tracer. */
+    int32_t photons;
+    /*! The most memory the photon map may take while it is built, with the photons being shot, in MiB (photons are
+     * shot until it is full, up to their number). */
+    int32_t photonMemory;
+    /*! The radius within which photons are gathered, or zero to derive it from the scene and the photons. */
+    float photonRadius;
+    /*! How the path tracer plays russian roulette. */
+    RussianRoulette roulette;
+    /*! The throughput under which paths are played russian roulette, when it is based on their throughput. */
+    float rouletteThreshold;
+    /*! The number of bounces before russian roulette starts. */
+    int32_t minDepth;
+    /*! The most bounces a path may take, or zero for no limit (limiting it darkens long paths, such as caustics). */
+    int32_t maxDepth;
+    /*! The number of branches path tracer paths are split into at their first diffuse or glossy surface. */
+    int32_t splits;
+    /*! The number of passes training the path guiding tree (see guiding.hpp) before the rest of the samples, or zero
+     * for no path guiding. Path guiding is only used by the path tracer. */
+    int32_t guiding;
+    /*! The number of iterations of the edge-avoiding filter denoising the render before it is tonemapped (see
+     * DenoisePixels), or zero not to denoise it. */
+    int32_t denoise;
+    /*! The base name of the AOV images to save (see Renderer::SaveAOVs), if any. */
+    std::string aovs;
+    /*! The window of the render to render alone, if any (the rest of the render is left black, without samples). */
+    CropWindow crop;
+    /*! The accumulation buffer to composite the render into, if any (the result is saved as the render). */
+    std::string composite;
+    /*! Whether the render replaces the samples of the accumulation buffer it is composited into, rather than adding
+     * to them (in which case its samples follow those in the buffer, unless its sample range is given). */
+    bool replace;
+    /*! The wall-clock time the raytracing must fit in, in seconds, or zero to render a set number of samples (which
+     * is then the most samples per pixel to render, if given). */
+    float budget;
+
+    /*! Creates the default render settings. */
+    RenderSettings() : resolution(RESOLUTION_FINAL), spectralSampling(SPECTRAL_GRID), sampler(SAMPLER_INDEPENDENT),
+                       integrator(INTEGRATOR_PATH), lightSampling(LIGHTS_POWER), samples(0), firstSample(0), accumulate(false), seed(0x530FD819), heatmap(HEATMAP_NONE),
+                       heatmapRays(HEATMAP_CAMERA), coordinatorPort(0), workerTimeout(600), orbit(0), hugePages(false), photons(0),
+                       photonMemory(256), photonRadius(0.0f), roulette(ROULETTE_BOUNCE), rouletteThreshold(0.25f),
+                       minDepth(0), maxDepth(0), splits(1), guiding(0), denoise(0), replace(false),
+                       budget(0.0f) { }
+};
+
+/*! This is where the path tracer is along a light path (a path which is split carries on in each of its branches). */
+struct PathState
+{
+    /*! The number of bounces so far. */
+    uint32_t bounce;
+    /*! The offset of the dimensions the path draws from, which is different for each branch. */
+    uint32_t offset;
+    /*! The product of the path's weights so far. */
+    float beta;
+    /*! Whether light was gathered from the photon map along the path, and whether the path went through a specular or
+     * glass material since. */
+    bool gathered, specular;
+    /*! Whether the path was split already. */
+    bool split;
+
+    /*! Creates the state of a path leaving the camera. */
+    PathState() : bounce(0), offset(0), beta(1.0f), gathered(false), specular(false), split(false) { }
+};
+
+/*! These are the features of the surface a camera ray hits first, which guide the denoiser and make the AOVs. */
+struct SurfaceFeatures
+{
+    /*! The distance to the surface along the ray, or zero if the ray hit nothing. */
+    float depth;
+    /*! The surface normal (see Primitive::Normal), or zero. */
+    Vector normal;
+    /*! The primitive hit, whose material has the surface's albedo (see Material::Albedo), or null. */
+    const Primitive* primitive;
+
+    /*! Creates the features of a ray which hit nothing. */
+    SurfaceFeatures() : depth(0.0f), normal(ZERO), primitive(nullptr) { }
+};
+
+/*! These are the features of the surfaces a render's camera rays hit first, summed over its samples for each pixel. */
+struct FeatureBuffers
+{
+    /*! The integrated colors of the albedos, as for the render itself (see ColorPipeline). */
+    std::vector<Vector> albedo;
+    /*! The normals. */
+    std::vector<Vector> normals;
+    /*! The depths. */
+    std::vector<float> depths;
+    /*! The number of samples which hit anything. */
+    std::vector<uint32_t> hits;
+    /*! The primitive hit by the first sample which hit anything, in the order they were traced, or null. */
+    std::vector<const Primitive*> primitives;
+
+    /*! Creates buffers of some number of pixels, without any samples. */
+    FeatureBuffers(size_t count) : albedo(count, ZERO), normals(count, ZERO), depths(count, 0.0f), hits(count, 0),
+                                   primitives(count, nullptr) { }
+};
+
+/*! Parses render settings from command line options, such as "--samples 64".
+ \param options The options, each followed by its value.
+ \param settings The render settings to change.
+ \return Returns false if an option is unknown or invalid (which is reported). */
+bool ParseSettings(const std::vector<std::string>& options, RenderSettings* settings);
 
 /*! \class Renderer
  * This is the main renderer class which drives the rendering algorithm. */
@@ -61,6 +308,8 @@ class Renderer
         std::vector<Material*>* materials;
         /*! These are all the lights used in the scene. */
         std::vector<Light*>* lights;
+        /*! These hold the distributions, primitives, materials and lights (one arena per kind of entity). */
+        Arena *distributionArena, *primitiveArena, *materialArena, *lightArena;
         /*! The render parameters to use to render. */
         RenderParams renderParams;
         /*! The color system to use for rendering. */
@@ -69,24 +318,166 @@ class Renderer
         Camera* camera;
         /*! This is the bounding volume hierarchy. */
         BVH* bvh;
+        /*! These are the primitives in scene file order, which the BVH build doesn't keep. */
+        std::vector<Primitive*> sceneOrder;
+        /*! This is the total vertex count of the primitives. */
+        size_t vertexCount;
         /*! This applies the Reinhard tonemapping operator to a pixel array. */
         void TonemapRender(Vector* pixels);
+        /*! This averages the features of the render's pixels over some samples per pixel: the albedo in RGB (relative
+         * to that of a white surface), the unit normal and the depth, which are zero where nothing was hit. */
+        void AverageFeatures(int32_t samples, int32_t resolution, std::vector<Vector>* albedo,
+                             std::vector<Vector>* normals, std::vector<float>* depths);
+        /*! This denoises a pixel array of some samples per pixel, guided by the features of the render. */
+        void DenoiseRender(Vector* pixels, int32_t samples, const RenderSettings& settings);
+        /*! Saves the features of the render's pixels over some samples per pixel as AOV images, named after a base
+         * name, returning false if any could not be saved. These are the depth, normal and albedo (as averaged
+         * above), and the index of the primitive and of the material hit first, in scene file order (-1 if none). */
+        bool SaveAOVs(std::string base, int32_t samples, int32_t resolution);
         /*! This gamma-corrects a pixel array. */
         void GammaCorrectRender(Vector* pixels);
-        /*! Saves a pixel array to a PPM file. */
-        void SaveToPPM(Vector* pixels, std::string render, time_t elapsedTime);
-        /*! Returns a radiance sample along a light ray. */
-        float Radiance(Ray ray, float wavelength, std::mt19937* prng);
+        /*! Saves a pixel array to a PPM file, returning false if it could not be saved. */
+        bool SaveToPPM(Vector* pixels, std::string render, time_t elapsedTime);
+        /*! Returns a radiance sample along a light ray, optionally adding up the cost of tracing it and noting the
+         * features of the surface it hits first, continuing a path (by default, one leaving the camera). */
+        float Radiance(Ray ray, float wavelength, Sampler* sampler, const RenderSettings& settings,
+                       TraversalCost* cost = nullptr, SurfaceFeatures* features = nullptr,
+                       PathState path = PathState());
+        /*! These are the primitives carrying a light (which emit anything), and where each one is in the list. */
+        std::vector<Primitive*> emitters;
+        std::unordered_map<const Primitive*, uint32_t> emitterIndices;
+        /*! This picks emitters by power (their emittance integrated over the spectrum, times their area). */
+        AliasTable emitterTable;
+        /*! This picks emitters to illuminate points with, favoring nearby ones. */
+        LightBVH lightTree;
+        /*! Finds the primitives carrying a light, and builds the structures picking them. */
+        void FindEmitters();
+        /*! Returns the density of a point on an emitter being picked by power, per unit area. */
+        float EmitterDensity(const Primitive* emitter) const;
+        /*! Returns how much more likely an emitter is to be picked by the light BVH for a point than by power. */
+        float LightTreeRatio(const Primitive* emitter, Vector point) const;
+        /*! Returns a radiance sample along a camera ray by bidirectional path tracing, using some subpath storage.
+         * The light tracing contributions are added to a buffer of integrated colors (four floats per pixel, see
+         * ColorPipeline) with the weights of the color-matching curves at this wavelength, from any thread. */
+        float BidirectionalRadiance(Ray ray, float wavelength, Sampler* sampler, BidirectionalPaths* paths,
+                                    float* splats, Vector splatWeight);
+        /*! Extends a subpath by sampling materials, from a ray leaving its last vertex with some throughput and
+         * density per unit solid angle, drawing each bounce from its dimension of the sampler. */
+        void TraceSubpath(std::vector<PathVertex>* path, Ray ray, float beta, float pdfDir, float wavelength,
+                          Sampler* sampler, bool fromCamera);
+        /*! Returns the contribution of connecting the first s vertices of the light subpath to the first t
+         * vertices of the camera subpath, weighted by multiple importance sampling. Connections to the camera itself
+         * (t = 1) are added to the splat buffer instead, as for BidirectionalRadiance. */
+        float ConnectSubpaths(BidirectionalPaths* paths, int s, int t, float wavelength, float* splats,
+                              Vector splatWeight);
+        /*! Returns the multiple importance sampling weight of connecting the first s vertices of the light
+         * subpath to the first t vertices of the camera subpath. */
+        float ConnectionWeight(BidirectionalPaths* paths, int s, int t, float wavelength);
+        /*! The caustic photon map, if photons were shot for the render. */
+        PhotonMap* photonMap;
+        /*! Shoots the photons of the render settings into a new caustic photon map (replacing any), reporting it if
+         * verbose. No map is made if no photons are caustics. */
+        void BuildPhotonMap(const RenderSettings& settings, bool verbose);
+        /*! Traces a photon from a light, drawing from the sampler, and adds it to some photons if it is a caustic. */
+        void TracePhoton(Sampler* sampler, std::vector<Photon>* photons);
+        /*! The path guiding tree, if the render is guided. */
+        GuidingTree* guidingTree;
+        /*! Raytraces some tiles over a render's samples with path guiding, making a new guiding tree (replacing any)
+         * and training it over passes of the first samples, and returns the number of training passes. */
+        int32_t TraceGuided(Vector* colors, const std::vector<int32_t>& tiles, int32_t samples,
+                            const RenderSettings& settings);
+        /*! The features of the render's pixels, if they are to be found as it is raytraced. */
+        FeatureBuffers* features;
+        /*! The window of the render being rendered, which is the whole render unless it is cropped. */
+        CropWindow window;
+        /*! The accumulation buffer the render is composited into, if any. */
+        AccumulationBuffer* composite;
+        /*! Returns the number of square tiles the render is split into. */
+        int32_t TileCount() const;
+        /*! Returns whether a pixel is within the window being rendered. */
+        bool InWindow(int32_t x, int32_t y) const
+        {
+            return window.Empty() || ((x >= window.x) && (x < window.x + window.width) && (y >= window.y)
+                                   && (y < window.y + window.height));
+        }
+        /*! Returns the tiles overlapping the window being rendered. */
+        std::vector<int32_t> WindowTiles() const;
+        /*! Returns the pixel bounds of a tile within the window being rendered (excluding the second corner). */
+        void TileBounds(int32_t tile, int32_t* x0, int32_t* y0, int32_t* x1, int32_t* y1) const;
+        /*! Raytraces some tiles of the render over a range of samples, sampling wavelengths on a given spectral grid.
+         * The colors integrated from each pixel's spectra (XYZ and total radiance, see ColorPipeline) are summed over
+         * the samples, and added to an image-sized buffer (and their features to the feature buffers, if any). */
+        template <typename Grid> void RenderTiles(Vector* colors, const std::vector<int32_t>& tiles,
+                                                  int32_t firstSample, int32_t sampleCount,
+                                                  const RenderSettings& settings, bool showProgress);
+        /*! Same as above, using the spectral grid for the resolution in the render settings. */
+        void TraceTiles(Vector* colors, const std::vector<int32_t>& tiles, int32_t firstSample, int32_t sampleCount,
+                        const RenderSettings& settings, bool showProgress);
+        /*! Raytraces some tiles over as many samples as fit before a deadline (from omp_get_wtime), in passes over
+         * every tile of growing numbers of samples, and returns the number of samples per pixel rendered. The number
+         * which fits is predicted from the first pass, and printed.
+         \param limit The most samples per pixel to render, or zero for no limit. */
+        int32_t TraceBudget(Vector* colors, const std::vector<int32_t>& tiles, double deadline, int32_t limit,
+                            const RenderSettings& settings);
+        /*! Converts a buffer of integrated colors summed over some samples into the average RGB colors. */
+        void ColorsToRGB(const Vector* colors, Vector* pixels, int32_t samples, int32_t resolution);
+        /*! Converts a frame's integrated colors to RGB, and saves it either tonemapped or as an accumulation buffer
+         * (and as a linear render, if requested), returning false if it could not be saved. */
+        bool SaveFrame(const Vector* colors, Vector* pixels, std::string render, int32_t samples,
+                       const RenderSettings& settings, time_t elapsedTime);
+        /*! Prints the statistics report of the last render, and saves it if requested. */
+        void ReportStatistics(const RenderSettings& settings);
+        /*! Raytraces every tile of the render by handing them out to workers, returning false on failure. */
+        bool Coordinate(Vector* colors, int32_t samples, const RenderSettings& settings);
+        /*! Measures the cost of every pixel of the render instead, tracing the wavelengths of a spectral grid. */
+        template <typename Grid> void RenderHeatmap(float* costs, int32_t samples, const RenderSettings& settings);
+        /*! Moves the scene's vertices to those in a file (see UpdateVertices), returning false on failure. The file
+         * holds three 32-bit floats (x, y, z) per vertex, in scene file order. If verbose, the refit or failure is reported. */
+        bool LoadVertices(std::string path, bool verbose);
         /*! Number of pixels in the render. */
         size_t pixelCount;
+        /*! The description, timings and statistics of the scene and of the last render. */
+        StatisticsReport report;
     public:
         /*! This constructor initializes the renderer from a scene file.
-         \param scene The scene file to open. */
-        Renderer(std::string scene);
+         \param scene The scene file to open.
+         \param hugePages Whether to store the primitives in huge pages, which speeds up large scenes. */
+        Renderer(std::string scene, bool hugePages = false);
+
+        /*! This method renders the scene (or its cost heatmap) into a PPM file, or an accumulation buffer.
+          \param threads The number of threads to use.
+          \param settings The render settings to use.
+          \return Returns false if the render could not be made or saved. */
+        bool Render(std::string render, size_t threads, RenderSettings settings = RenderSettings());
+
+        /*! This method renders a sequence of frames from different camera poses, reusing the loaded scene and its
+         * BVH. Each frame is tonemapped and saved while the next one is being raytraced.
+          \param render The file name of the frames, with a frame number (%d, optionally with a width padded with
+                        spaces or zeros, like "frame%04d.ppm") and no other % sign, otherwise the frame number is
+                        appended to the name before its extension.
+          \param threads The number of threads to use.
+          \param poses The camera parameters of each frame, overriding the scene's camera.
+          \param settings The render settings to use for every frame (the linear render is numbered as well).
+          \return Returns false if the sequence was aborted, or any frame could not be saved. */
+        bool RenderSequence(std::string render, size_t threads, const std::vector<CameraOverride>& poses,
+                            RenderSettings settings);
 
-        /*! This method renders the scene into a PPM file.
+        /*! This method moves the vertices of the scene's primitives in place (three per triangle, and the center of
+         * each sphere), then refits the BVH to them, rebuilding it if the refit made it too slow. This is meant for
+         * animated geometry whose topology doesn't change, like simulations.
+          \param vertices The new vertices of every primitive, in scene file order.
+          \param rebuilt If not null, this is set to whether the BVH was rebuilt rather than refitted.
+          \return Returns false if the number of vertices doesn't match the scene's, in which case nothing moves. */
+        bool UpdateVertices(const std::vector<Vector>& vertices, bool* rebuilt = nullptr);
+
+        /*! This method makes the renderer a worker of a distributed render, rendering the tiles it is handed by a
+         * coordinator until the render is complete. The coordinator must be rendering the same scene.
+          \param coordinator The coordinator's address, as host:port.
           \param threads The number of threads to use. */
-        void Render(std::string render, size_t threads);
+        void Work(std::string coordinator, size_t threads);
+
+        /*! Returns the description, timings and statistics of the last render (and of the scene loading). */
+        const StatisticsReport& Report() const { return report; }
 
         /*! This destructor will free all resources used by the renderer. */
         ~Renderer();
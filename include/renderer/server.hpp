@@ -0,0 +1,80 @@
+/**
+ * @file server.hpp
+ *
+ * \brief Render server
+ *
+ * This is a long-running render server, which takes render jobs from a job directory and keeps the scenes it has
+ * loaded (and their bounding volume hierarchies) in memory between jobs, so that many renders of the same few scenes
+ * with different cameras and sample counts only pay for loading each scene once. Jobs run one after the other, each
+ * over all of the server's threads (the OpenMP thread pool is kept alive between jobs).
+ *
+ * A job is a text file named *.job, containing the scene and output files followed by any render options, just as
+ * on the command line (for instance "scenes/cornellbox renders/left.ppm --samples 256 --position 1,2,3"), separated
+ * by whitespace. Jobs are run in the order of their file names, and each job file is renamed to *.running while it
+ * runs, then to *.done or *.failed. The server exits once it finds a file named "stop" in the job directory.
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <renderer/renderer.hpp>
+#include <string>
+#include <map>
+
+/* This is the number of scenes the server keeps loaded, after which the least recently used one is unloaded. */
+#define SERVER_SCENES 4
+
+/* This is how often the job directory is checked when there are no jobs, in milliseconds. */
+#define SERVER_POLL 250
+
+/*! \class RenderServer
+ * This runs render jobs, keeping the scenes they render loaded between jobs. */
+class RenderServer
+{
+    private:
+        /*! This is a loaded scene, which is reloaded if its file was modified since. */
+        struct LoadedScene
+        {
+            /*! The renderer holding the scene and its BVH. */
+            Renderer* renderer;
+            /*! The modification time of the scene file when it was loaded, in nanoseconds. */
+            int64_t modified;
+            /*! Whether its primitives are stored in huge pages. */
+            bool hugePages;
+            /*! The job which last used the scene, to unload the least recently used one. */
+            uint64_t lastJob;
+        };
+
+        /*! The loaded scenes, by path. */
+        std::map<std::string, LoadedScene> scenes;
+        /*! The number of threads to render with. */
+        size_t threads;
+        /*! The number of jobs run so far. */
+        uint64_t jobs;
+
+        /*! Returns the renderer for a scene file, loading it if it is not loaded or was modified since (with its
+         * primitives in huge pages, if requested, reloading it if it was loaded with the other setting).
+          \return Returns null if the scene file does not exist. */
+        Renderer* GetScene(std::string scene, bool hugePages);
+    public:
+        /*! Creates a server with no scenes loaded.
+          \param threads The number of threads to render with, or zero for all of them. */
+        RenderServer(size_t threads);
+
+        /*! Runs a render job.
+          \param scene The scene file to render.
+          \param render The file to save the render to.
+          \param settings The render settings.
+          \return Returns false if the scene file does not exist, or the render (or any frame of a sequence) could not
+                  be made or saved. */
+        bool Run(std::string scene, std::string render, const RenderSettings& settings);
+
+        /*! Runs the jobs in a job directory as they appear, until told to stop.
+          \param directory The job directory. */
+        void Serve(std::string directory);
+
+        /*! Unloads every scene. */
+        ~RenderServer();
+};
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef HALTON_H
+#define HALTON_H
+
+#include <samplers/sampler.hpp>
+
+/* This is the number of prime bases of the Halton sequence. Further dimensions reuse the bases with other scrambles
+ * (high bases need many samples to be well distributed anyway). */
+#define HALTON_BASES 64
+
+/* This draws scrambled Halton points, each dimension being the radical inverse of the point's index in a prime base.
+ * The digits are scrambled with random permutations nested as in Owen scrambling (a random digit shift per node of
+ * the digit tree, drawn from a hash of the higher digits), with a seed of their own for each pixel and dimension. */
+class HaltonSampler : public Sampler
+{
+    public:
+        /* Creates the sampler for a render seed. */
+        HaltonSampler(uint32_t seed) : Sampler(seed) { }
+
+        /* This function returns the next dimension of the current point. */
+        virtual float Next1D();
+
+        /* This function returns the next two dimensions of the current point. */
+        virtual void Next2D(float* u1, float* u2);
+};
+
+#endif // HALTON_H
@@ -0,0 +1,36 @@
+#ifndef INDEPENDENT_H
+#define INDEPENDENT_H
+
+#include <samplers/sampler.hpp>
+#include <random>
+
+/* This is the number of consecutive samples of a pixel drawn from one PRNG seed. The PRNG is reseeded from the render
+ * seed, pixel and sample index at the start of each block, which makes the render independent of the thread count
+ * and scheduling. Reseeding is not free (about as long as a few light paths), hence the blocks. */
+#define SEEDBLOCK 16
+
+/* This draws independent uniform random numbers from a Mersenne twister, in the order they are asked for (so the
+ * dimensions of the light paths are not kept apart). */
+class IndependentSampler : public Sampler
+{
+    private:
+        /* The PRNG, which is reseeded for every block of samples of a pixel. */
+        std::mt19937 prng;
+    public:
+        /* Creates the sampler for a render seed. */
+        IndependentSampler(uint32_t seed) : Sampler(seed) { }
+
+        /* This function starts a pixel sample, reseeding the PRNG if needed. */
+        virtual void StartSample(uint32_t pixel, uint32_t sample);
+
+        /* The light paths of a sample just carry on drawing from the PRNG. */
+        virtual void StartPath(uint32_t path, uint32_t paths) { }
+
+        /* This function returns the next random number. */
+        virtual float Next1D();
+
+        /* This function returns the next two random numbers. */
+        virtual void Next2D(float* u1, float* u2);
+};
+
+#endif // INDEPENDENT_H
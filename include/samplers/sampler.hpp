@@ -0,0 +1,103 @@
+/**
+ * @file sampler.hpp
+ *
+ * \brief Sampler interface
+ *
+ * This is a common interface for samplers, which provide the random numbers of each pixel sample. A pixel sample is a
+ * point in a high-dimensional space: its first two dimensions jitter the camera ray within the pixel, and the others
+ * are drawn by the light paths traced for it (one path per wavelength), for the wavelength, and then for each bounce
+ * for the material's sampling and russian roulette. Each bounce starts on a fixed dimension, so a given dimension is
+ * always used for the same thing, which is what low-discrepancy sequences need to be effective.
+ *
+ * Samplers are indexed by (pixel, sample, dimension) rather than drawing from a stream, so that any sample of any
+ * pixel can be generated on its own, and the render does not depend on the number of threads. Each light path of a
+ * pixel sample is a point of its own in the path dimensions (the points of the sample's paths are consecutive).
+ */
+
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <stdint.h>
+
+/* This is the first dimension of a light path (the two before it jitter the camera ray). */
+#define PATH_DIMENSION 2
+
+/* This is the number of dimensions of each bounce of a light path, the last of which is for russian roulette (the
+ * materials draw at most three numbers to sample a direction). */
+#define BOUNCE_DIMENSIONS 4
+
+/* This is the first dimension of a bounce of a light path (the one before it selects the wavelength). */
+#define BOUNCE_DIMENSION(bounce) (PATH_DIMENSION + 1 + (bounce) * BOUNCE_DIMENSIONS)
+
+/* The branches of a split light path draw their bounces from dimensions this far apart (a multiple of the number of
+ * Halton bases, so that each bounce dimension keeps its base in every branch). */
+#define SPLIT_DIMENSIONS 4096
+
+/*! These are the available samplers. */
+enum SamplerType
+{
+    /*! Independent uniform random numbers. */
+    SAMPLER_INDEPENDENT = 0,
+    /*! Owen-scrambled Sobol points, two dimensions at a time. */
+    SAMPLER_SOBOL = 1,
+    /*! Scrambled Halton points. */
+    SAMPLER_HALTON = 2
+};
+
+/*! \class Sampler
+ * This is the base class from which all samplers are derived. A sampler is used by one thread at a time. */
+class Sampler
+{
+    protected:
+        /*! The render seed, which all samples depend on. */
+        uint32_t seed;
+        /*! The pixel and sample being drawn. */
+        uint32_t pixel, sample;
+        /*! The index of the point being drawn (that of the sample, or of one of its light paths). */
+        uint32_t index;
+        /*! The next dimension to draw. */
+        uint32_t dimension;
+    public:
+        /*! Creates a sampler for a render seed. */
+        Sampler(uint32_t seed) : seed(seed), pixel(0xFFFFFFFF), sample(0xFFFFFFFF), index(0), dimension(0) { }
+
+        /*! Samplers are deleted through base class pointers. */
+        virtual ~Sampler() { }
+
+        /*! This method starts a pixel sample, from its first dimension.
+         \param pixel The index of the pixel.
+         \param sample The index of the sample within the pixel. */
+        virtual void StartSample(uint32_t pixel, uint32_t sample)
+        {
+            this->pixel = pixel;
+            this->sample = this->index = sample;
+            this->dimension = 0;
+        }
+
+        /*! This method starts one of the light paths of the current pixel sample, from its first dimension.
+         \param path The index of the path within the sample.
+         \param paths The number of paths of each sample. */
+        virtual void StartPath(uint32_t path, uint32_t paths)
+        {
+            this->index = sample * paths + path;
+            this->dimension = PATH_DIMENSION;
+        }
+
+        /*! This method skips to some dimension of the current point.
+         \param dimension The next dimension to draw. */
+        void SetDimension(uint32_t dimension) { this->dimension = dimension; }
+
+        /*! This method draws the next dimension of the current point.
+         \return Returns a number in [0, 1). */
+        virtual float Next1D() = 0;
+
+        /*! This method draws the next two dimensions of the current point, which are stratified jointly.
+         \param u1 The first number, in [0, 1).
+         \param u2 The second number, in [0, 1). */
+        virtual void Next2D(float* u1, float* u2) = 0;
+};
+
+/* This creates a sampler of some type, for a render seed. */
+Sampler* GetSampler(SamplerType type, uint32_t seed);
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef SOBOL_H
+#define SOBOL_H
+
+#include <samplers/sampler.hpp>
+
+/* This draws Owen-scrambled Sobol points, two dimensions at a time from the first two dimensions of the Sobol
+ * sequence. Each pair of dimensions (and each pixel) shuffles the points and scrambles their coordinates with its own
+ * seed, using hash-based nested uniform scrambling, which keeps them stratified in every power-of-two number of
+ * samples while decorrelating the pairs. This is Burley's "Practical Hash-based Owen Scrambling" (JCGT 2020). */
+class SobolSampler : public Sampler
+{
+    public:
+        /* Creates the sampler for a render seed. */
+        SobolSampler(uint32_t seed) : Sampler(seed) { }
+
+        /* This function returns the next dimension of the current point. */
+        virtual float Next1D();
+
+        /* This function returns the next two dimensions of the current point. */
+        virtual void Next2D(float* u1, float* u2);
+};
+
+#endif // SOBOL_H
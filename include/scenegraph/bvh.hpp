@@ -14,6 +14,12 @@ struct BVHFlatNode {
  uint32_t start, nPrims, rightOffset;
 };
 
+//! Number of nodes visited and primitives tested while tracing rays
+struct TraversalCost {
+ uint64_t nodes, primitives;
+ TraversalCost() : nodes(0), primitives(0) { }
+};
+
 //! \author Brandon Pelfrey
 //! A Bounding Volume Hierarchy system for fast Ray-Object intersection tests
 class BVH {
@@ -26,10 +32,41 @@ class BVH {
  // Fast Traversal System
  BVHFlatNode *flatTree;
 
+ //! Traversal, optionally counting its cost (this is a template so the normal traversal pays nothing for it)
+ template <bool Counted>
+ bool traverse(const Ray& ray, Intersection *intersection, bool occlusion, float maxDistance, TraversalCost *cost) const;
+
+ //! Nodes sorted by depth, deepest first, and where each depth starts in that list (for refitting)
+ std::vector<uint32_t> levelNodes, levelStarts;
+
+ //! SAH cost of the tree as it was built
+ float builtCost;
+
+ //! Sort the nodes by depth, and record the cost of the tree just built
+ void finishBuild();
+
 public:
  uint32_t nNodes, nLeafs;
  BVH(std::vector<Primitive*>* objects, uint32_t leafSize=4);
  bool getIntersection(const Ray& ray, Intersection *intersection, bool occlusion) const ;
+ //! Same as above, also adding the nodes visited and primitives tested to a cost
+ bool getIntersection(const Ray& ray, Intersection *intersection, bool occlusion, TraversalCost *cost) const ;
+ //! Whether anything intersects the ray closer than some distance along it (for visibility tests)
+ bool occluded(const Ray& ray, float distance) const ;
+
+ //! Update every node's bounds from the primitives' current bounds, bottom-up, keeping the
+ //! tree topology (for primitives which moved, but whose count and order didn't change)
+ void refit();
+ //! Build the tree again from scratch, out of the primitives' current positions
+ void rebuild();
+ //! Surface area heuristic cost of the tree (expected nodes visited plus primitives tested per
+ //! ray, for rays hitting the root), which grows as refitted nodes get looser and overlap more
+ float cost() const;
+ //! Current cost of the tree over its cost as built, 1 for a freshly built tree
+ float degradation() const;
+ //! Refit the tree, and rebuild it if it degraded by more than some factor.
+ //! Returns true if the tree was rebuilt.
+ bool update(float maxDegradation);
 
  ~BVH();
 };
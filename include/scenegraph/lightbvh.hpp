@@ -0,0 +1,80 @@
+/**
+ * @file lightbvh.hpp
+ *
+ * \brief Light bounding volume hierarchy
+ *
+ * This is a bounding volume hierarchy over the emissive primitives, which picks a light to illuminate a point with in
+ * proportion to an estimate of how much light each one sends to the point, rather than to its power alone. Each node
+ * holds the bounds and total power of its lights, and a light is picked by descending the tree from the root,
+ * choosing either child in proportion to its power over its squared distance to the point (clamped to its own size,
+ * so that nodes around the point don't dominate). Scenes with thousands of small lights then mostly pick the lights
+ * near each point, which are the ones that matter.
+ *
+ * Leaves hold a single light, and the tree is split at the median light along the longest axis of the lights'
+ * centroids, so it is balanced and the path of each light from the root fits in a 64-bit trail, from which the
+ * probability of picking it for a point is found without searching the tree.
+ */
+
+#ifndef LIGHTBVH_H
+#define LIGHTBVH_H
+
+#include <primitives/primitive.hpp>
+#include <util/aabb.hpp>
+#include <util/vec3.hpp>
+#include <vector>
+
+/*! This is a node of the light BVH. */
+struct LightNode
+{
+    /*! The bounds of the node's lights. */
+    AABB bounds;
+    /*! The total power of the node's lights. */
+    float power;
+    /*! The index of the light, for leaves, otherwise that of the second child (the first one follows the node). */
+    uint32_t index;
+    /*! Whether the node is a leaf. */
+    bool leaf;
+};
+
+/*! \class LightBVH
+ * This picks lights to illuminate points with. */
+class LightBVH
+{
+    private:
+        /*! The nodes, in depth-first order. */
+        std::vector<LightNode> nodes;
+        /*! The path of each light from the root, a bit per level from the lowest bit (set for second children). */
+        std::vector<uint64_t> trails;
+
+        /*! Builds the nodes over a range of lights, returning the index of the node, which is at some depth. */
+        uint32_t Build(std::vector<uint32_t>::iterator first, std::vector<uint32_t>::iterator last,
+                       const std::vector<AABB>& bounds, const std::vector<float>& powers, uint32_t depth,
+                       uint64_t trail);
+        /*! Returns how much a node is estimated to illuminate a point. */
+        float Importance(const LightNode& node, Vector point) const;
+    public:
+        /*! Creates an empty tree. */
+        LightBVH() { }
+
+        /*! Builds the tree over some lights.
+         \param lights The emissive primitives.
+         \param powers The power of each light. */
+        LightBVH(const std::vector<Primitive*>& lights, const std::vector<float>& powers);
+
+        /*! Picks a light to illuminate a point with.
+         \param point The point.
+         \param u A uniform number in [0, 1).
+         \param probability This is set to the probability of the picked light.
+         \return Returns the index of the light. */
+        uint32_t Sample(Vector point, float u, float* probability) const;
+
+        /*! Returns the probability of picking a light to illuminate a point with.
+         \param point The point.
+         \param light The index of the light. */
+        float Probability(Vector point, uint32_t light) const;
+
+        /*! Returns the number of nodes in the tree. */
+        size_t Nodes() const { return nodes.size(); }
+};
+
+#endif
@@ -20,6 +20,7 @@
 
 /* We need vector math and files. */
 #include <util/vec3.hpp>
+#include <util/arena.hpp>
 #include <iostream>
 #include <fstream>
 #include <vector>
@@ -37,7 +38,7 @@ class Distribution
         virtual float Lookup(float wavelength) = 0;
 };
 
-/* This creates the correct distribution type based on a scene file entity subtype. */
-Distribution* GetDistribution(uint32_t subtype, std::fstream& file);
+/* This creates the correct distribution type based on a scene file entity subtype, in an arena. */
+Distribution* GetDistribution(uint32_t subtype, std::fstream& file, Arena* arena);
 
 #endif
@@ -0,0 +1,57 @@
+/**
+ * @file accumulation.hpp
+ *
+ * \brief HDR accumulation buffers
+ *
+ * An accumulation buffer holds the unnormalized sum of the samples of each pixel, along with the number of samples
+ * summed, so that renders of different sample ranges of the same scene (on different machines, say) can be added
+ * together exactly and only then averaged, converted to RGB and tonemapped. The samples are kept as integrated XYZ
+ * colors with their total radiance (see ColorPipeline) since, unlike RGB colors, these are linear. The files are
+ * written in the machine's byte order, so they must be merged on machines of the same endianness.
+ */
+
+#ifndef ACCUMULATION_H
+#define ACCUMULATION_H
+
+#include <util/vec3.hpp>
+#include <util/cie.hpp>
+#include <string>
+#include <vector>
+
+/*! This is an accumulation buffer. */
+struct AccumulationBuffer
+{
+    /*! The width and height of the image. */
+    int32_t width, height;
+    /*! The color system the image is to be converted to RGB and tonemapped in. */
+    ColorSystem colorSystem;
+    /*! The sum of the samples of each pixel, from top to bottom, averaged over their wavelengths. */
+    std::vector<Vector> sums;
+    /*! The number of samples summed in each pixel. */
+    std::vector<uint32_t> counts;
+};
+
+/*! Saves an accumulation buffer to a file.
+ \param path The file to write.
+ \param buffer The accumulation buffer.
+ \return Returns false if the file could not be written. */
+bool SaveAccumulation(std::string path, const AccumulationBuffer& buffer);
+
+/*! Loads an accumulation buffer from a file.
+ \param path The file to read.
+ \param buffer This receives the accumulation buffer.
+ \return Returns false if the file could not be read, or is not an accumulation buffer. */
+bool LoadAccumulation(std::string path, AccumulationBuffer* buffer);
+
+/*! Adds an accumulation buffer to another.
+ \param buffer The accumulation buffer to add to.
+ \param other The accumulation buffer to add.
+ \return Returns false if the buffers are of different sizes or color systems, in which case nothing is added. */
+bool MergeAccumulation(AccumulationBuffer* buffer, const AccumulationBuffer& other);
+
+/*! Averages the samples of an accumulation buffer into linear RGB colors (pixels without samples are black).
+ \param buffer The accumulation buffer.
+ \param pixels This receives the pixel array, which must be as large as the image. */
+void ResolveAccumulation(const AccumulationBuffer& buffer, Vector* pixels);
+
+#endif
@@ -0,0 +1,51 @@
+/**
+ * @file alias.hpp
+ *
+ * \brief Alias tables
+ *
+ * An alias table samples an index from a discrete distribution in constant time, with Walker's alias method. Each
+ * index gets a slot of equal probability, holding the fraction of the slot which goes to that index, and another
+ * index (its alias) which gets the rest of the slot. Building the table takes linear time, with Vose's method.
+ */
+
+#ifndef ALIAS_H
+#define ALIAS_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+/*! \class AliasTable
+ * This samples indices in proportion to their weights. */
+class AliasTable
+{
+    private:
+        /*! The probability of each index. */
+        std::vector<float> probabilities;
+        /*! The fraction of each slot which goes to its own index, rather than its alias. */
+        std::vector<float> thresholds;
+        /*! The alias of each slot. */
+        std::vector<uint32_t> aliases;
+    public:
+        /*! Creates an empty table. */
+        AliasTable() { }
+
+        /*! Builds the table from some weights.
+         \param weights The weight of each index, which must be non-negative (if they are all zero, the indices are
+                        sampled uniformly). */
+        AliasTable(const std::vector<float>& weights);
+
+        /*! Samples an index.
+         \param u A uniform number in [0, 1).
+         \param probability If not null, this is set to the probability of the sampled index.
+         \return Returns the sampled index. */
+        uint32_t Sample(float u, float* probability = nullptr) const;
+
+        /*! Returns the probability of sampling an index. */
+        float Probability(uint32_t index) const { return probabilities[index]; }
+
+        /*! Returns the number of indices. */
+        size_t Size() const { return probabilities.size(); }
+};
+
+#endif
@@ -0,0 +1,80 @@
+/**
+ * @file arena.hpp
+ *
+ * \brief Arena allocator
+ *
+ * This is a bump allocator for scene entities, which carves objects out of large blocks instead of allocating each of
+ * them on the heap. Loading a scene of millions of triangles then costs a few block allocations rather than millions
+ * of small ones, the objects are packed contiguously in the order they were loaded (which is also roughly the order
+ * they are accessed in), and the whole scene is freed at once. Each kind of entity gets its own arena, so that the
+ * primitives, which are by far the most numerous, are not interleaved with anything else.
+ *
+ * The blocks can optionally be backed by huge pages (transparent huge pages, on Linux), which cuts the TLB misses of
+ * traversing large scenes. Objects allocated in an arena are never destroyed: their memory is released with the
+ * arena, without running their destructors, so they must not own any resources.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <vector>
+
+/* This is the alignment of every allocation, which is that of the SSE vectors. */
+#define ARENA_ALIGNMENT 16
+
+/* This is the size of a huge page, and the block size of arenas backed by huge pages. */
+#define HUGEPAGE_SIZE (2 * 1024 * 1024)
+
+/*! \class Arena
+ * This allocates objects out of large blocks, which are only freed along with the arena. It is not thread-safe. */
+class Arena
+{
+    private:
+        /*! The blocks allocated so far. */
+        std::vector<char*> blocks;
+        /*! The free space left in the current block. */
+        char *cursor, *end;
+        /*! The size of the blocks, and the memory allocated and used so far, in bytes. */
+        size_t blockSize, allocated, used;
+        /*! Whether the blocks are backed by huge pages. */
+        bool hugePages;
+
+        /*! Allocates a new block of some size. */
+        char* AllocateBlock(size_t size);
+
+        /*! Arenas can't be copied. */
+        Arena(const Arena&);
+        Arena& operator=(const Arena&);
+    public:
+        /*! Creates an empty arena.
+         \param blockSize The size of the blocks to allocate (larger allocations get a block of their own).
+         \param hugePages Whether to back the blocks with huge pages, in which case they are rounded up to the huge
+                          page size. If the system doesn't support huge pages, normal pages are used. */
+        Arena(size_t blockSize, bool hugePages = false);
+
+        /*! Allocates some memory, aligned to ARENA_ALIGNMENT bytes.
+         \param size The number of bytes to allocate.
+         \return Returns the allocated memory, which is only freed along with the arena. */
+        void* Allocate(size_t size);
+
+        /*! Returns the number of bytes allocated from the system. */
+        size_t Allocated() const { return allocated; }
+
+        /*! Returns the number of bytes handed out. */
+        size_t Used() const { return used; }
+
+        /*! Returns the number of blocks allocated from the system. */
+        size_t Blocks() const { return blocks.size(); }
+
+        /*! Frees every block, and so every object allocated in the arena. */
+        ~Arena();
+};
+
+/*! Allocates an object in an arena, as in "new (arena) Triangle(...)". */
+inline void* operator new(size_t size, Arena& arena) { return arena.Allocate(size); }
+
+/*! This is only called if the constructor of an object allocated in an arena throws (the memory is kept). */
+inline void operator delete(void*, Arena&) { }
+
+#endif
@@ -4,11 +4,68 @@
 #include <util/vec3.hpp>
 #include <algorithm>
 
-/* This is the resolution of the color-matching curves, in nanometers per sample. */
-#define RESOLUTION 5
+/* These are the bounds of the visible spectrum, in nanometers. */
+#define WAVELENGTH_MIN 380
+#define WAVELENGTH_MAX 780
 
-/* The number of wavelengths used per pixel sample. */
-#define WAVELENGTHS (1 + 400 / RESOLUTION)
+/* This is the native resolution of the color-matching curves, in nanometers per sample. */
+#define CIE_RESOLUTION 5
+
+/* The spectral resolutions the renderer is instantiated for, in nanometers per sample. */
+#define RESOLUTION_FINAL 5
+#define RESOLUTION_PREVIEW 10
+#define RESOLUTION_DRAFT 20
+
+/* Filters the color-matching curves down to a coarser resolution (this is a tent filter). */
+void FilterMatchingCurve(int resolution, Vector* curve);
+
+/* The fraction of wavelength samples drawn uniformly rather than by importance, so that the whole visible
+ * spectrum retains a nonzero probability density (the total radiance integrates over all of it). */
+#define WAVELENGTH_DEFENSIVE 0.1f
+
+/*! This importance-samples continuous wavelengths according to the sum of the color-matching curves, so that
+ * wavelengths which barely contribute to the final color (such as the far red) are traced less often. */
+class WavelengthSampler
+{
+    private:
+        /*! The cumulative distribution over each interval of the color-matching curves. */
+        float cdf[1 + (WAVELENGTH_MAX - WAVELENGTH_MIN) / CIE_RESOLUTION];
+    public:
+        /*! Builds the wavelength distribution from the color-matching curves. */
+        WavelengthSampler();
+
+        /*! Returns a wavelength, in nanometers, from a uniform random number.
+          \param u A uniform random number in [0, 1).
+          \param pdf This is set to the probability density of the wavelength, per nanometer. */
+        float Sample(float u, float* pdf) const;
+};
+
+/*! This is a spectral sampling grid, with a given resolution in nanometers per sample. The resolution must be a
+ * multiple of the color-matching curve resolution, and must evenly divide the visible spectrum. */
+template <int Resolution>
+struct SpectralGrid
+{
+    static_assert((Resolution % CIE_RESOLUTION == 0) && ((WAVELENGTH_MAX - WAVELENGTH_MIN) % Resolution == 0),
+                  "Unsupported spectral resolution.");
+
+    /*! The number of wavelengths used per pixel sample. */
+    static const int wavelengths = 1 + (WAVELENGTH_MAX - WAVELENGTH_MIN) / Resolution;
+
+    /*! Returns the wavelength of the w-th grid sample, in nanometers. */
+    static float Wavelength(int w) { return (float)(WAVELENGTH_MIN + Resolution * w); }
+
+    /*! Returns the color-matching curve filtered at this resolution, which is computed on first use. */
+    static const Vector* MatchingCurve()
+    {
+        static const struct Table
+        {
+            Vector curve[wavelengths];
+            Table() { FilterMatchingCurve(Resolution, curve); }
+        } table;
+
+        return table.curve;
+    }
+};
 
 /* These are some scene file definitions for color systems. */
 #define ID_EBU 0
@@ -47,8 +104,40 @@ const ColorSystem /* xRed    yRed    xGreen  yGreen  xBlue  yBlue    White point
 /* A static array of standard color systems. */
 const ColorSystem ColorSystems[6] = {EBUSystem, SMPTESystem, HDTVSystem, Rec709System, NTSCSystem, CIESystem};
 
-/* Converts a spectral radiance distribution to an RGB color. */
-Vector SpectrumToRGB(float spectralRadiance[WAVELENGTHS], ColorSystem colorSystem);
+/* Returns the color-matching curve at any wavelength in the visible spectrum (this is linearly interpolated). */
+Vector ColorMatching(float wavelength);
+
+/* The largest number of wavelengths in a spectrum, padded to a multiple of four for vectorization. */
+#define SPECTRUM_STRIDE (((1 + (WAVELENGTH_MAX - WAVELENGTH_MIN) / CIE_RESOLUTION) + 3) & ~3)
+
+/*! \class ColorPipeline
+ * This converts spectral radiance to RGB colors, for a given color system and spectral resolution. The XYZ to RGB
+ * matrix and the matching curves are baked once, so that whole tiles of spectra can be converted in batches.
+ *
+ * Colors are carried between the two stages as integrated XYZ values, with the total radiance they were integrated
+ * from in the fourth component. This representation is linear, so it can be summed over samples. */
+class ColorPipeline
+{
+    private:
+        /*! The XYZ to RGB matrix columns, scaled to the color system's white point. */
+        Vector matrix[3];
+        /*! The X, Y and Z matching curves followed by a row of ones, padded with zeros. */
+        float __attribute__((aligned(16))) curves[4][SPECTRUM_STRIDE];
+        /*! The number of wavelengths per spectrum, padded to a multiple of four. */
+        int stride;
+    public:
+        /*! Builds the pipeline for a color system, from a matching curve at some spectral resolution. */
+        ColorPipeline(ColorSystem colorSystem, const Vector* matchingCurve, int wavelengths);
+
+        /*! Returns the distance between consecutive spectra in a batch, which must be zero-padded. */
+        int Stride() const { return stride; }
+
+        /*! Integrates a batch of spectra (at 16-byte aligned addresses) into XYZ colors and total radiances. */
+        void Integrate(const float* spectra, size_t count, Vector* colors) const;
+
+        /*! Converts a batch of integrated colors to RGB colors, multiplied by some scale. */
+        void ToRGB(const Vector* colors, size_t count, Vector* rgb, float scale) const;
+};
 
 /* Returns the luminance of an RGB color according to a given color system. */
 float Luminance(Vector rgb, ColorSystem colorSystem);
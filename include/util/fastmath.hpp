@@ -0,0 +1,59 @@
+#ifndef FASTMATH_H
+#define FASTMATH_H
+
+/* This contains vectorized approximations of transcendental functions, four floats at a time. The logarithm is
+ * accurate to about 1e-4 (absolute) and the exponential to about 1e-7 (relative), which is plenty for image
+ * processing, but not for ray tracing. */
+
+#include <emmintrin.h>
+
+/* Returns the base 2 logarithm of four positive floats. */
+inline __m128 FastLog2(__m128 x)
+{
+    /* Split each float into its exponent, and its mantissa in [1, 2). */
+    __m128i bits = _mm_castps_si128(x);
+    __m128 exponent = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+    __m128 m = _mm_or_ps(_mm_castsi128_ps(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF))), _mm_set1_ps(1.0f));
+
+    /* Approximate log2(m) / (m - 1) with a minimax polynomial, in Horner form. */
+    __m128 p = _mm_set1_ps(0.0596515482674574969533f);
+    p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(-0.465725644288844778798f));
+    p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(1.48116647521213171641f));
+    p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(-2.52074962577807006663f));
+    p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(2.8882704548164776201f));
+
+    /* Recombine with the exponent. */
+    return _mm_add_ps(_mm_mul_ps(p, _mm_sub_ps(m, _mm_set1_ps(1.0f))), exponent);
+}
+
+/* Returns two to the power of four floats (the results are flushed to zero below 2^-126). */
+inline __m128 FastExp2(__m128 x)
+{
+    /* Clamp the input to the range of normalized floats. */
+    x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-126.0f)), _mm_set1_ps(127.99999f));
+
+    /* Split each input into an integer part, which goes in the exponent, and a fractional part in [0, 1]
+     * (rounding x - 0.5 to the nearest even integer floors it, or gives x - 1 for odd integers x). */
+    __m128i ipart = _mm_cvtps_epi32(_mm_sub_ps(x, _mm_set1_ps(0.5f)));
+    __m128 fpart = _mm_sub_ps(x, _mm_cvtepi32_ps(ipart));
+    __m128 expipart = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(ipart, _mm_set1_epi32(127)), 23));
+
+    /* Approximate 2^fpart with a minimax polynomial, in Horner form. */
+    __m128 p = _mm_set1_ps(1.8775767e-3f);
+    p = _mm_add_ps(_mm_mul_ps(p, fpart), _mm_set1_ps(8.9893397e-3f));
+    p = _mm_add_ps(_mm_mul_ps(p, fpart), _mm_set1_ps(5.5826318e-2f));
+    p = _mm_add_ps(_mm_mul_ps(p, fpart), _mm_set1_ps(2.4015361e-1f));
+    p = _mm_add_ps(_mm_mul_ps(p, fpart), _mm_set1_ps(6.9315308e-1f));
+    p = _mm_add_ps(_mm_mul_ps(p, fpart), _mm_set1_ps(9.9999994e-1f));
+
+    return _mm_mul_ps(expipart, p);
+}
+
+/* Returns four non-negative floats raised to some power (zero maps to a negligible positive value). */
+inline __m128 FastPow(__m128 x, float power)
+{
+    x = _mm_max_ps(x, _mm_set1_ps(1e-30f));
+    return FastExp2(_mm_mul_ps(FastLog2(x), _mm_set1_ps(power)));
+}
+
+#endif
@@ -0,0 +1,51 @@
+/**
+ * @file imageio.hpp
+ *
+ * \brief Image files
+ *
+ * These read and write linear RGB pixel arrays as Portable Float Maps (PFM), which store three little-endian
+ * floats per pixel with the rows from bottom to top. Unlike the tonemapped PPM output, these are lossless, so
+ * renders can be compared and processed further. Tonemapped renders are written as plain text PPM files.
+ */
+
+#ifndef IMAGEIO_H
+#define IMAGEIO_H
+
+#include <util/vec3.hpp>
+#include <string>
+#include <vector>
+
+/*! Saves a pixel array to a PFM file.
+ \param path The file to write.
+ \param pixels The pixel array, from top to bottom (only the first three components of each pixel are saved).
+ \param width The width of the image.
+ \param height The height of the image.
+ \return Returns false if the file could not be written. */
+bool SavePFM(std::string path, const Vector* pixels, int32_t width, int32_t height);
+
+/*! Saves a single-channel float array to a grayscale PFM file.
+ \param path The file to write.
+ \param values The values, from top to bottom.
+ \param width The width of the image.
+ \param height The height of the image.
+ \return Returns false if the file could not be written. */
+bool SavePFM(std::string path, const float* values, int32_t width, int32_t height);
+
+/*! Saves a tonemapped pixel array to a plain text PPM file.
+ \param path The file to write.
+ \param pixels The pixel array, from top to bottom, with components in [0, 1] (larger ones are clamped).
+ \param width The width of the image.
+ \param height The height of the image.
+ \param comment A comment to write in the header, one line per line of the comment.
+ \return Returns false if the file could not be written. */
+bool SavePPM(std::string path, const Vector* pixels, int32_t width, int32_t height, std::string comment);
+
+/*! Loads a pixel array from a PFM file.
+ \param path The file to read.
+ \param pixels This receives the pixel array, from top to bottom.
+ \param width This receives the width of the image.
+ \param height This receives the height of the image.
+ \return Returns false if the file could not be read, or is not a color PFM file. */
+bool LoadPFM(std::string path, std::vector<Vector>* pixels, int32_t* width, int32_t* height);
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef RTMATH_H
 #define RTMATH_H
 
+#include <stdint.h>
+
 /* This contains some extra math/utility definitions for ray tracing. */
 
 /* Delta function - equals 1 if x equals zero, 0 otherwise. Note the very generous delta epsilon. */
@@ -9,4 +11,14 @@
 /* Uniform number generation (for C++11 PRNG's only). */
 #define RandomVariable(x) (((*x)() - x->min()) / (float)x->max())
 
+/* Hashes a render seed with a pixel index and a sample index, to seed a PRNG for that pixel sample. The hash is
+ * a multiplicative mix followed by the MurmurHash3 finalizer, so nearby pixels and samples get unrelated seeds. */
+inline uint32_t SampleSeed(uint32_t seed, uint32_t pixel, uint32_t sample)
+{
+    uint32_t hash = seed ^ (pixel * 0x9E3779B1u) ^ (sample * 0x85EBCA77u);
+    hash ^= hash >> 16; hash *= 0x85EBCA6Bu;
+    hash ^= hash >> 13; hash *= 0xC2B2AE35u;
+    return hash ^ (hash >> 16);
+}
+
 #endif
@@ -0,0 +1,56 @@
+/**
+ * @file socket.hpp
+ *
+ * \brief TCP sockets
+ *
+ * This is a minimal blocking TCP socket, over BSD sockets or Winsock, which is all distributed rendering needs.
+ * Messages are sent as raw structures, so the coordinator and workers must run on machines of the same endianness.
+ */
+
+#ifndef SOCKET_H
+#define SOCKET_H
+
+#include <stdint.h>
+#include <string>
+
+/*! \class Socket
+ * This is a connected or listening TCP socket. */
+class Socket
+{
+    private:
+        /*! The operating system's socket handle. */
+        intptr_t handle;
+        /*! Wraps a socket handle. */
+        Socket(intptr_t handle) : handle(handle) { }
+    public:
+        /*! Connects to a listening socket.
+         \param host The host name or address to connect to.
+         \param port The port to connect to.
+         \return Returns the connected socket, or null on failure. */
+        static Socket* Connect(std::string host, uint16_t port);
+
+        /*! Listens for connections on every interface.
+         \param port The port to listen on.
+         \return Returns the listening socket, or null on failure. */
+        static Socket* Listen(uint16_t port);
+
+        /*! Waits for a connection on a listening socket.
+         \param timeout The longest time to wait, in milliseconds.
+         \return Returns the connected socket, or null if there was no connection in time. */
+        Socket* Accept(int32_t timeout);
+
+        /*! Sends some data, returning false if the connection was lost. */
+        bool Send(const void* data, size_t size);
+
+        /*! Receives exactly some amount of data, returning false if the connection was lost first. */
+        bool Receive(void* data, size_t size);
+
+        /*! Sets the longest time receiving waits for data, in milliseconds, after which it fails as if the connection
+         * was lost (by default, it waits forever). */
+        void SetTimeout(int32_t timeout);
+
+        /*! Closes the socket. */
+        ~Socket();
+};
+
+#endif
@@ -0,0 +1,111 @@
+/**
+ * @file statistics.hpp
+ *
+ * \brief Render statistics
+ *
+ * These are performance counters for the ray tracing kernels. They are only collected when compiled with the
+ * STATISTICS preprocessor definition (see the Profile build target), otherwise the counting macros expand to
+ * nothing. Each thread increments its own thread-local counters, which are summed once rendering is done, so
+ * there is no contention between threads.
+ */
+
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include <stdint.h>
+#include <string>
+
+/* This is the number of path lengths counted separately, longer paths being counted with the longest. */
+#define PATH_LENGTHS 16
+
+/*! These are the counters gathered during a render. */
+struct RenderStatistics
+{
+    /*! The number of light paths started, one per pixel sample and wavelength. */
+    uint64_t paths;
+    /*! The number of rays intersected with the scene. */
+    uint64_t rays;
+    /*! The number of bounding volume hierarchy nodes visited. */
+    uint64_t nodeVisits;
+    /*! The number of ray-box intersection tests. */
+    uint64_t boxTests;
+    /*! The number of ray-primitive intersection tests. */
+    uint64_t primitiveTests;
+    /*! The number of times a light path was scattered by a material. */
+    uint64_t bounces;
+    /*! The number of light paths terminated by russian roulette. */
+    uint64_t rouletteTerminations;
+    /*! The number of light paths cut short at the maximum depth. */
+    uint64_t depthTerminations;
+    /*! The number of path tracer paths (or branches of split paths) ending after each number of bounces. */
+    uint64_t pathLengths[PATH_LENGTHS];
+
+    /*! Creates a zeroed set of counters. */
+    RenderStatistics() : paths(0), rays(0), nodeVisits(0), boxTests(0), primitiveTests(0), bounces(0),
+                         rouletteTerminations(0), depthTerminations(0)
+    {
+        for (int t = 0; t < PATH_LENGTHS; ++t) pathLengths[t] = 0;
+    }
+
+    /*! Adds another set of counters to these. */
+    void operator+=(const RenderStatistics& other);
+};
+
+/*! This describes a finished render, along with its statistics, for reporting. */
+struct StatisticsReport
+{
+    /*! The scene file which was rendered. */
+    std::string scene;
+    /*! The render dimensions and samples per pixel. */
+    int32_t width, height, samples;
+    /*! The spectral resolution in nanometers, and the number of wavelengths traced per pixel sample. */
+    int32_t resolution, wavelengths;
+    /*! The number of threads used. */
+    size_t threads;
+    /*! The time spent raytracing, in seconds. */
+    double seconds;
+    /*! The time spent in the other phases (loading the scene, building the bounding volume hierarchy, denoising,
+     * tonemapping and gamma correction, and saving the render), in seconds. These are measured even without
+     * statistics. */
+    double loadSeconds, buildSeconds, tonemapSeconds, writeSeconds;
+    /*! The counters, summed over all threads. */
+    RenderStatistics counters;
+
+    /*! Creates an empty report. */
+    StatisticsReport() : width(0), height(0), samples(0), resolution(0), wavelengths(0), threads(0), seconds(0),
+                         loadSeconds(0), buildSeconds(0), tonemapSeconds(0), writeSeconds(0) { }
+};
+
+#ifdef STATISTICS
+/* These are the counters of the current thread. */
+extern thread_local RenderStatistics threadStatistics;
+
+/* Increments a counter of the current thread, or adds some amount to it. */
+#define STATISTIC(counter) (++threadStatistics.counter)
+#define STATISTIC_ADD(counter, amount) (threadStatistics.counter += (amount))
+
+/* Counts a path ending after some number of bounces. */
+#define STATISTIC_PATH_LENGTH(length) \
+    (++threadStatistics.pathLengths[((length) < PATH_LENGTHS) ? (length) : PATH_LENGTHS - 1])
+#else
+#define STATISTIC(counter) ((void)0)
+#define STATISTIC_ADD(counter, amount) ((void)0)
+#define STATISTIC_PATH_LENGTH(length) ((void)0)
+#endif
+
+/*! Returns whether statistics were compiled in. */
+bool StatisticsEnabled();
+
+/*! Takes the current thread's counters, and resets them to zero. */
+RenderStatistics CollectThreadStatistics();
+
+/*! Writes a statistics report in JSON format.
+ \param path The file to write the report to.
+ \param report The report to write.
+ \return Returns false if the file could not be created. */
+bool SaveStatistics(std::string path, const StatisticsReport& report);
+
+/*! Prints a short summary of a statistics report to the console. */
+void PrintStatistics(const StatisticsReport& report);
+
+#endif
@@ -0,0 +1,68 @@
+/**
+ * @file timeline.hpp
+ *
+ * \brief Render timeline
+ *
+ * This records when each phase of a render happens on each thread (scene parsing, BVH build, tiles, tonemapping and
+ * so on), and saves it in the Chrome trace event format, which chrome://tracing and Perfetto can display. Each thread
+ * writes its events into its own ring buffer, with no locks or shared cache lines, so recording is cheap enough to
+ * leave in release builds. When the timeline is not started, recording an event costs a single flag check.
+ */
+
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <stdint.h>
+#include <string>
+#include <atomic>
+
+/* The number of events each thread's ring buffer holds, after which the oldest events are overwritten. */
+#define TIMELINE_CAPACITY 65536
+
+/* Whether the timeline is recording (use TimelineEnabled to check). */
+extern std::atomic<bool> timelineEnabled;
+
+/*! Returns whether the timeline is recording. */
+inline bool TimelineEnabled() { return timelineEnabled.load(std::memory_order_relaxed); }
+
+/*! Returns the current time of the timeline, in nanoseconds. */
+int64_t TimelineClock();
+
+/*! Records an event on the current thread's timeline.
+ \param name The name of the event, which must be a string literal (only its address is kept).
+ \param start The time the event started at, from TimelineClock.
+ \param end The time the event ended at, from TimelineClock.
+ \param index An index to attach to the event (like the tile number), or negative if none. */
+void RecordTimelineEvent(const char* name, int64_t start, int64_t end, int32_t index);
+
+/*! Starts recording the timeline, discarding any previously recorded events. */
+void StartTimeline();
+
+/*! Stops recording the timeline, and saves it in the Chrome trace event format.
+ \param path The JSON file to write the timeline to.
+ \return Returns false if the file could not be created.
+ \remark No other thread may be recording events while the timeline is saved. */
+bool SaveTimeline(std::string path);
+
+/*! \class TimelineScope
+ * This records an event covering its own lifetime on the current thread's timeline. */
+class TimelineScope
+{
+    private:
+        /*! The event name and index. */
+        const char* name;
+        int32_t index;
+        /*! The time the event started at, or negative if the timeline is not recording. */
+        int64_t start;
+    public:
+        /*! Starts the event.
+         \param name The name of the event, which must be a string literal.
+         \param index An index to attach to the event, if any. */
+        TimelineScope(const char* name, int32_t index = -1) : name(name), index(index),
+                                                              start(TimelineEnabled() ? TimelineClock() : -1) { }
+
+        /*! Ends the event, and records it. */
+        ~TimelineScope() { if (start >= 0) RecordTimelineEvent(name, start, TimelineClock(), index); }
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include <cameras/camera.hpp>
+#include <cstdio>
 
 /* All camera types. */
 #include <cameras/perspective.hpp>
@@ -14,3 +15,68 @@ Camera* GetCamera(uint32_t subtype, std::fstream& file)
     /* Unknown subtype. */
     return nullptr;
 }
+
+/* This returns the poses of a camera orbiting its target at a constant height. */
+std::vector<CameraOverride> OrbitPoses(const CameraOverride& pose, int frames)
+{
+    std::vector<CameraOverride> poses(frames, pose);
+    Vector offset = pose.position - pose.target;
+    for (int t = 0; t < frames; ++t)
+    {
+        /* Rotate the camera's offset from its target around the vertical axis. */
+        float angle = 2.0f * PI * t / frames, c = cos(angle), s = sin(angle);
+        poses[t].position = pose.target + Vector(offset.x * c + offset.z * s, offset.y, offset.z * c - offset.x * s);
+    }
+
+    return poses;
+}
+
+/* This loads camera keyframes from a text file, and interpolates the poses of the frames between them. */
+bool LoadKeyframes(std::string path, std::vector<CameraOverride>* poses)
+{
+    FILE* file = fopen(path.c_str(), "r");
+    if (file == 0) return false;
+
+    /* Read every keyframe, skipping blank lines. */
+    std::vector<int> frames;
+    std::vector<CameraOverride> keyframes;
+    char line[256];
+    bool success = true;
+    while (success && fgets(line, sizeof(line), file))
+    {
+        int frame;
+        float p[3], t[3], fieldOfView;
+        int fields = sscanf(line, "%d %f,%f,%f %f,%f,%f %f", &frame, &p[0], &p[1], &p[2], &t[0], &t[1], &t[2],
+                            &fieldOfView);
+        if (fields <= 0) continue;
+
+        CameraOverride keyframe;
+        keyframe.hasPosition = keyframe.hasTarget = keyframe.hasFieldOfView = true;
+        keyframe.position = Vector(p[0], p[1], p[2]);
+        keyframe.target = Vector(t[0], t[1], t[2]);
+        keyframe.fieldOfView = fieldOfView * PI / 180.0f;
+        success = (fields == 8) && (frames.empty() || (frame > frames.back()));
+        frames.push_back(frame);
+        keyframes.push_back(keyframe);
+    }
+
+    fclose(file);
+    if (!success || keyframes.empty()) return false;
+
+    /* Interpolate linearly between consecutive keyframes. */
+    poses->clear();
+    poses->push_back(keyframes[0]);
+    for (size_t k = 1; k < keyframes.size(); ++k)
+        for (int frame = frames[k - 1] + 1; frame <= frames[k]; ++frame)
+        {
+            float t = (float)(frame - frames[k - 1]) / (frames[k] - frames[k - 1]);
+            CameraOverride pose = keyframes[k];
+            pose.position = lerp(keyframes[k - 1].position, keyframes[k].position, t);
+            pose.target = lerp(keyframes[k - 1].target, keyframes[k].target, t);
+            pose.fieldOfView = keyframes[k - 1].fieldOfView + (keyframes[k].fieldOfView
+                                                             - keyframes[k - 1].fieldOfView) * t;
+            poses->push_back(pose);
+        }
+
+    return true;
+}
@@ -18,18 +18,47 @@ Perspective::Perspective(std::fstream& file)
 
     /* Save the camera's position. */
     this->position = Vector(definition.pos[0], definition.pos[1], definition.pos[2]);
-    Vector target = Vector(definition.tar[0], definition.tar[1], definition.tar[2]);
+    this->target = Vector(definition.tar[0], definition.tar[1], definition.tar[2]);
+    this->fieldOfView = definition.fieldOfView;
 
     /* Build the focal plane. */
-    buildFocalPlane(target, definition.fieldOfView);
+    buildFocalPlane(target, fieldOfView);
+}
+
+/* Creates the perspective camera from its position and target, and field of view. */
+Perspective::Perspective(Vector position, Vector target, float fieldOfView)
+{
+    this->position = position;
+    this->target = target;
+    this->fieldOfView = fieldOfView;
+    buildFocalPlane(target, fieldOfView);
+}
+
+/* Returns the camera's position, target and field of view. */
+CameraOverride Perspective::Pose() const
+{
+    CameraOverride pose;
+    pose.hasPosition = pose.hasTarget = pose.hasFieldOfView = true;
+    pose.position = position;
+    pose.target = target;
+    pose.fieldOfView = fieldOfView;
+    return pose;
+}
+
+/* Returns a perspective camera with some of this camera's parameters overridden. */
+Camera* Perspective::Override(const CameraOverride& override) const
+{
+    return new Perspective(override.hasPosition ? override.position : position,
+                           override.hasTarget ? override.target : target,
+                           override.hasFieldOfView ? override.fieldOfView : fieldOfView);
 }
 
 void Perspective::buildFocalPlane(Vector target, float fieldOfView)
 {
     /* Define the orthonormal basis for this lookat vector. */
-    Vector zAxis = normalize(target - this->position);
-    Vector xAxis = normalize(UPWARDS ^ zAxis);
-    Vector yAxis = normalize(zAxis ^ xAxis);
+    zAxis = normalize(target - this->position);
+    xAxis = normalize(UPWARDS ^ zAxis);
+    yAxis = normalize(zAxis ^ xAxis);
 
     /* Compute the inverse view matrix from the orthonormal basis. */
     Vector inverseViewMatrix[3] = {
@@ -40,6 +69,7 @@ void Perspective::buildFocalPlane(Vector target, float fieldOfView)
 
     /* Scale the field of view accordingly. */
     float FOV = tan(fieldOfView * 0.5f);
+    this->scale = FOV;
 
     /* Compute the focal plane corners. */
     Vector multiplicand = Vector(-FOV, -FOV, 1);
@@ -71,3 +101,22 @@ Ray Perspective::Trace(float u, float v)
                normalize(lerp(lerp(this->focalPlane[0], this->focalPlane[1], (u + 1.0f) * 0.5f),
                               lerp(this->focalPlane[3], this->focalPlane[2], (u + 1.0f) * 0.5f), (1.0f - v) * 0.5f)));
 }
+
+/* Projects a point onto the screen. */
+float Perspective::Project(Vector point, float* u, float* v, Vector* origin)
+{
+    /* Find the point in the camera's basis, it can't be seen if it is behind the camera. */
+    Vector direction = point - this->position;
+    float z = direction * zAxis;
+    if (z <= 0.0f) return 0.0f;
+
+    /* This is the inverse of the interpolation across the focal plane in Trace. */
+    *u = (direction * xAxis) / (z * scale);
+    *v = -(direction * yAxis) / (z * scale);
+    *origin = this->position;
+
+    /* The focal plane is at unit distance, so a solid angle around a ray at an angle theta from the view axis covers
+     * cos^3(theta) times its area, and the screen coordinates span the focal plane's half-size per unit. */
+    float cosTheta = z / length(direction);
+    return 1.0f / (scale * scale * cosTheta * cosTheta * cosTheta);
+}
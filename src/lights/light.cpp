@@ -3,12 +3,12 @@
 /* All light types. */
 #include <lights/omni.hpp>
 
-/* This creates the correct light type based on a scene file entity subtype. */
-Light* GetLight(uint32_t subtype, std::fstream& file, std::vector<Distribution*>* distributions)
+/* This creates the correct light type based on a scene file entity subtype, in an arena. */
+Light* GetLight(uint32_t subtype, std::fstream& file, std::vector<Distribution*>* distributions, Arena* arena)
 {
     switch(subtype)
     {
-        case ID_OMNI: return new Omni(file, distributions);
+        case ID_OMNI: return new (*arena) Omni(file, distributions);
     }
 
     /* Unknown subtype. */
@@ -1,9 +1,19 @@
 #include <renderer/renderer.hpp>
+#include <renderer/server.hpp>
+#include <cstring>
 
-using namespace std;
-
-int main(int argc, char* argv[])
+using namespace std;
+
+int main(int argc, char* argv[])
 {
+    /* In server mode, run the jobs of a job directory with the given number of threads. */
+    if ((argc > 2) && !strcmp(argv[1], "--serve"))
+    {
+        RenderServer server((argc > 3) ? atoi(argv[3]) : 0);
+        server.Serve(argv[2]);
+        return 0;
+    }
+
     /* Ask the user for a scene file if not passed. */
     string sceneFile;
     if (argc > 3) sceneFile = argv[1]; else
@@ -28,16 +38,31 @@ int main(int argc, char* argv[])
         cin >> threadCount;
     }
 
+    /* Read any additional render settings. */
+    RenderSettings settings;
+    if ((argc > 4) && !ParseSettings(vector<string>(argv + 4, argv + argc), &settings)) return 1;
+
     /* Line break (this is just for aesthetics). */
     if (argc <= 3) cout << endl;
 
+    /* Start recording the timeline before loading the scene, if requested. */
+    if (!settings.timeline.empty()) StartTimeline();
+
     /* Initialize the renderer. */
-    Renderer* renderer = new Renderer(sceneFile);
+    Renderer* renderer = new Renderer(sceneFile, settings.hugePages);
+
+    /* Render the scene, unless working for a coordinator. */
+    if (!settings.worker.empty()) renderer->Work(settings.worker, threadCount);
+    else renderer->Render(renderFile, threadCount, settings);
 
-    /* Render the scene. */
-    renderer->Render(renderFile, threadCount);
+    /* Save the timeline. */
+    if (!settings.timeline.empty())
+    {
+        if (SaveTimeline(settings.timeline)) cout << "[+] Timeline saved in <" << settings.timeline << ">." << endl;
+        else cout << "[!] Failed to save the timeline in <" << settings.timeline << ">." << endl;
+    }
 
     /* Free everything. */
-    delete renderer;
-    return 0;
-}
+    delete renderer;
+    return 0;
+}
@@ -23,7 +23,7 @@ CookTorrance::CookTorrance(std::fstream& file, std::vector<Distribution*>* distr
     this->roughness = definition.roughness;
 }
 
-Vector CookTorrance::Sample(Vector* origin, Vector incident, Vector normal, float wavelength, std::mt19937* prng)
+Vector CookTorrance::Sample(Vector* origin, Vector incident, Vector normal, float wavelength, Sampler* sampler)
 {
     /* Align the normal with the incident vector. */
     if (incident * normal > 0.0f) normal = ZERO - normal;
@@ -32,8 +32,8 @@ Vector CookTorrance::Sample(Vector* origin, Vector incident, Vector normal, floa
     (*origin) = (*origin) + normal * EPSILON;
 
     /* Generate a random microfacet normal based on the Beckmann distribution with the given roughness. */
-    float r1 = RandomVariable(prng);
-    float r2 = RandomVariable(prng);
+    float r1, r2;
+    sampler->Next2D(&r1, &r2);
     float theta = atan(-pow(this->roughness, 2.0f) * log(1.0f - r1));
     float phi = 2.0f * PI * r2;
     Vector m = spherical(phi, theta);
@@ -88,5 +88,41 @@ float CookTorrance::Reflectance(Vector incident, Vector exitant, Vector normal,
     return norm * this->reflectance->Lookup(wavelength) * (F * D * G) / (NdV);
 }
 
+/* This returns the scattering function for an incident and exitant vector. */
+float CookTorrance::Evaluate(Vector incident, Vector exitant, Vector normal, float wavelength)
+{
+    /* This is a BRDF, so light is only reflected back to the side it came from. */
+    float cosO = std::abs(exitant * normal);
+    if (((incident * normal) * (exitant * normal) >= 0.0f) || (cosO <= 0.0f)) return 0.0f;
+
+    /* The reflectance of sampled vectors already has the sampling density divided out, so multiply it back. */
+    return Reflectance(incident, exitant, normal, wavelength, true) * Density(incident, exitant, normal, wavelength) / cosO;
+}
+
+/* This returns the density of sampling an exitant vector. */
+float CookTorrance::Density(Vector incident, Vector exitant, Vector normal, float wavelength)
+{
+    /* Align the normal with the incident vector. */
+    if (incident * normal > 0.0f) normal = ZERO - normal;
+
+    /* Find the microfacet normal which reflects the incident vector into the exitant vector. */
+    Vector m = normalize(exitant - incident);
+    if (m * normal < 0.0f) m = ZERO - m;
+    float cosTheta = std::min(m * normal, 1.0f);
+    float sinTheta = sqrtf(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+    if ((cosTheta <= 0.0f) || (sinTheta <= 0.0f)) return 0.0f;
+
+    /* Sample draws tan(theta) from an exponential distribution of mean roughness squared, and phi uniformly. */
+    float alpha2 = pow(this->roughness, 2.0f);
+    float thetaDensity = exp(-(sinTheta / cosTheta) / alpha2) / (alpha2 * cosTheta * cosTheta);
+    float microfacetDensity = thetaDensity / (2.0f * PI * sinTheta);
 
+    /* Account for the change of variables from the microfacet normal to the reflected vector. */
+    return microfacetDensity / (4.0f * std::abs(incident * m));
+}
 
+/* This returns the albedo of the material at a wavelength. */
+float CookTorrance::Albedo(float wavelength)
+{
+    return std::max(this->reflectance->Lookup(wavelength), 0.0f);
+}
@@ -19,7 +19,7 @@ Diffuse::Diffuse(std::fstream& file, std::vector<Distribution*>* distributions)
     this->reflectance = distributions->at(definition.reflectance);
 }
 
-Vector Diffuse::Sample(Vector* origin, Vector incident, Vector normal, float wavelength, std::mt19937* prng)
+Vector Diffuse::Sample(Vector* origin, Vector incident, Vector normal, float wavelength, Sampler* sampler)
 {
     /* Align the normal with the incident vector. */
     if (incident * normal > 0.0f) normal = ZERO - normal;
@@ -28,8 +28,8 @@ Vector Diffuse::Sample(Vector* origin, Vector incident, Vector normal, float wav
     (*origin) = (*origin) + normal * EPSILON;
 
     /* Get two random numbers. */
-    float u1 = RandomVariable(prng);
-    float u2 = RandomVariable(prng);
+    float u1, u2;
+    sampler->Next2D(&u1, &u2);
 
     /* Compute a cosine-weighted vector. */
     float theta = 2.0f * PI * u2;
@@ -61,3 +61,25 @@ float Diffuse::Reflectance(Vector incident, Vector exitant, Vector normal, float
 
 
 }
+
+/* This returns the scattering function for an incident and exitant vector. */
+float Diffuse::Evaluate(Vector incident, Vector exitant, Vector normal, float wavelength)
+{
+    /* Light is only reflected back to the side it came from. */
+    if ((incident * normal) * (exitant * normal) >= 0.0f) return 0.0f;
+    return std::max(this->reflectance->Lookup(wavelength), 0.0f) / PI;
+}
+
+/* This returns the density of sampling an exitant vector. */
+float Diffuse::Density(Vector incident, Vector exitant, Vector normal, float wavelength)
+{
+    /* The exitant vectors are cosine-weighted, on the incident vector's side. */
+    if ((incident * normal) * (exitant * normal) >= 0.0f) return 0.0f;
+    return std::abs(exitant * normal) / PI;
+}
+
+/* This returns the albedo of the material at a wavelength. */
+float Diffuse::Albedo(float wavelength)
+{
+    return std::max(this->reflectance->Lookup(wavelength), 0.0f);
+}
@@ -22,11 +22,11 @@ FrostedGlass::FrostedGlass(std::fstream& file, std::vector<Distribution*>* distr
     this->roughness = definition.roughness;
 }
 
-Vector FrostedGlass::Sample(Vector* origin, Vector incident, Vector normal, float wavelength, std::mt19937* prng)
+Vector FrostedGlass::Sample(Vector* origin, Vector incident, Vector normal, float wavelength, Sampler* sampler)
 {
     /* Generate a random microfacet normal based on the Beckmann distribution with the given roughness. */
-    float r1 = RandomVariable(prng);
-    float r2 = RandomVariable(prng);
+    float r1, r2;
+    sampler->Next2D(&r1, &r2);
     float theta = atan(-pow(this->roughness, 2.0f) * log(1.0f - r1));
     float phi = 2.0f * PI * r2;
     Vector m = spherical(phi, theta);
@@ -74,7 +74,7 @@ Vector FrostedGlass::Sample(Vector* origin, Vector incident, Vector normal, floa
     float R = (pow((n1 * cosI - n2 * cosT) / (n1 * cosI + n2 * cosT), 2.0f) + pow((n2 * cosI - n1 * cosT) / (n1 * cosT + n2 * cosI), 2.0f)) * 0.5f;
 
     /* Perform a random trial to decide whether to reflect or refract the ray. */
-    if (RandomVariable(prng) < R)
+    if (sampler->Next1D() < R)
     {
         /* Reflection. */
         (*origin) = (*origin) + m * EPSILON;
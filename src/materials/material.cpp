@@ -26,16 +26,16 @@ Material::Material(std::fstream& file)
     this->e2 = definition.e2;
 }
 
-/* This creates the correct material type based on a scene file entity subtype. */
-Material* GetMaterial(uint32_t subtype, std::fstream& file, std::vector<Distribution*>* distributions)
+/* This creates the correct material type based on a scene file entity subtype, in an arena. */
+Material* GetMaterial(uint32_t subtype, std::fstream& file, std::vector<Distribution*>* distributions, Arena* arena)
 {
     switch(subtype)
     {
-        case ID_DIFFUSE: return new Diffuse(file, distributions);
-        case ID_SPECULAR: return new Specular(file, distributions);
-        case ID_SMOOTHGLASS: return new SmoothGlass(file, distributions);
-        case ID_FROSTEDGLASS: return new FrostedGlass(file, distributions);
-        case ID_COOKTORRANCE: return new CookTorrance(file, distributions);
+        case ID_DIFFUSE: return new (*arena) Diffuse(file, distributions);
+        case ID_SPECULAR: return new (*arena) Specular(file, distributions);
+        case ID_SMOOTHGLASS: return new (*arena) SmoothGlass(file, distributions);
+        case ID_FROSTEDGLASS: return new (*arena) FrostedGlass(file, distributions);
+        case ID_COOKTORRANCE: return new (*arena) CookTorrance(file, distributions);
     }
 
     /* Unknown subtype. */
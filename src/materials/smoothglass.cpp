@@ -19,7 +19,7 @@ SmoothGlass::SmoothGlass(std::fstream& file, std::vector<Distribution*>* distrib
     this->refractiveIndex = distributions->at(definition.refractiveIndex);
 }
 
-Vector SmoothGlass::Sample(Vector* origin, Vector incident, Vector normal, float wavelength, std::mt19937* prng)
+Vector SmoothGlass::Sample(Vector* origin, Vector incident, Vector normal, float wavelength, Sampler* sampler)
 {
     /* Work out the correct n1 and n2 depending on the incident vector's direction relative to the normal. */
     float cosI = incident * normal;
@@ -61,7 +61,7 @@ Vector SmoothGlass::Sample(Vector* origin, Vector incident, Vector normal, float
     float R = (pow((n1 * cosI - n2 * cosT) / (n1 * cosI + n2 * cosT), 2.0f) + pow((n2 * cosI - n1 * cosT) / (n1 * cosT + n2 * cosI), 2.0f)) * 0.5f;
 
     /* Perform a random trial to decide whether to reflect or refract the ray. */
-    if (RandomVariable(prng) < R)
+    if (sampler->Next1D() < R)
     {
         /* Reflection. */
         (*origin) = (*origin) + normal * EPSILON;
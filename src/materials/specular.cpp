@@ -19,7 +19,7 @@ Specular::Specular(std::fstream& file, std::vector<Distribution*>* distributions
     this->reflectance = distributions->at(definition.reflectance);
 }
 
-Vector Specular::Sample(Vector* origin, Vector incident, Vector normal, float wavelength, std::mt19937* prng)
+Vector Specular::Sample(Vector* origin, Vector incident, Vector normal, float wavelength, Sampler* sampler)
 {
     /* Align the normal with the incident vector. */
     if (incident * normal > 0) normal = ZERO - normal;
@@ -51,3 +51,8 @@ float Specular::Reflectance(Vector incident, Vector exitant, Vector normal, floa
     }
 }
 
+/* This returns the albedo of the material at a wavelength. */
+float Specular::Albedo(float wavelength)
+{
+    return std::max(this->reflectance->Lookup(wavelength), 0.0f);
+}
@@ -25,13 +25,13 @@ Primitive::Primitive(std::fstream& file, std::vector<Material*>* materials, std:
     this->light = (definition.light >= 0) ? lights->at(definition.light) : nullptr;
 }
 
-/* This creates the correct primitive type based on a scene file entity subtype. */
-Primitive* GetPrimitive(uint32_t subtype, std::fstream& file, std::vector<Material*>* materials, std::vector<Light*>* lights)
+/* This creates the correct primitive type based on a scene file entity subtype, in an arena. */
+Primitive* GetPrimitive(uint32_t subtype, std::fstream& file, std::vector<Material*>* materials, std::vector<Light*>* lights, Arena* arena)
 {
     switch(subtype)
     {
-        case ID_SPHERE: return new Sphere(file, materials, lights);
-        case ID_TRIANGLE: return new Triangle(file, materials, lights);
+        case ID_SPHERE: return new (*arena) Sphere(file, materials, lights);
+        case ID_TRIANGLE: return new (*arena) Triangle(file, materials, lights);
     }
 
     /* Unknown subtype. */
@@ -16,8 +16,20 @@ Sphere::Sphere(std::fstream& file, std::vector<Material*>* materials, std::vecto
     file.read((char*)&definition, sizeof(SphereDefinition));
 
     /* Read the geometric center and radius of the sphere. */
-    this->center = Vector(definition.center[0], definition.center[1], definition.center[2]);
-    this->radius = definition.radius;
+    Initialize(Vector(definition.center[0], definition.center[1], definition.center[2]), definition.radius);
+}
+
+/* Creates the sphere from its center and radius. */
+Sphere::Sphere(Vector center, float radius, Material* material, Light* light) : Primitive(material, light)
+{
+    Initialize(center, radius);
+}
+
+/* Sets up the sphere from its center and radius. */
+void Sphere::Initialize(Vector center, float radius)
+{
+    this->center = center;
+    this->radius = radius;
 
     /* Compute the sphere's radius squared. */
     this->radiusSquared = this->radius * this->radius;
@@ -84,3 +96,13 @@ Vector Sphere::Normal(Vector point)
 {
     return (point - this->center) / this->radius;
 }
+
+/* Returns a uniformly distributed point on the sphere. */
+Vector Sphere::SamplePoint(float u1, float u2)
+{
+    /* By Archimedes' hat-box theorem, the height of a uniform point on the sphere is itself uniform. */
+    float z = 1.0f - 2.0f * u1;
+    float r = sqrtf(std::max(0.0f, 1.0f - z * z));
+    float phi = 2.0f * PI * u2;
+    return this->center + Vector(r * cosf(phi), r * sinf(phi), z) * this->radius;
+}
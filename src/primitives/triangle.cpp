@@ -16,14 +16,29 @@ Triangle::Triangle(std::fstream& file, std::vector<Material*>* materials, std::v
     file.read((char*)&definition, sizeof(TriangleDefinition));
 
     /* Read the vertices from the definition. */
-    this->p1 = Vector(definition.p1[0], definition.p1[1], definition.p1[2]);
-    this->p2 = Vector(definition.p2[0], definition.p2[1], definition.p2[2]);
-    this->p3 = Vector(definition.p3[0], definition.p3[1], definition.p3[2]);
+    Initialize(Vector(definition.p1[0], definition.p1[1], definition.p1[2]),
+               Vector(definition.p2[0], definition.p2[1], definition.p2[2]),
+               Vector(definition.p3[0], definition.p3[1], definition.p3[2]));
+}
+
+/* Creates the triangle from its three vertices. */
+Triangle::Triangle(Vector p1, Vector p2, Vector p3, Material* material, Light* light) : Primitive(material, light)
+{
+    Initialize(p1, p2, p3);
+}
+
+/* Sets up the triangle from its three vertices. */
+void Triangle::Initialize(Vector p1, Vector p2, Vector p3)
+{
+    this->p1 = p1;
+    this->p2 = p2;
+    this->p3 = p3;
 
     /* Precompute the normal and edges. */
     edge1 = this->p2 - this->p1;
     edge2 = this->p3 - this->p1;
     normal = normalize(edge1 ^ edge2);
+    area = 0.5f * length(edge1 ^ edge2);
 
     /* Compute the triangle's bounding box. */
     Vector lo = Vector(std::min(this->p1.x, std::min(this->p2.x, this->p3.x)),
@@ -37,6 +52,7 @@ Triangle::Triangle(std::fstream& file, std::vector<Material*>* materials, std::v
     /* Compute the triangle's centroid. */
     this->centroid = (this->p1 + this->p2 + this->p3) / 3.0f;
 }
+
 /* Returns the closest intersection of a ray with the triangle, returns a negative value if no intersection. */
 float Triangle::Intersect(const Ray& ray)
 {
@@ -67,3 +83,11 @@ Vector Triangle::Normal(Vector point)
 {
     return normal;
 }
+
+/* Returns a uniformly distributed point on the triangle. */
+Vector Triangle::SamplePoint(float u1, float u2)
+{
+    /* Fold the unit square onto the triangle's barycentric coordinates, without distorting the area. */
+    float s = sqrtf(u1);
+    return this->p1 + edge1 * (s * (1.0f - u2)) + edge2 * (s * u2);
+}
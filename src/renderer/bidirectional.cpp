@@ -0,0 +1,423 @@
+/* This is the bidirectional path tracer (see bidirectional.hpp). It follows the formulation of Veach's thesis, with
+ * each light path built from a camera subpath and a light subpath, and the balance heuristic computed incrementally
+ * from the densities of each vertex being sampled from either side of its subpath. Everything is per wavelength, so
+ * throughputs and densities are scalars. */
+
+#include <renderer/renderer.hpp>
+#include <algorithm>
+
+using namespace std;
+
+/* The bounce dimensions of the sampler are dealt out in turn to the camera subpath's bounces, to the lights picked for
+ * the direct connections of its vertices, and to the light subpath: its start draws the emitter and the point on it,
+ * then the direction it is emitted in, then its bounces. */
+#define CAMERA_DIMENSION(bounce) BOUNCE_DIMENSION(3 * (bounce))
+#define DIRECT_DIMENSION(bounce) BOUNCE_DIMENSION(3 * (bounce) + 1)
+#define EMITTER_DIMENSION BOUNCE_DIMENSION(2)
+#define EMISSION_DIMENSION BOUNCE_DIMENSION(5)
+#define LIGHT_DIMENSION(bounce) BOUNCE_DIMENSION(3 * (bounce) + 8)
+
+/* Converts a density per unit solid angle of sampling a direction at a vertex into a density per unit area of the
+ * vertex it leads to. */
+static float AreaDensity(float pdfDir, const PathVertex& from, const PathVertex& to)
+{
+    Vector direction = to.point - from.point;
+    float distance2 = direction * direction;
+    return pdfDir * abs(to.normal * direction) / (distance2 * sqrtf(distance2));
+}
+
+/* Returns the density of a light vertex emitting in a direction, per unit solid angle. Lights emit on both sides of
+ * their surface, and the side is chosen uniformly. */
+static float EmissionDensity(const PathVertex& light, Vector direction)
+{
+    return abs(light.normal * direction) / (2.0f * PI);
+}
+
+/* Returns the density of a vertex's material sampling the direction toward a point, for light which arrived at it
+ * from another point. */
+static float ScatteringDensity(const PathVertex& vertex, Vector from, Vector to, float wavelength)
+{
+    return vertex.primitive->material->Density(normalize(vertex.point - from), normalize(to - vertex.point),
+                                               vertex.normal, wavelength);
+}
+
+/* Returns a vertex's scattering function, toward a point on the camera side of the path, of the light arriving from
+ * a point on the light side (in the path tracer's convention, the incident vector comes from the camera side). */
+static float Scattering(const PathVertex& vertex, Vector cameraSide, Vector lightSide, float wavelength)
+{
+    return vertex.primitive->material->Evaluate(normalize(vertex.point - cameraSide),
+                                                normalize(lightSide - vertex.point), vertex.normal, wavelength);
+}
+
+/* Returns the fraction of the light transmitted between two vertices by the medium it travels through, with the
+ * Beer-Lambert law. As in the path tracer, the medium is that of the material on the light side of the segment. */
+static float Transmittance(const PathVertex& cameraSide, const PathVertex& lightSide)
+{
+    if (!lightSide.primitive || lightSide.primitive->light || !lightSide.primitive->material) return 1.0f;
+
+    Vector direction = lightSide.point - cameraSide.point;
+    Material* material = lightSide.primitive->material;
+    return exp(-length(direction) * ((direction * lightSide.normal > 0.0f) ? material->e2 : material->e1));
+}
+
+/* Moves a vertex slightly off its surface, on the side of some direction, to prevent self-intersection. */
+static Vector Offset(const PathVertex& vertex, Vector direction)
+{
+    if (!vertex.primitive) return vertex.point;
+    return vertex.point + vertex.normal * ((vertex.normal * direction > 0.0f) ? EPSILON : -EPSILON);
+}
+
+/* Returns whether two vertices can see each other. */
+static bool Visible(const BVH* bvh, const PathVertex& a, const PathVertex& b)
+{
+    Vector origin = Offset(a, b.point - a.point);
+    Vector direction = Offset(b, a.point - b.point) - origin;
+    float distance = length(direction);
+    return !bvh->occluded(Ray(origin, direction / distance), distance);
+}
+
+/* Zero densities are those of vertices sampled through materials which can't be connected through, and they cancel
+ * out of the density ratios. */
+static float Remap0(float density)
+{
+    return (density != 0.0f) ? density : 1.0f;
+}
+
+void Renderer::TraceSubpath(vector<PathVertex>* path, Ray ray, float beta, float pdfDir, float wavelength,
+                            Sampler* sampler, bool fromCamera)
+{
+    for (uint32_t bounce = 0; ; ++bounce)
+    {
+        /* Intersect the ray with the scene. */
+        Intersection intersection;
+        if (!bvh->getIntersection(ray, &intersection, false)) return;
+
+        /* Make a vertex of the intersection, attenuated by the medium it was reached through. */
+        PathVertex vertex;
+        vertex.point = ray.o + ray.d * intersection.t;
+        vertex.primitive = intersection.primitive;
+        vertex.normal = vertex.primitive->Normal(vertex.point);
+        vertex.pdfRev = 0.0f;
+        vertex.delta = false;
+        float transmittance = fromCamera ? Transmittance(path->back(), vertex) : Transmittance(vertex, path->back());
+        vertex.beta = beta * transmittance;
+        vertex.pdfFwd = AreaDensity(pdfDir, path->back(), vertex);
+
+        /* Segments too short to have a density (self-intersections, where floating-point precision runs out on
+         * large primitives) end the subpath. */
+        if (!isfinite(vertex.pdfFwd)) return;
+
+        /* Camera subpaths end on lights, and light subpaths can't go on from them (lights don't reflect). */
+        if (vertex.primitive->light)
+        {
+            if (fromCamera) path->push_back(vertex);
+            return;
+        }
+
+        path->push_back(vertex);
+
+        /* Sample the material, as in the path tracer. */
+        Material* material = vertex.primitive->material;
+        uint32_t dimension = fromCamera ? CAMERA_DIMENSION(bounce) : LIGHT_DIMENSION(bounce);
+        sampler->SetDimension(dimension);
+        Vector origin = vertex.point;
+        Vector exitant = normalize(material->Sample(&origin, ray.d, vertex.normal, wavelength, sampler));
+        STATISTIC(bounces);
+
+        /* Find the densities of sampling the exitant vector, and of sampling the previous vertex the other way. */
+        float pdfRevDir = 0.0f;
+        pdfDir = 0.0f;
+        if (material->Connectable())
+        {
+            pdfDir = material->Density(ray.d, exitant, vertex.normal, wavelength);
+            pdfRevDir = material->Density(ZERO - exitant, ZERO - ray.d, vertex.normal, wavelength);
+        }
+        else path->back().delta = true;
+
+        (*path)[path->size() - 2].pdfRev = AreaDensity(pdfRevDir, path->back(), (*path)[path->size() - 2]);
+
+        /* Light subpaths carry importance from the camera rather than radiance, so their directions are swapped when
+         * evaluating the scattering function (the reflectance of other materials is assumed to be symmetric). */
+        float weight;
+        if (fromCamera || !material->Connectable())
+            weight = material->Reflectance(ray.d, exitant, vertex.normal, wavelength, true);
+        else weight = (pdfDir > 0.0f) ? material->Evaluate(ZERO - exitant, ZERO - ray.d, vertex.normal, wavelength)
+                                        * abs(exitant * vertex.normal) / pdfDir : 0.0f;
+
+        /* Russian roulette, with the same survival probability as in the path tracer (which includes the medium's
+         * absorption, otherwise paths trapped in glass by total internal reflection would go on forever). */
+        sampler->SetDimension(dimension + BOUNCE_DIMENSIONS - 1);
+        weight *= transmittance;
+        float survival = min(weight, 1.0f);
+        if (!(sampler->Next1D() < survival))
+        {
+            STATISTIC(rouletteTerminations);
+            return;
+        }
+
+        /* Go to the next ray bounce. */
+        beta *= weight / survival;
+        ray = Ray(origin, exitant);
+    }
+}
+
+float Renderer::ConnectionWeight(BidirectionalPaths* paths, int s, int t, float wavelength)
+{
+    /* Lights seen directly are only found by the camera subpath. */
+    if (s + t == 2) return 1.0f;
+
+    vector<PathVertex>& cameraPath = paths->camera;
+    vector<PathVertex>& lightPath = paths->light;
+    PathVertex* pt = &cameraPath[t - 1];
+    PathVertex* ptMinus = (t > 1) ? &cameraPath[t - 2] : nullptr;
+    PathVertex* qs = (s > 0) ? &lightPath[s - 1] : nullptr;
+    PathVertex* qsMinus = (s > 1) ? &lightPath[s - 2] : nullptr;
+
+    /* Set the reverse densities of the vertices around the connection, which depend on it, and restore them once
+     * done (the other vertices were already set while tracing the subpaths). */
+    float saved[4] = {pt->pdfRev, ptMinus ? ptMinus->pdfRev : 0.0f, qs ? qs->pdfRev : 0.0f,
+                      qsMinus ? qsMinus->pdfRev : 0.0f};
+
+    if (s == 0) pt->pdfRev = EmitterDensity(pt->primitive);
+    else if (s == 1) pt->pdfRev = AreaDensity(EmissionDensity(*qs, normalize(pt->point - qs->point)), *qs, *pt);
+    else pt->pdfRev = AreaDensity(ScatteringDensity(*qs, qsMinus->point, pt->point, wavelength), *qs, *pt);
+
+    if (ptMinus)
+    {
+        if (s == 0) ptMinus->pdfRev = AreaDensity(EmissionDensity(*pt, normalize(ptMinus->point - pt->point)),
+                                                  *pt, *ptMinus);
+        else ptMinus->pdfRev = AreaDensity(ScatteringDensity(*pt, qs->point, ptMinus->point, wavelength),
+                                           *pt, *ptMinus);
+    }
+
+    if (qs)
+    {
+        if (t == 1)
+        {
+            float u, v;
+            Vector origin;
+            float screenArea = 4.0f * (float)renderParams.width / renderParams.height;
+            qs->pdfRev = AreaDensity(camera->Project(qs->point, &u, &v, &origin) / screenArea, *pt, *qs);
+        }
+        else qs->pdfRev = AreaDensity(ScatteringDensity(*pt, ptMinus->point, qs->point, wavelength), *pt, *qs);
+    }
+
+    if (qsMinus) qsMinus->pdfRev = AreaDensity(ScatteringDensity(*qs, pt->point, qsMinus->point, wavelength),
+                                               *qs, *qsMinus);
+
+    /* Add up the ratios of the densities of the other strategies to this one's, moving the connection towards the
+     * camera and then towards the light. Strategies connecting through a vertex which is not connectable can't
+     * happen, and are skipped. */
+    float sumRi = 0.0f, ri = 1.0f;
+    for (int i = t - 1; i > 0; --i)
+    {
+        ri *= Remap0(cameraPath[i].pdfRev) / Remap0(cameraPath[i].pdfFwd);
+        if (cameraPath[i].delta || cameraPath[i - 1].delta) continue;
+
+        /* When direct connections pick their light with the light BVH, the ratios assume the light was picked by
+         * power, as for light subpaths. This is corrected for the direct connection strategy (the first one towards
+         * the camera, from a light hit by the camera subpath), and for all the others from a direct connection. */
+        if (paths->lightTree && (s == 0) && (i == t - 1)) sumRi += ri * LightTreeRatio(pt->primitive, ptMinus->point);
+        else if (paths->lightTree && (s == 1)) sumRi += ri / LightTreeRatio(qs->primitive, pt->point);
+        else sumRi += ri;
+    }
+
+    ri = 1.0f;
+    for (int i = s - 1; i >= 0; --i)
+    {
+        ri *= Remap0(lightPath[i].pdfRev) / Remap0(lightPath[i].pdfFwd);
+        if (lightPath[i].delta || ((i > 0) && lightPath[i - 1].delta)) continue;
+
+        /* The direct connection strategy is the one connecting the light subpath's first vertex. */
+        if (paths->lightTree && (i == 1)) sumRi += ri * LightTreeRatio(lightPath[0].primitive, lightPath[1].point);
+        else sumRi += ri;
+    }
+
+    pt->pdfRev = saved[0];
+    if (ptMinus) ptMinus->pdfRev = saved[1];
+    if (qs) qs->pdfRev = saved[2];
+    if (qsMinus) qsMinus->pdfRev = saved[3];
+
+    return 1.0f / (1.0f + sumRi);
+}
+
+float Renderer::ConnectSubpaths(BidirectionalPaths* paths, int s, int t, float wavelength, float* splats,
+                                Vector splatWeight)
+{
+    vector<PathVertex>& cameraPath = paths->camera;
+    vector<PathVertex>& lightPath = paths->light;
+    const PathVertex& z = cameraPath[t - 1];
+
+    /* With no light subpath, the camera subpath must have hit a light. */
+    if (s == 0)
+    {
+        if (!z.primitive->light) return 0.0f;
+        float emittance = z.primitive->light->Emittance(normalize(z.point - cameraPath[t - 2].point), z.normal,
+                                                        wavelength);
+        return z.beta * emittance * ConnectionWeight(paths, s, t, wavelength);
+    }
+
+    /* Otherwise, both ends of the connection must be connectable (and lights don't reflect). */
+    const PathVertex& y = lightPath[s - 1];
+    if (z.delta || y.delta || (z.primitive && z.primitive->light)) return 0.0f;
+
+    Vector direction = y.point - z.point;
+    float distance2 = direction * direction;
+    if (distance2 <= 0.0f) return 0.0f;
+    direction = direction / sqrtf(distance2);
+
+    /* The light end either emits towards the camera end, or scatters the light of the rest of its subpath. */
+    float light = y.beta * abs(y.normal * direction) * Transmittance(z, y);
+    if (s == 1) light *= y.primitive->light->Emittance(direction, y.normal, wavelength);
+    else light *= Scattering(y, z.point, lightPath[s - 2].point, wavelength);
+
+    /* Connections to the camera are splatted on the pixel the light end projects to. The camera's importance is the
+     * density of screen coordinates per unit solid angle, over the area of the screen (so that each pixel receives
+     * the average over the light paths of one sample per pixel, as the pixel's samples do). */
+    if (t == 1)
+    {
+        float u, v;
+        Vector origin;
+        float density = camera->Project(y.point, &u, &v, &origin);
+        if (density <= 0.0f) return 0.0f;
+
+        float aspect = (float)renderParams.width / renderParams.height;
+        int x = (int)floor((u / aspect + 1.0f) * 0.5f * renderParams.width + 0.5f);
+        int yPixel = (int)floor((v + 1.0f) * 0.5f * renderParams.height + 0.5f);
+        if ((x < 0) || (x >= renderParams.width) || (yPixel < 0) || (yPixel >= renderParams.height)) return 0.0f;
+
+        float contribution = light * density / (distance2 * 4.0f * aspect);
+        if (!(contribution > 0.0f) || !Visible(bvh, z, y)) return 0.0f;
+        contribution *= ConnectionWeight(paths, s, t, wavelength);
+
+        float* splat = splats + (yPixel * renderParams.width + x) * 4;
+        #pragma omp atomic
+        splat[0] += contribution * splatWeight.x;
+        #pragma omp atomic
+        splat[1] += contribution * splatWeight.y;
+        #pragma omp atomic
+        splat[2] += contribution * splatWeight.z;
+        #pragma omp atomic
+        splat[3] += contribution * splatWeight.w;
+        return 0.0f;
+    }
+
+    /* Otherwise, the camera end scatters the light towards the rest of its subpath. */
+    float contribution = z.beta * Scattering(z, cameraPath[t - 2].point, y.point, wavelength)
+                       * abs(z.normal * direction) / distance2 * light;
+    if (!(contribution > 0.0f) || !Visible(bvh, z, y)) return 0.0f;
+    return contribution * ConnectionWeight(paths, s, t, wavelength);
+}
+
+float Renderer::BidirectionalRadiance(Ray ray, float wavelength, Sampler* sampler, BidirectionalPaths* paths,
+                                      float* splats, Vector splatWeight)
+{
+    STATISTIC(paths);
+    vector<PathVertex>& cameraPath = paths->camera;
+    vector<PathVertex>& lightPath = paths->light;
+    cameraPath.clear();
+    lightPath.clear();
+
+    /* The camera subpath starts at the camera, and the camera ray's density is over the whole screen. */
+    PathVertex eye;
+    eye.point = ray.o;
+    eye.normal = ZERO;
+    eye.primitive = nullptr;
+    eye.beta = 1.0f;
+    eye.pdfFwd = 1.0f;
+    eye.pdfRev = 0.0f;
+    eye.delta = false;
+    cameraPath.push_back(eye);
+
+    float u, v;
+    Vector origin;
+    float screenArea = 4.0f * (float)renderParams.width / renderParams.height;
+    float pdfDir = camera->Project(ray.o + ray.d, &u, &v, &origin) / screenArea;
+    TraceSubpath(&cameraPath, ray, 1.0f, pdfDir, wavelength, sampler, true);
+
+    /* The light subpath starts at a uniform point on a light, chosen by power. */
+    if (!emitters.empty())
+    {
+        sampler->SetDimension(EMITTER_DIMENSION);
+        float probability;
+        uint32_t index = emitterTable.Sample(sampler->Next1D(), &probability);
+        float u1, u2;
+        sampler->Next2D(&u1, &u2);
+
+        PathVertex light;
+        light.primitive = emitters[index];
+        light.point = light.primitive->SamplePoint(u1, u2);
+        light.normal = light.primitive->Normal(light.point);
+        light.pdfFwd = probability / light.primitive->Area();
+        light.pdfRev = 0.0f;
+        light.beta = 1.0f / light.pdfFwd;
+        light.delta = false;
+        lightPath.push_back(light);
+
+        /* Emit on either side of the surface, in a cosine-weighted direction. */
+        sampler->SetDimension(EMISSION_DIMENSION);
+        sampler->Next2D(&u1, &u2);
+        Vector side = light.normal;
+        if (u1 < 0.5f) u1 = 2.0f * u1;
+        else
+        {
+            u1 = 2.0f * u1 - 1.0f;
+            side = ZERO - side;
+        }
+
+        float r = sqrtf(u1), theta = 2.0f * PI * u2;
+        Vector direction = rotate(Vector(r * cosf(theta), sqrtf(1.0f - u1), r * sinf(theta)), side);
+        pdfDir = EmissionDensity(light, direction);
+        float emittance = light.primitive->light->Emittance(ZERO - direction, light.normal, wavelength);
+        if (pdfDir > 0.0f) TraceSubpath(&lightPath, Ray(light.point + side * EPSILON, direction),
+                                        light.beta * emittance * abs(light.normal * direction) / pdfDir,
+                                        pdfDir, wavelength, sampler, false);
+    }
+
+    /* Pick a light for the direct connection of every camera subpath vertex with the light BVH, if requested. */
+    vector<PathVertex>& direct = paths->direct;
+    if (paths->lightTree && !emitters.empty())
+    {
+        direct.resize(cameraPath.size());
+        for (size_t t = 1; t < cameraPath.size(); ++t)
+        {
+            direct[t].primitive = nullptr;
+            if (cameraPath[t].delta || cameraPath[t].primitive->light) continue;
+
+            sampler->SetDimension(DIRECT_DIMENSION(t - 1));
+            float probability, u1, u2;
+            uint32_t index = lightTree.Sample(cameraPath[t].point, sampler->Next1D(), &probability);
+            sampler->Next2D(&u1, &u2);
+
+            PathVertex& light = direct[t];
+            light.primitive = emitters[index];
+            light.point = light.primitive->SamplePoint(u1, u2);
+            light.normal = light.primitive->Normal(light.point);
+            light.pdfFwd = probability / light.primitive->Area();
+            light.pdfRev = 0.0f;
+            light.beta = 1.0f / light.pdfFwd;
+            light.delta = false;
+        }
+    }
+
+    /* Connect every prefix of the camera subpath to every prefix of the light subpath. */
+    float radiance = 0.0f;
+    for (int t = 1; t <= (int)cameraPath.size(); ++t)
+        for (int s = 0; s <= (int)lightPath.size(); ++s)
+        {
+            /* The camera can't be hit, and lights seen directly are left to the camera subpath. */
+            if ((t == 1) && (s <= 1)) continue;
+
+            /* Direct connections may use their own light, in place of the light subpath's first vertex. */
+            if ((s == 1) && paths->lightTree)
+            {
+                if (!direct[t - 1].primitive) continue;
+                swap(lightPath[0], direct[t - 1]);
+                radiance += ConnectSubpaths(paths, s, t, wavelength, splats, splatWeight);
+                swap(lightPath[0], direct[t - 1]);
+            }
+            else radiance += ConnectSubpaths(paths, s, t, wavelength, splats, splatWeight);
+        }
+
+    return radiance;
+}
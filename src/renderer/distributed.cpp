@@ -0,0 +1,335 @@
+/* This is distributed rendering: a coordinator hands the tiles of a render out to workers over TCP, which each render
+ * them with all of their threads and send back their integrated colors. Colors are summed over samples and are not
+ * yet converted to RGB (see ColorPipeline), and every pixel sample is seeded from its index, so the coordinator ends up
+ * with exactly the same render as if it had rendered it alone, however many workers there are. */
+
+#include <renderer/renderer.hpp>
+#include <util/socket.hpp>
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <deque>
+#include <time.h>
+#include <omp.h>
+
+/* This identifies the protocol, which must be the same version on both ends. */
+#define PROTOCOL_MAGIC 0x444D424C
+#define PROTOCOL_VERSION 6
+
+/* This is the number of tiles a worker asks for at once, per thread. Larger batches mean fewer round trips, but more
+ * idle threads at the end of each batch. */
+#define TILES_PER_THREAD 4
+
+/* Workers with nothing to do while others finish the last tiles ask again this often, in milliseconds, so they can
+ * take the tiles of workers lost meanwhile. */
+#define WORKER_POLL 250
+
+/* This is the longest time a worker waits for the coordinator to answer, in milliseconds (it answers right away). */
+#define COORDINATOR_TIMEOUT 60000
+
+using namespace std;
+
+#pragma pack(1)
+/* This is sent by a worker when it connects, describing the scene it has loaded. */
+struct WorkerHello
+{
+    /* The protocol magic and version. */
+    uint32_t magic, version;
+    /* The scene's render parameters and number of primitives, which must match the coordinator's. */
+    int32_t width, height, samples;
+    uint32_t primitives;
+    /* The number of threads the worker renders with. */
+    int32_t threads;
+};
+
+/* This is the coordinator's answer, with the render settings the worker must use. */
+struct WorkerJob
+{
+    /* Whether the worker was accepted, which it isn't if it loaded a different scene. */
+    int32_t accepted;
+    /* The render settings. */
+    int32_t resolution, spectralSampling, sampler, firstSample, samples;
+    uint32_t seed;
+    /* The path tracer's russian roulette, depth and splitting. */
+    int32_t roulette, minDepth, maxDepth, splits;
+    float rouletteThreshold;
+    /* The camera overrides (whether the position, target and field of view are overridden, and their values). */
+    uint8_t hasPosition, hasTarget, hasFieldOfView;
+    float position[3], target[3], fieldOfView;
+};
+#pragma pack()
+
+/* After this, the worker repeatedly asks for a number of tiles, the coordinator answers with a count and the tile
+ * indices, and the worker sends back each tile's index followed by its integrated colors, row by row. A count of zero
+ * means the render is complete, and a negative count that there are no tiles to hand out for now, but that other
+ * workers are still rendering some (which may yet be handed out again, if these workers are lost). */
+
+bool Renderer::Coordinate(Vector* colors, int32_t samples, const RenderSettings& settings)
+{
+    /* Listen for workers. */
+    Socket* listener = Socket::Listen(settings.coordinatorPort);
+    if (!listener)
+    {
+        cout << endl << "[!] Failed to listen for workers on port " << settings.coordinatorPort << "." << endl;
+        return false;
+    }
+
+    cout << endl << "[+] Waiting for workers on port " << settings.coordinatorPort << "..." << endl;
+
+    /* This is the state shared by the threads serving each worker, under the lock. */
+    mutex lock;
+    deque<int32_t> pending;
+    int32_t tileCount = TileCount(), completed = 0, workers = 0;
+    time_t lastTime = time(nullptr);
+    for (int32_t t = 0; t < tileCount; ++t) pending.push_back(t);
+
+    /* This serves a worker until the render is complete, or the connection is lost (or times out). */
+    auto serve = [&](Socket* worker)
+    {
+        worker->SetTimeout(settings.workerTimeout * 1000);
+
+        /* Check the worker has loaded the same scene, and send it the render settings. */
+        WorkerHello hello;
+        const CameraOverride& camera = settings.camera;
+        WorkerJob job = {0, settings.resolution, settings.spectralSampling, settings.sampler, settings.firstSample,
+                         samples, settings.seed, settings.roulette, settings.minDepth, settings.maxDepth,
+                         settings.splits, settings.rouletteThreshold, camera.hasPosition, camera.hasTarget,
+                         camera.hasFieldOfView,
+                         {camera.position.x, camera.position.y, camera.position.z},
+                         {camera.target.x, camera.target.y, camera.target.z}, camera.fieldOfView};
+        if (!worker->Receive(&hello, sizeof(WorkerHello)) || (hello.magic != PROTOCOL_MAGIC)
+         || (hello.version != PROTOCOL_VERSION))
+        {
+            delete worker;
+            return;
+        }
+
+        job.accepted = (hello.width == renderParams.width) && (hello.height == renderParams.height)
+                    && (hello.samples == renderParams.samples) && (hello.primitives == primitives->size());
+        if (!worker->Send(&job, sizeof(WorkerJob)) || !job.accepted)
+        {
+            if (!job.accepted) printf("\n[!] Rejected a worker, it loaded a different scene.\n");
+            delete worker;
+            return;
+        }
+
+        {
+            lock_guard<mutex> guard(lock);
+            printf("\n[+] Worker connected, with %d threads (%d workers).\n", hello.threads, ++workers);
+        }
+
+        /* Tiles handed out to the worker, which are not finished yet. */
+        vector<int32_t> assigned;
+        vector<Vector> buffer(TILESIZE * TILESIZE);
+        bool finished = false;
+        while (!finished)
+        {
+            /* Hand out as many tiles as the worker asks for, if there are any left. Only release the worker once the
+             * render is complete, so it can take the tiles of workers lost in the meantime. */
+            int32_t count;
+            if (!worker->Receive(&count, sizeof(int32_t))) break;
+            {
+                lock_guard<mutex> guard(lock);
+                while (((int32_t)assigned.size() < count) && !pending.empty())
+                {
+                    assigned.push_back(pending.front());
+                    pending.pop_front();
+                }
+
+                finished = assigned.empty() && (completed == tileCount);
+                count = finished ? 0 : assigned.empty() ? -1 : (int32_t)assigned.size();
+            }
+
+            if (!worker->Send(&count, sizeof(int32_t))) break;
+            if ((count > 0) && !worker->Send(&assigned[0], count * sizeof(int32_t))) break;
+
+            /* Receive the tiles, in whatever order they were finished. */
+            while (!assigned.empty())
+            {
+                int32_t tile;
+                if (!worker->Receive(&tile, sizeof(int32_t))) break;
+                vector<int32_t>::iterator position = find(assigned.begin(), assigned.end(), tile);
+                if (position == assigned.end()) break;
+
+                int32_t x0, y0, x1, y1;
+                TileBounds(tile, &x0, &y0, &x1, &y1);
+                if (!worker->Receive(&buffer[0], (x1 - x0) * (y1 - y0) * sizeof(Vector))) break;
+
+                for (int32_t y = y0; y < y1; ++y)
+                    copy(buffer.begin() + (y - y0) * (x1 - x0), buffer.begin() + (y - y0 + 1) * (x1 - x0),
+                         colors + y * renderParams.width + x0);
+                assigned.erase(position);
+
+                /* Display the progress every second. */
+                lock_guard<mutex> guard(lock);
+                ++completed;
+                if ((completed == tileCount) || (difftime(time(nullptr), lastTime) >= 1.0))
+                {
+                    printf("\r[+] Raytracing on %d worker(s)... %04.1f%%", workers, completed * 100.0f / tileCount);
+                    lastTime = time(nullptr);
+                    cout << flush;
+                }
+            }
+
+            if (!assigned.empty()) break;
+        }
+
+        /* If the worker was lost, hand its unfinished tiles out again. */
+        lock_guard<mutex> guard(lock);
+        --workers;
+        if (!assigned.empty())
+        {
+            printf("\n[!] Lost a worker, its %d unfinished tile(s) will be handed out again.\n", (int)assigned.size());
+            pending.insert(pending.end(), assigned.begin(), assigned.end());
+        }
+
+        delete worker;
+    };
+
+    /* Accept workers until every tile has been rendered. */
+    vector<thread> threads;
+    while (true)
+    {
+        {
+            lock_guard<mutex> guard(lock);
+            if (completed == tileCount) break;
+        }
+
+        Socket* worker = listener->Accept(250);
+        if (worker) threads.push_back(thread(serve, worker));
+    }
+
+    /* The workers are told the render is complete on their next request. */
+    for (size_t t = 0; t < threads.size(); ++t) threads[t].join();
+    delete listener;
+    cout << endl;
+    return true;
+}
+
+void Renderer::Work(string coordinator, size_t threads)
+{
+    /* Use every execution unit by default, as for a local render. */
+    omp_set_num_threads((threads == 0) ? omp_get_num_procs() : threads);
+    if (threads == 0) threads = omp_get_num_procs();
+
+    /* Connect to the coordinator. */
+    size_t colon = coordinator.rfind(':');
+    Socket* socket = (colon == string::npos) ? nullptr : Socket::Connect(coordinator.substr(0, colon),
+                                                                          atoi(coordinator.c_str() + colon + 1));
+    if (!socket)
+    {
+        cout << "[!] Failed to connect to the coordinator <" << coordinator << ">." << endl;
+        return;
+    }
+
+    socket->SetTimeout(COORDINATOR_TIMEOUT);
+
+    /* Describe the scene, and get the render settings. */
+    WorkerHello hello = {PROTOCOL_MAGIC, PROTOCOL_VERSION, renderParams.width, renderParams.height,
+                         renderParams.samples, (uint32_t)primitives->size(), (int32_t)threads};
+    WorkerJob job;
+    if (!socket->Send(&hello, sizeof(WorkerHello)) || !socket->Receive(&job, sizeof(WorkerJob)) || !job.accepted)
+    {
+        cout << "[!] The coordinator <" << coordinator << "> refused this worker, or is rendering another scene."
+             << endl;
+        delete socket;
+        return;
+    }
+
+    RenderSettings settings;
+    settings.resolution = job.resolution;
+    settings.spectralSampling = (SpectralSampling)job.spectralSampling;
+    settings.sampler = (SamplerType)job.sampler;
+    settings.seed = job.seed;
+    settings.roulette = (RussianRoulette)job.roulette;
+    settings.minDepth = job.minDepth;
+    settings.maxDepth = job.maxDepth;
+    settings.splits = job.splits;
+    settings.rouletteThreshold = job.rouletteThreshold;
+    settings.camera.hasPosition = job.hasPosition;
+    settings.camera.hasTarget = job.hasTarget;
+    settings.camera.hasFieldOfView = job.hasFieldOfView;
+    settings.camera.position = Vector(job.position[0], job.position[1], job.position[2]);
+    settings.camera.target = Vector(job.target[0], job.target[1], job.target[2]);
+    settings.camera.fieldOfView = job.fieldOfView;
+    if ((settings.resolution != RESOLUTION_FINAL) && (settings.resolution != RESOLUTION_PREVIEW)
+     && (settings.resolution != RESOLUTION_DRAFT))
+    {
+        cout << "[!] Unsupported spectral resolution (" << settings.resolution << "nm)." << endl;
+        delete socket;
+        return;
+    }
+
+    cout << "[+] Working for <" << coordinator << ">, " << threads << " threads scheduled." << endl;
+    cout << "    | " << job.samples << " spp at " << settings.resolution << "nm spectral resolution." << endl;
+
+    /* Render from the coordinator's camera, putting the scene's camera back once done. */
+    Camera* sceneCamera = camera;
+    if (!settings.camera.Empty()) camera = sceneCamera->Override(settings.camera);
+
+    /* Render tiles until there are none left. */
+    Vector* colors = new Vector[pixelCount];
+    vector<int32_t> tiles;
+    vector<Vector> buffer(TILESIZE * TILESIZE);
+    size_t rendered = 0;
+    bool lost = false;
+    while (!lost)
+    {
+        /* Ask for enough tiles to keep every thread busy. */
+        int32_t count = threads * TILES_PER_THREAD;
+        if (!socket->Send(&count, sizeof(int32_t)) || !socket->Receive(&count, sizeof(int32_t))) lost = true;
+        if (lost || (count == 0)) break;
+
+        /* Wait for other workers to finish their tiles, or to be lost. */
+        if (count < 0)
+        {
+            this_thread::sleep_for(chrono::milliseconds(WORKER_POLL));
+            continue;
+        }
+
+        tiles.resize(count);
+        if (!socket->Receive(&tiles[0], count * sizeof(int32_t))) lost = true;
+        for (int32_t t = 0; t < count; ++t)
+            if ((tiles[t] < 0) || (tiles[t] >= TileCount())) lost = true;
+        if (lost) break;
+
+        /* Clear the tiles, and render them. */
+        for (int32_t t = 0; t < count; ++t)
+        {
+            int32_t x0, y0, x1, y1;
+            TileBounds(tiles[t], &x0, &y0, &x1, &y1);
+            for (int32_t y = y0; y < y1; ++y)
+                fill(colors + y * renderParams.width + x0, colors + y * renderParams.width + x1, ZERO);
+        }
+
+        TraceTiles(colors, tiles, job.firstSample, job.samples, settings, false);
+
+        /* Send them back, row by row. */
+        for (int32_t t = 0; (t < count) && !lost; ++t)
+        {
+            int32_t x0, y0, x1, y1;
+            TileBounds(tiles[t], &x0, &y0, &x1, &y1);
+            for (int32_t y = y0; y < y1; ++y)
+                copy(colors + y * renderParams.width + x0, colors + y * renderParams.width + x1,
+                     buffer.begin() + (y - y0) * (x1 - x0));
+
+            lost = !socket->Send(&tiles[t], sizeof(int32_t))
+                || !socket->Send(&buffer[0], (x1 - x0) * (y1 - y0) * sizeof(Vector));
+        }
+
+        rendered += count;
+        printf("\r[+] Rendered %u tile(s)...", (unsigned)rendered);
+        cout << flush;
+    }
+
+    if (lost) cout << endl << "[!] Lost the connection to the coordinator." << endl;
+    else cout << endl << "[+] No tiles left, work finished!" << endl;
+
+    if (camera != sceneCamera) delete camera;
+    camera = sceneCamera;
+    delete[] colors;
+    delete socket;
+}
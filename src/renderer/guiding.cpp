@@ -0,0 +1,279 @@
+/* This is the path guiding SD-tree (see guiding.hpp), and the renderer's guided passes which train it. */
+
+#include <renderer/renderer.hpp>
+#include <renderer/guiding.hpp>
+#include <algorithm>
+#include <omp.h>
+
+using namespace std;
+
+/* The radiance is recorded as fixed-point numbers with this many steps per unit of the brightest emitted radiance,
+ * and each record is clamped to the largest number below, so that the sums of a pass can't overflow. */
+#define GUIDING_PRECISION 16777216.0f
+#define GUIDING_RECORD_MAX 1099511627776.0f
+
+/* A region is split in two when it received more than this many records in a pass, times the square root of the
+ * samples per pixel of the pass (so the regions get smaller, and their quadtrees better learned, as passes go). */
+#define GUIDING_SPATIAL_THRESHOLD 12000
+
+/* A quadrant is split when it holds more than this fraction of its quadtree's energy, up to the maximum depth. */
+#define GUIDING_DIRECTIONAL_THRESHOLD 0.01f
+#define GUIDING_DIRECTIONAL_DEPTH 20
+
+/* The largest float below one, so rescaled uniform numbers stay in [0, 1). */
+#define ONE_MINUS_EPSILON 0.99999994f
+
+/* Maps a point of the unit square to a direction, with the equal-area cylindrical mapping. */
+static Vector SquareToDirection(float x, float y)
+{
+    float cosTheta = 2.0f * x - 1.0f, phi = 2.0f * PI * y;
+    float sinTheta = sqrtf(max(0.0f, 1.0f - cosTheta * cosTheta));
+    return Vector(sinTheta * cosf(phi), sinTheta * sinf(phi), cosTheta);
+}
+
+/* Maps a direction back to the unit square. */
+static void DirectionToSquare(Vector direction, float* x, float* y)
+{
+    float phi = atan2f(direction.y, direction.x) / (2.0f * PI);
+    *x = min(max(0.5f * (direction.z + 1.0f), 0.0f), ONE_MINUS_EPSILON);
+    *y = min(max((phi < 0.0f) ? phi + 1.0f : phi, 0.0f), ONE_MINUS_EPSILON);
+}
+
+DirectionalTree::DirectionalTree() : nodes(1), building(1), sums(4, 0), records(0)
+{
+    for (int q = 0; q < 4; ++q) nodes[0].energy[q] = 0.0f, nodes[0].children[q] = 0;
+    building[0] = nodes[0];
+}
+
+bool DirectionalTree::Trained() const
+{
+    const float* energy = nodes[0].energy;
+    return energy[0] + energy[1] + energy[2] + energy[3] > 0.0f;
+}
+
+Vector DirectionalTree::Sample(float u1, float u2) const
+{
+    /* Descend from the root, picking a half along the first coordinate and then a quadrant within it by energy, and
+     * reusing the rest of the numbers each time, until a leaf quadrant is reached which is sampled uniformly. */
+    float x = 0.0f, y = 0.0f, size = 1.0f;
+    uint32_t index = 0;
+    while (true)
+    {
+        const float* energy = nodes[index].energy;
+        float first = energy[0] + energy[2], total = first + energy[1] + energy[3];
+        float p = (total > 0.0f) ? first / total : 0.5f;
+        int quadrant = 0;
+        if (u1 < p) u1 = min(u1 / p, ONE_MINUS_EPSILON);
+        else
+        {
+            u1 = min((u1 - p) / (1.0f - p), ONE_MINUS_EPSILON);
+            quadrant |= 1;
+        }
+
+        float half = energy[quadrant] + energy[quadrant | 2];
+        p = (half > 0.0f) ? energy[quadrant] / half : 0.5f;
+        if (u2 < p) u2 = min(u2 / p, ONE_MINUS_EPSILON);
+        else
+        {
+            u2 = min((u2 - p) / (1.0f - p), ONE_MINUS_EPSILON);
+            quadrant |= 2;
+        }
+
+        size *= 0.5f;
+        x += (quadrant & 1) * size;
+        y += (quadrant >> 1) * size;
+        if (!nodes[index].children[quadrant]) break;
+        index = nodes[index].children[quadrant];
+    }
+
+    return SquareToDirection(x + u1 * size, y + u2 * size);
+}
+
+float DirectionalTree::Density(Vector direction) const
+{
+    /* Each level scales the density by the energy of the quadrant over its average, and the mapping preserves area,
+     * so the density on the sphere is that on the square over the sphere's area. */
+    float x, y, density = 1.0f / (4.0f * PI);
+    DirectionToSquare(direction, &x, &y);
+    uint32_t index = 0;
+    while (true)
+    {
+        const float* energy = nodes[index].energy;
+        float total = energy[0] + energy[1] + energy[2] + energy[3];
+        int quadrant = (x >= 0.5f) | ((y >= 0.5f) << 1);
+        if (total > 0.0f) density *= 4.0f * energy[quadrant] / total;
+        if ((density == 0.0f) || !nodes[index].children[quadrant]) return density;
+
+        x = 2.0f * x - (quadrant & 1);
+        y = 2.0f * y - (quadrant >> 1);
+        index = nodes[index].children[quadrant];
+    }
+}
+
+void DirectionalTree::Record(Vector direction, uint64_t amount)
+{
+    #pragma omp atomic
+    ++records;
+    if (amount == 0) return;
+
+    /* Add the energy to every quadrant on the way down to the leaf holding the direction. */
+    float x, y;
+    DirectionToSquare(direction, &x, &y);
+    uint32_t index = 0;
+    while (true)
+    {
+        int quadrant = (x >= 0.5f) | ((y >= 0.5f) << 1);
+        #pragma omp atomic
+        sums[index * 4 + quadrant] += amount;
+        if (!building[index].children[quadrant]) return;
+
+        x = 2.0f * x - (quadrant & 1);
+        y = 2.0f * y - (quadrant >> 1);
+        index = building[index].children[quadrant];
+    }
+}
+
+void DirectionalTree::Refine(float threshold, uint32_t depth)
+{
+    /* Sample the energy recorded from now on (as a pass only adds to it, a parent's quadrant holds its children). */
+    nodes = building;
+    for (size_t t = 0; t < nodes.size(); ++t)
+        for (int q = 0; q < 4; ++q) nodes[t].energy[q] = (float)sums[t * 4 + q];
+
+    /* Rebuild the quadtree recorded into from the root, splitting the quadrants holding enough energy. Quadrants the
+     * sampled quadtree didn't split yet are split with their energy shared evenly, so they may be split again. */
+    const float* root = nodes[0].energy;
+    float total = root[0] + root[1] + root[2] + root[3];
+    struct Pending { uint32_t target; int32_t source; uint32_t depth; float energy[4]; };
+    Pending first = {0, 0, 1, {root[0], root[1], root[2], root[3]}};
+    vector<Pending> stack(1, first);
+    building.assign(1, QuadNode());
+    while (!stack.empty())
+    {
+        Pending node = stack.back();
+        stack.pop_back();
+        for (int q = 0; q < 4; ++q)
+        {
+            building[node.target].energy[q] = 0.0f;
+            building[node.target].children[q] = 0;
+            if (!(total > 0.0f) || (node.energy[q] <= threshold * total) || (node.depth >= depth)) continue;
+
+            Pending child = {(uint32_t)building.size(), -1, node.depth + 1, {0, 0, 0, 0}};
+            int32_t source = (node.source >= 0) ? (int32_t)nodes[node.source].children[q] : 0;
+            if (source > 0)
+            {
+                child.source = source;
+                for (int c = 0; c < 4; ++c) child.energy[c] = nodes[source].energy[c];
+            }
+            else for (int c = 0; c < 4; ++c) child.energy[c] = 0.25f * node.energy[q];
+
+            building[node.target].children[q] = child.target;
+            building.push_back(QuadNode());
+            stack.push_back(child);
+        }
+    }
+
+    sums.assign(building.size() * 4, 0);
+    records = 0;
+}
+
+GuidingTree::GuidingTree(const AABB& bounds, float radiance) : bounds(bounds), nodes(1), trees(1), recording(false)
+{
+    nodes[0].child = 0;
+    nodes[0].tree = 0;
+    scale = (radiance > 0.0f) ? GUIDING_PRECISION / radiance : GUIDING_PRECISION;
+}
+
+uint32_t GuidingTree::Lookup(Vector point) const
+{
+    /* Descend from the root, halving the bounds along x, y and z in turn. */
+    float low[3] = {bounds.min.x, bounds.min.y, bounds.min.z}, high[3] = {bounds.max.x, bounds.max.y, bounds.max.z};
+    uint32_t index = 0;
+    for (int axis = 0; nodes[index].child; axis = (axis + 1) % 3)
+    {
+        float middle = 0.5f * (low[axis] + high[axis]);
+        if (point[axis] < middle)
+        {
+            high[axis] = middle;
+            index = nodes[index].child;
+        }
+        else
+        {
+            low[axis] = middle;
+            index = nodes[index].child + 1;
+        }
+    }
+
+    return nodes[index].tree;
+}
+
+void GuidingTree::Record(uint32_t tree, Vector direction, float radiance)
+{
+    float amount = (radiance > 0.0f) ? min(radiance * scale, GUIDING_RECORD_MAX) : 0.0f;
+    trees[tree].Record(direction, (uint64_t)amount);
+}
+
+void GuidingTree::Refine(int32_t samples)
+{
+    /* Split the regions which received too many records, their halves starting with copies of their quadtree (and
+     * half of the records each, so they may be split again). */
+    uint64_t threshold = (uint64_t)(GUIDING_SPATIAL_THRESHOLD * sqrtf((float)samples));
+    for (size_t t = 0; t < nodes.size(); ++t)
+    {
+        if (nodes[t].child || (trees[nodes[t].tree].Records() <= threshold)) continue;
+
+        trees[nodes[t].tree].HalveRecords();
+        SpatialNode first = {0, nodes[t].tree}, second = {0, (uint32_t)trees.size()};
+        trees.push_back(trees[nodes[t].tree]);
+        nodes[t].child = nodes.size();
+        nodes.push_back(first);
+        nodes.push_back(second);
+    }
+
+    for (size_t t = 0; t < trees.size(); ++t)
+        trees[t].Refine(GUIDING_DIRECTIONAL_THRESHOLD, GUIDING_DIRECTIONAL_DEPTH);
+}
+
+size_t GuidingTree::DirectionalNodes() const
+{
+    size_t count = 0;
+    for (size_t t = 0; t < trees.size(); ++t) count += trees[t].Nodes();
+    return count;
+}
+
+int32_t Renderer::TraceGuided(Vector* colors, const vector<int32_t>& tiles, int32_t samples,
+                              const RenderSettings& settings)
+{
+    /* The tree covers the scene, and records radiance relative to the brightest light. */
+    AABB bounds = sceneOrder[0]->BoundingBox();
+    for (size_t t = 1; t < sceneOrder.size(); ++t) bounds.expandToInclude(sceneOrder[t]->BoundingBox());
+
+    float radiance = 0.0f;
+    for (size_t t = 0; t < emitters.size(); ++t)
+    {
+        Vector point = emitters[t]->SamplePoint(0.5f, 0.5f);
+        Vector normal = emitters[t]->Normal(point);
+        for (float wavelength = WAVELENGTH_MIN; wavelength <= WAVELENGTH_MAX; wavelength += RESOLUTION_FINAL)
+            radiance = max(radiance, (float)emitters[t]->light->Emittance(ZERO - normal, normal, wavelength));
+    }
+
+    delete guidingTree;
+    guidingTree = new GuidingTree(bounds, radiance);
+
+    /* Train the tree over passes of doubling samples, as long as some samples are left for the last pass. */
+    int32_t passes = 0, sample = settings.firstSample;
+    for (int32_t count = 1; (passes < settings.guiding) && (sample + count < settings.firstSample + samples);
+         count *= 2, ++passes)
+    {
+        guidingTree->recording = true;
+        TraceTiles(colors, tiles, sample, count, settings, false);
+        guidingTree->recording = false;
+        guidingTree->Refine(count);
+        sample += count;
+    }
+
+    /* Render the rest of the samples with the trained tree. All passes add to the render, since they are all unbiased
+     * (the last one is much less noisy, being guided best and getting the most samples). */
+    TraceTiles(colors, tiles, sample, settings.firstSample + samples - sample, settings, true);
+    return passes;
+}
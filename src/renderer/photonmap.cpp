@@ -0,0 +1,271 @@
+/* This is the caustic photon map (see photonmap.hpp), and the renderer's photon tracing pass which fills it. */
+
+#include <renderer/renderer.hpp>
+#include <renderer/photonmap.hpp>
+#include <algorithm>
+#include <iostream>
+#include <omp.h>
+
+using namespace std;
+
+/* Photons are traced in blocks of this many photons, each block drawing from the sampler as the samples of a pixel,
+ * so that the photons only depend on the seed. Blocks are kept whole, in order, within the memory budget. */
+#define PHOTON_BLOCK 4096
+
+/* The photons' sampler is seeded with the render seed mixed with this, so they don't correlate with the pixels. */
+#define PHOTON_SEED 0x9E3779B9
+
+/* A photon draws the point it is emitted from, its direction, the light and its wavelength from the first six
+ * dimensions, and then each bounce draws as many as a bounce of the path tracer. */
+#define PHOTON_BOUNCE_DIMENSION(bounce) (6 + (bounce) * BOUNCE_DIMENSIONS)
+
+/* The automatic gathering radius is that of a disc holding this many photons, if they were spread evenly over the
+ * surfaces they can land on (caustics are much denser than that, so they get many more). */
+#define PHOTON_NEIGHBORS 16
+
+uint32_t PhotonMap::Bucket(int32_t x, int32_t y, int32_t z) const
+{
+    /* The usual spatial hash, the table size being a power of two. */
+    return (((uint32_t)x * 73856093u) ^ ((uint32_t)y * 19349663u) ^ ((uint32_t)z * 83492791u))
+         & (uint32_t)(buckets.size() - 2);
+}
+
+PhotonMap::PhotonMap(vector<Photon>* photons, float radius, float bandwidth) : radius(radius), bandwidth(bandwidth)
+{
+    /* Make the hash table at least as large as the number of photons. */
+    size_t size = 1;
+    while (size < photons->size()) size <<= 1;
+    buckets.assign(size + 1, 0);
+
+    /* Find the bucket of every photon's cell, the cells being twice the radius across. */
+    float cellSize = 2.0f * radius;
+    vector<pair<uint32_t, float> > keys(photons->size());
+    vector<uint32_t> order(photons->size());
+    for (size_t t = 0; t < photons->size(); ++t)
+    {
+        const Photon& photon = (*photons)[t];
+        keys[t] = make_pair(Bucket((int32_t)floorf(photon.position[0] / cellSize),
+                                   (int32_t)floorf(photon.position[1] / cellSize),
+                                   (int32_t)floorf(photon.position[2] / cellSize)), photon.wavelength);
+        order[t] = t;
+        ++buckets[keys[t].first];
+    }
+
+    /* Sort the photons by bucket and by wavelength, and find where each bucket starts. */
+    stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+    for (size_t t = 0, start = 0; t <= size; ++t)
+    {
+        uint32_t count = buckets[t];
+        buckets[t] = start;
+        start += count;
+    }
+
+    this->photons.resize(photons->size());
+    for (size_t t = 0; t < order.size(); ++t) this->photons[t] = (*photons)[order[t]];
+    vector<Photon>().swap(*photons);
+}
+
+float PhotonMap::Radiance(Vector point, Vector incident, Vector normal, float wavelength, Material* material) const
+{
+    /* The gathering sphere overlaps the eight cells from the one holding its lowest corner. */
+    float cellSize = 2.0f * radius;
+    int32_t x = (int32_t)floorf((point.x - radius) / cellSize);
+    int32_t y = (int32_t)floorf((point.y - radius) / cellSize);
+    int32_t z = (int32_t)floorf((point.z - radius) / cellSize);
+    float low = wavelength - 0.5f * bandwidth, high = wavelength + 0.5f * bandwidth;
+
+    uint32_t visited[8];
+    int count = 0;
+    float radiance = 0.0f;
+    for (int c = 0; c < 8; ++c)
+    {
+        /* Cells may share a bucket, which must only be visited once. */
+        uint32_t bucket = Bucket(x + (c & 1), y + ((c >> 1) & 1), z + (c >> 2));
+        if (find(visited, visited + count, bucket) != visited + count) continue;
+        visited[count++] = bucket;
+
+        /* Only visit the bucket's photons within the spectral bandwidth. */
+        const Photon* end = &photons[0] + buckets[bucket + 1];
+        const Photon* photon = lower_bound(&photons[0] + buckets[bucket], end, low,
+                                           [](const Photon& photon, float wavelength)
+                                           { return photon.wavelength < wavelength; });
+        for (; (photon < end) && (photon->wavelength < high); ++photon)
+        {
+            Vector offset = Vector(photon->position[0], photon->position[1], photon->position[2]) - point;
+            if (offset * offset >= radius * radius) continue;
+
+            Vector direction(photon->direction[0], photon->direction[1], photon->direction[2]);
+            radiance += material->Evaluate(incident, ZERO - direction, normal, wavelength) * photon->power;
+        }
+    }
+
+    /* Divide the reflected power by the area of the gathering disc, and by the bandwidth. */
+    return radiance / (PI * radius * radius * bandwidth);
+}
+
+void Renderer::TracePhoton(Sampler* sampler, vector<Photon>* photons)
+{
+    /* Emit from a uniform point on a light, chosen by power, on either side and in a cosine-weighted direction (as
+     * the bidirectional path tracer does), at a uniform wavelength. */
+    float u1, u2, v1, v2, probability;
+    sampler->Next2D(&u1, &u2);
+    sampler->Next2D(&v1, &v2);
+    Primitive* emitter = emitters[emitterTable.Sample(sampler->Next1D(), &probability)];
+    float wavelength = WAVELENGTH_MIN + sampler->Next1D() * (WAVELENGTH_MAX - WAVELENGTH_MIN);
+    Vector point = emitter->SamplePoint(u1, u2);
+    Vector side = emitter->Normal(point);
+    Vector normal = side;
+    if (v1 < 0.5f) v1 = 2.0f * v1;
+    else
+    {
+        v1 = 2.0f * v1 - 1.0f;
+        side = ZERO - side;
+    }
+
+    float r = sqrtf(v1), theta = 2.0f * PI * v2;
+    Vector direction = rotate(Vector(r * cosf(theta), sqrtf(1.0f - v1), r * sinf(theta)), side);
+
+    /* The power is divided by the number of photons emitted once they are all traced. */
+    float power = emitter->light->Emittance(ZERO - direction, normal, wavelength) * 2.0f * PI
+                * emitter->Area() / probability * (WAVELENGTH_MAX - WAVELENGTH_MIN);
+    Ray ray(point + side * EPSILON, direction);
+
+    /* Follow the photon through specular and glass materials, until it lands on a connectable material. */
+    for (uint32_t bounce = 0; power > 0.0f; ++bounce)
+    {
+        Intersection intersection;
+        if (!bvh->getIntersection(ray, &intersection, false) || intersection.primitive->light) return;
+
+        point = ray.o + ray.d * intersection.t;
+        normal = intersection.primitive->Normal(point);
+        Material* material = intersection.primitive->material;
+        float transmittance = exp(-intersection.t * ((ray.d * normal > 0.0f) ? material->e2 : material->e1));
+
+        /* Only keep the photons which went through a specular or glass material, the others are not caustics. */
+        if (material->Connectable())
+        {
+            if (bounce == 0) return;
+
+            Photon photon;
+            for (int c = 0; c < 3; ++c) photon.position[c] = point[c];
+            for (int c = 0; c < 3; ++c) photon.direction[c] = ray.d[c];
+            photon.power = power * transmittance;
+            photon.wavelength = wavelength;
+            photons->push_back(photon);
+            return;
+        }
+
+        /* Sample the material, with russian roulette as in the bidirectional path tracer. */
+        sampler->SetDimension(PHOTON_BOUNCE_DIMENSION(bounce));
+        Vector exitant = normalize(material->Sample(&point, ray.d, normal, wavelength, sampler));
+        float weight = material->Reflectance(ray.d, exitant, normal, wavelength, true) * transmittance;
+
+        sampler->SetDimension(PHOTON_BOUNCE_DIMENSION(bounce) + BOUNCE_DIMENSIONS - 1);
+        float survival = min(weight, 1.0f);
+        if (!(sampler->Next1D() < survival)) return;
+
+        power *= weight / survival;
+        ray = Ray(point, exitant);
+    }
+}
+
+void Renderer::BuildPhotonMap(const RenderSettings& settings, bool verbose)
+{
+    TimelineScope scope("Photon map");
+    delete photonMap;
+    photonMap = nullptr;
+    if (emitters.empty())
+    {
+        if (verbose) cout << "[!] The scene has no lights to shoot photons from." << endl;
+        return;
+    }
+
+    double photonTime = omp_get_wtime();
+    if (verbose) cout << "[+] Shooting " << settings.photons << " photons..." << flush;
+
+    /* Trace a batch of blocks at a time, keeping whole blocks until the memory budget is reached. A quarter of the
+     * budget is left for the batch (with fewer blocks if need be, so the photons kept don't depend on the number of
+     * threads), and the rest counts all the memory the map takes while it is built, about twice that of the map
+     * itself, so the photons kept are reserved for up front. */
+    size_t memory = (size_t)settings.photonMemory * 1048576, blockMemory = PHOTON_BLOCK * sizeof(Photon);
+    int32_t batch = (int32_t)max((size_t)1, min((size_t)omp_get_max_threads() * 4, memory / 4 / blockMemory));
+    size_t budget = (memory - memory / 4) / PhotonMap::PeakMemory(1);
+    int32_t blocks = (settings.photons + PHOTON_BLOCK - 1) / PHOTON_BLOCK;
+    vector<vector<Photon> > traced(batch);
+    for (int32_t b = 0; b < batch; ++b) traced[b].reserve(PHOTON_BLOCK);
+    vector<Photon> photons;
+    photons.reserve(min(budget, (size_t)settings.photons));
+    int64_t emitted = 0;
+    bool full = false;
+    for (int32_t first = 0; !full && (first < blocks); first += batch)
+    {
+        int32_t count = min(batch, blocks - first);
+
+        #pragma omp parallel
+        {
+            Sampler* sampler = GetSampler(settings.sampler, settings.seed ^ PHOTON_SEED);
+
+            #pragma omp for schedule(dynamic, 1)
+            for (int32_t b = 0; b < count; ++b)
+            {
+                int32_t block = first + b;
+                int32_t size = min(PHOTON_BLOCK, settings.photons - block * PHOTON_BLOCK);
+                traced[b].clear();
+                for (int32_t t = 0; t < size; ++t)
+                {
+                    sampler->StartSample(block, t);
+                    TracePhoton(sampler, &traced[b]);
+                }
+            }
+
+            delete sampler;
+        }
+
+        for (int32_t b = 0; b < count; ++b)
+        {
+            if (photons.size() + traced[b].size() > budget)
+            {
+                full = true;
+                break;
+            }
+
+            photons.insert(photons.end(), traced[b].begin(), traced[b].end());
+            emitted += min(PHOTON_BLOCK, settings.photons - (first + b) * PHOTON_BLOCK);
+        }
+    }
+
+    vector<vector<Photon> >().swap(traced);
+    if (verbose) cout << " done!" << endl;
+    if (full && photons.empty())
+    {
+        if (verbose) cout << "[!] The photon memory budget of " << settings.photonMemory << " MiB is too small for a "
+                          << "single block of " << PHOTON_BLOCK << " photons." << endl;
+        return;
+    }
+
+    if (verbose && full)
+        cout << "[!] The photon memory budget was reached after emitting " << emitted << " photons." << endl;
+    if (photons.empty())
+    {
+        if (verbose) cout << "    | No photons went through specular or glass materials, no caustics." << endl;
+        return;
+    }
+
+    for (size_t t = 0; t < photons.size(); ++t) photons[t].power /= (float)emitted;
+
+    /* The radius is either given, or such that a few photons would be gathered if they were spread out evenly. */
+    float radius = settings.photonRadius;
+    if (radius <= 0.0f)
+    {
+        float area = 0.0f;
+        for (size_t t = 0; t < sceneOrder.size(); ++t)
+            if (!sceneOrder[t]->light && sceneOrder[t]->material && sceneOrder[t]->material->Connectable())
+                area += sceneOrder[t]->Area();
+        radius = sqrtf(PHOTON_NEIGHBORS * area / (PI * photons.size()));
+    }
+
+    size_t stored = photons.size();
+    photonMap = new PhotonMap(&photons, radius, (float)settings.resolution);
+    if (verbose) printf("    | %u caustic photons stored (%.1f MiB), gathered within %g units, in %.2f seconds.\n",
+                        (unsigned)stored, photonMap->Memory() / 1048576.0, radius, omp_get_wtime() - photonTime);
+}
@@ -0,0 +1,267 @@
+#include <renderer/postprocess.hpp>
+#include <util/fastmath.hpp>
+#include <algorithm>
+#include <vector>
+#include <omp.h>
+
+/* These scale how much the denoiser's taps may differ from the pixel in luminance (in standard deviations), in
+ * depth (in depth gradients) and in albedo, and the exponent of the cosine between their normals. */
+#define DENOISE_SIGMA_LUMINANCE 3.0f
+#define DENOISE_SIGMA_DEPTH 1.0f
+#define DENOISE_SIGMA_ALBEDO 0.02f
+#define DENOISE_NORMAL_POWER 128
+
+/* Albedos are clamped to this before dividing by them, so that the colors of nearly black surfaces survive. */
+#define DENOISE_ALBEDO_MIN 0.01f
+
+/* Denoises a pixel array with the edge-avoiding A-trous wavelet filter, guided by the features of its pixels. */
+void DenoisePixels(Vector* pixels, const Vector* albedo, const Vector* normals, const float* depths, int32_t width,
+                   int32_t height, int32_t iterations, ColorSystem colorSystem)
+{
+    const Vector weights = Vector(colorSystem.yRed, colorSystem.yGreen, colorSystem.yBlue);
+    const float kernel[3] = {3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f};
+    const size_t count = (size_t)width * height;
+    std::vector<Vector> colors[2] = {std::vector<Vector>(count), std::vector<Vector>(count)};
+    std::vector<float> variances[2] = {std::vector<float>(count), std::vector<float>(count)};
+    std::vector<float> gradients(count), deviations(count);
+    std::vector<Vector> scales(count);
+
+    /* Divide the pixels by their albedo, and find the depth gradient of each pixel (the largest difference in depth
+     * to its neighbors per pixel, which is how much the depth of a plane changes from pixel to pixel). */
+    #pragma omp parallel for schedule(static)
+    for (int32_t y = 0; y < height; ++y)
+        for (int32_t x = 0; x < width; ++x)
+        {
+            size_t p = (size_t)y * width + x;
+            scales[p] = max(albedo[p], Vector(DENOISE_ALBEDO_MIN, DENOISE_ALBEDO_MIN, DENOISE_ALBEDO_MIN, 1.0f));
+            colors[0][p] = pixels[p].cdiv(scales[p]);
+
+            float gradient = 0.0f;
+            if (depths[p] > 0.0f)
+                for (int32_t k = 0; k < 4; ++k)
+                {
+                    int32_t qx = x + ((k == 0) ? -1 : (k == 1) ? 1 : 0), qy = y + ((k == 2) ? -1 : (k == 3) ? 1 : 0);
+                    if ((qx < 0) || (qy < 0) || (qx >= width) || (qy >= height)) continue;
+                    float depth = depths[(size_t)qy * width + qx];
+                    if (depth > 0.0f) gradient = std::max(gradient, std::abs(depth - depths[p]));
+                }
+            gradients[p] = gradient;
+        }
+
+    /* This is how much a tap counts, by its normal, depth and albedo (which tells materials and lights apart), or
+     * zero if nothing was hit there. */
+    auto geometry = [&](size_t p, size_t q, float distance) -> float
+    {
+        if (!(depths[q] > 0.0f)) return 0.0f;
+        float cosine = std::max(normals[p] * normals[q], 0.0f);
+        for (int32_t k = 1; k < DENOISE_NORMAL_POWER; k *= 2) cosine *= cosine;
+        float depth = std::abs(depths[p] - depths[q])
+                    / (DENOISE_SIGMA_DEPTH * gradients[p] * distance + EPSILON * depths[p]);
+        Vector difference = albedo[p] - albedo[q];
+        return cosine * expf(-depth - sqrtf(difference * difference) / DENOISE_SIGMA_ALBEDO);
+    };
+
+    /* Estimate the variance of each pixel's luminance from its nearest neighbors on the same surface. */
+    #pragma omp parallel for schedule(static)
+    for (int32_t y = 0; y < height; ++y)
+        for (int32_t x = 0; x < width; ++x)
+        {
+            size_t p = (size_t)y * width + x;
+            float sum = 0.0f, squares = 0.0f, total = 0.0f;
+            if (depths[p] > 0.0f)
+                for (int32_t dy = -2; dy <= 2; ++dy)
+                    for (int32_t dx = -2; dx <= 2; ++dx)
+                    {
+                        int32_t qx = x + dx, qy = y + dy;
+                        if ((qx < 0) || (qy < 0) || (qx >= width) || (qy >= height)) continue;
+                        size_t q = (size_t)qy * width + qx;
+                        float weight = geometry(p, q, sqrtf((float)(dx * dx + dy * dy)));
+                        float luminance = colors[0][q] * weights;
+                        sum += weight * luminance;
+                        squares += weight * luminance * luminance;
+                        total += weight;
+                    }
+
+            float mean = (total > 0.0f) ? sum / total : 0.0f;
+            variances[0][p] = (total > 0.0f) ? std::max(squares / total - mean * mean, 0.0f) : 0.0f;
+        }
+
+    /* Then filter the pixels, with taps twice as far apart at each iteration, until they would all be outside. */
+    int32_t current = 0;
+    for (int32_t iteration = 0, step = 1; (iteration < iterations) && (step < std::max(width, height));
+         ++iteration, step *= 2, current ^= 1)
+    {
+        const std::vector<Vector>& input = colors[current];
+        const std::vector<float>& variance = variances[current];
+        std::vector<Vector>& output = colors[current ^ 1];
+        std::vector<float>& filtered = variances[current ^ 1];
+
+        /* Compare luminances to the standard deviation blurred over the nearest pixels, which is more robust. */
+        #pragma omp parallel for schedule(static)
+        for (int32_t y = 0; y < height; ++y)
+            for (int32_t x = 0; x < width; ++x)
+            {
+                float sum = 0.0f, total = 0.0f;
+                for (int32_t dy = -1; dy <= 1; ++dy)
+                    for (int32_t dx = -1; dx <= 1; ++dx)
+                    {
+                        int32_t qx = x + dx, qy = y + dy;
+                        if ((qx < 0) || (qy < 0) || (qx >= width) || (qy >= height)) continue;
+                        float weight = kernel[std::abs(dx)] * kernel[std::abs(dy)];
+                        sum += weight * variance[(size_t)qy * width + qx];
+                        total += weight;
+                    }
+                deviations[(size_t)y * width + x] = sqrtf(sum / total);
+            }
+
+        #pragma omp parallel for schedule(dynamic, 4)
+        for (int32_t y = 0; y < height; ++y)
+            for (int32_t x = 0; x < width; ++x)
+            {
+                size_t p = (size_t)y * width + x;
+                if (!(depths[p] > 0.0f))
+                {
+                    output[p] = input[p];
+                    filtered[p] = variance[p];
+                    continue;
+                }
+
+                /* The variance of the weighted average is the weighted average of the variances, with the weights
+                 * squared over the total weight squared. */
+                float luminance = input[p] * weights;
+                float sigma = DENOISE_SIGMA_LUMINANCE * deviations[p] + EPSILON * luminance + 1e-10f;
+                Vector sum = ZERO;
+                float total = 0.0f, varianceSum = 0.0f;
+                for (int32_t dy = -2; dy <= 2; ++dy)
+                    for (int32_t dx = -2; dx <= 2; ++dx)
+                    {
+                        int32_t qx = x + dx * step, qy = y + dy * step;
+                        if ((qx < 0) || (qy < 0) || (qx >= width) || (qy >= height)) continue;
+                        size_t q = (size_t)qy * width + qx;
+                        float weight = (q == p) ? 1.0f : geometry(p, q, step * sqrtf((float)(dx * dx + dy * dy)));
+                        if (!(weight > 0.0f)) continue;
+
+                        weight *= kernel[std::abs(dx)] * kernel[std::abs(dy)]
+                                * expf(-std::abs(input[q] * weights - luminance) / sigma);
+                        sum += input[q] * weight;
+                        varianceSum += weight * weight * variance[q];
+                        total += weight;
+                    }
+
+                output[p] = sum / total;
+                filtered[p] = varianceSum / (total * total);
+            }
+    }
+
+    /* Multiply the filtered pixels back by their albedo. */
+    #pragma omp parallel for schedule(static)
+    for (size_t t = 0; t < count; ++t) pixels[t] = colors[current][t].cmul(scales[t]);
+}
+
+/* Applies the Reinhard tonemapping operator to a pixel array, keyed to its log-average luminance. */
+void TonemapPixels(Vector* pixels, size_t count, ColorSystem colorSystem)
+{
+    /* The luminance weights, once per color channel. */
+    const Vector weights = Vector(colorSystem.yRed, colorSystem.yGreen, colorSystem.yBlue);
+    const __m128 yr = _mm_set1_ps(weights.x), yg = _mm_set1_ps(weights.y), yb = _mm_set1_ps(weights.z);
+
+    /* Sum up the luminance logarithms over the whole render, four pixels at a time (in double precision, as
+     * there can be tens of millions of them). This is in base 2, which is what the fast logarithm computes. */
+    double logSum = 0.0;
+    size_t blocks = count / 4;
+    #pragma omp parallel for reduction(+:logSum) schedule(static)
+    for (size_t b = 0; b < blocks; ++b)
+    {
+        /* Transpose the four pixels into one register per color channel. */
+        __m128 r = pixels[4 * b + 0].m128, g = pixels[4 * b + 1].m128;
+        __m128 bl = pixels[4 * b + 2].m128, w = pixels[4 * b + 3].m128;
+        _MM_TRANSPOSE4_PS(r, g, bl, w);
+
+        /* Compute the four luminances and add their logarithms to the sum. */
+        __m128 luminance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r, yr), _mm_mul_ps(g, yg)), _mm_mul_ps(bl, yb));
+        float __attribute__((aligned(16))) logs[4];
+        _mm_store_ps(logs, FastLog2(_mm_add_ps(luminance, _mm_set1_ps(EPSILON))));
+        logSum += (double)logs[0] + (double)logs[1] + (double)logs[2] + (double)logs[3];
+    }
+
+    /* The last few pixels don't make up a block. */
+    for (size_t t = blocks * 4; t < count; ++t) logSum += log2(pixels[t] * weights + EPSILON);
+
+    /* Get the log-average luminance, and compute the tonemapping key using an exposure of 0.18. */
+    float avgLuminance = (float)exp2(logSum / count);
+    float key = 0.18f / avgLuminance;
+
+    /* Go over each pixel, and apply the Reinhard operator. */
+    #pragma omp parallel for schedule(static)
+    for (size_t t = 0; t < count; ++t)
+    {
+        float luminance = pixels[t] * weights;
+        pixels[t] = pixels[t] * (key / (1.0f + luminance * key));
+    }
+}
+
+/* Gamma-corrects a pixel array according to a color system. */
+void GammaCorrectPixels(Vector* pixels, size_t count, ColorSystem colorSystem)
+{
+    /* If we're using the special REC709 gamma formula... */
+    if (colorSystem.gamma == GAMMA_REC709)
+    {
+        /* Tabulate the piecewise formula over [0, 1], with one extra entry so that interpolation never reads
+         * past the end of the table. */
+        float table[TRANSFER_LUT_SIZE + 2];
+        for (int t = 0; t <= TRANSFER_LUT_SIZE; ++t)
+        {
+            float x = (float)t / TRANSFER_LUT_SIZE;
+            table[t] = GammaCorrect(Vector(x, x, x), colorSystem).x;
+        }
+        table[TRANSFER_LUT_SIZE + 1] = table[TRANSFER_LUT_SIZE];
+
+        /* Look up each color component, interpolating linearly between table entries. */
+        #pragma omp parallel for schedule(static)
+        for (size_t t = 0; t < count; ++t)
+        {
+            for (int c = 0; c < 3; ++c)
+            {
+                float x = (pixels[t][c] > 0.0f) ? std::min(pixels[t][c], 1.0f) * TRANSFER_LUT_SIZE : 0.0f;
+                int i = (int)x;
+                pixels[t][c] = table[i] + (table[i + 1] - table[i]) * (x - i);
+            }
+        }
+    }
+    else
+    {
+        /* Otherwise, use a standard gamma power curve, on all components at once. */
+        float power = 1.0f / colorSystem.gamma;
+        #pragma omp parallel for schedule(static)
+        for (size_t t = 0; t < count; ++t)
+        {
+            pixels[t] = FastPow(pixels[t].m128, power);
+            pixels[t].w = 0.0f;
+        }
+    }
+}
+
+/* Maps an array of values to false colors, from black through blue, red and yellow to white. */
+void FalseColorPixels(const float* values, size_t count, Vector* pixels, float* low, float* high)
+{
+    /* These are the colors at evenly spaced values, between which colors are interpolated. */
+    const Vector gradient[5] = {Vector(0.0f, 0.0f, 0.0f), Vector(0.1f, 0.1f, 0.8f), Vector(0.9f, 0.1f, 0.1f),
+                                Vector(1.0f, 0.9f, 0.1f), Vector(1.0f, 1.0f, 1.0f)};
+
+    /* Map the values between their 1st and 99th percentiles. */
+    if (count == 0) return;
+    std::vector<float> sorted(values, values + count);
+    std::nth_element(sorted.begin(), sorted.begin() + (count - 1) / 100, sorted.end());
+    *low = sorted[(count - 1) / 100];
+    std::nth_element(sorted.begin(), sorted.begin() + (count - 1) * 99 / 100, sorted.end());
+    *high = sorted[(count - 1) * 99 / 100];
+    float offset = *low, scale = (*high > *low) ? 4.0f / (*high - *low) : 0.0f;
+
+    #pragma omp parallel for
+    for (size_t t = 0; t < count; ++t)
+    {
+        float x = std::max(0.0f, std::min((values[t] - offset) * scale, 4.0f));
+        int i = std::min((int)x, 3);
+        pixels[t] = lerp(gradient[i], gradient[i + 1], x - i);
+    }
+}
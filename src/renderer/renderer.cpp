@@ -13,6 +13,33 @@
  * but this heavily depends on hardware factors. 2 is usually best. */
 #define LEAFSIZE 2
 
+/* These are the block sizes of the arenas holding the scene entities. Primitives get large blocks (huge pages, if
+ * enabled), while there are usually only a few of the other entities. */
+#define PRIMITIVE_BLOCK (2 * 1024 * 1024)
+#define ENTITY_BLOCK (16 * 1024)
+
+/* This is how much slower (in surface area heuristic cost) a refitted BVH may get than the BVH as built before it is
+ * rebuilt instead. Refitting is much faster than building, but the nodes get looser as primitives move around. */
+#define REFIT_THRESHOLD 1.5f
+
+/* With path guiding, the path tracer samples directions with the material with this probability, and otherwise
+ * with the guiding tree. */
+#define GUIDING_MATERIAL_FRACTION 0.5f
+
+/* This is the most vertices of each path the path tracer records into the guiding tree, when training it. */
+#define GUIDING_VERTICES 16
+
+/* This is a vertex of a path tracer path to record into the guiding tree, once the light found beyond it is known. */
+struct GuidedVertex
+{
+    /* The guiding tree region the vertex is in, and the direction the path left it in. */
+    uint32_t tree;
+    Vector direction;
+    /* The density the direction was sampled with, the throughput of the path after it, and the radiance the path
+     * had found before it. */
+    float density, beta, radiance;
+};
+
 /* These are scene entity types, which indicate the nature of the next object in the scene file. */
 enum EntityType { COLORSYSTEM = 0, CAMERA = 1, DISTRIBUTION = 2, MATERIAL = 3, LIGHT = 4, PRIMITIVE = 5 };
 
@@ -36,8 +63,16 @@ bool ReadHeader(fstream& file, EntityHeader* header)
     return (!file.eof());
 }
 
-Renderer::Renderer(string scene)
+Renderer::Renderer(string scene, bool hugePages)
 {
+    /* Remember which scene this is, for reporting. */
+    report.scene = scene;
+    photonMap = nullptr;
+    guidingTree = nullptr;
+    features = nullptr;
+    composite = nullptr;
+    double loadTime = omp_get_wtime();
+
     /* Open the scene file. */
     fstream file;
     file.open(scene, ios::in | ios::binary);
@@ -56,101 +91,316 @@ Renderer::Renderer(string scene)
     primitives = new vector<Primitive*>();
     materials = new vector<Material*>();
     lights = new vector<Light*>();
+    distributionArena = new Arena(ENTITY_BLOCK);
+    primitiveArena = new Arena(PRIMITIVE_BLOCK, hugePages);
+    materialArena = new Arena(ENTITY_BLOCK);
+    lightArena = new Arena(ENTITY_BLOCK);
 
     /* Read every scene entity in the file. */
+    int64_t parseTime = TimelineEnabled() ? TimelineClock() : -1;
     EntityHeader header;
     while (ReadHeader(file, &header))
     {
         /* Check the entity type to know what to do. */
         switch(header.type)
         {
-            case DISTRIBUTION: distributions->push_back(GetDistribution(header.subtype, file)); break;
-            case     MATERIAL: materials->push_back(GetMaterial(header.subtype, file, distributions)); break;
-            case        LIGHT: lights->push_back(GetLight(header.subtype, file, distributions)); break;
-            case    PRIMITIVE: primitives->push_back(GetPrimitive(header.subtype, file, materials, lights)); break;
+            case DISTRIBUTION: distributions->push_back(GetDistribution(header.subtype, file, distributionArena)); break;
+            case     MATERIAL: materials->push_back(GetMaterial(header.subtype, file, distributions, materialArena)); break;
+            case        LIGHT: lights->push_back(GetLight(header.subtype, file, distributions, lightArena)); break;
+            case    PRIMITIVE: primitives->push_back(GetPrimitive(header.subtype, file, materials, lights, primitiveArena)); break;
             case  COLORSYSTEM: colorSystem = ColorSystems[header.subtype]; break;
             case       CAMERA: camera = GetCamera(header.subtype, file); break;
         }
     }
 
+    if (parseTime >= 0) RecordTimelineEvent("Scene parsing", parseTime, TimelineClock(), -1);
+
     /* Print out statistics. */
     cout << " complete!" << endl << endl << "[+] Scene statistics:" << endl;
     cout << "    | " << primitives->size() << " geometric primitive(s)." << endl;
     cout << "    | " << distributions->size() << " spectral distribution(s)." << endl;
     cout << "    | " << materials->size() << " material(s)." << endl;
     cout << "    | " << lights->size() << " light(s)." << endl;
+    printf("    | %.1f MiB of primitives, in %u block(s)%s.\n", primitiveArena->Used() / 1048576.0,
+           (unsigned)primitiveArena->Blocks(), hugePages ? " of huge pages" : "");
 
     /* Build the bounding volume hierarchy. */
+    report.loadSeconds = omp_get_wtime() - loadTime;
     cout << endl << "[+] Building acceleration structure..." << flush;
-    bvh = new BVH(primitives, LEAFSIZE);
+    double buildTime = omp_get_wtime();
+    sceneOrder = *primitives;
+    vertexCount = 0;
+    for (size_t t = 0; t < primitives->size(); ++t) vertexCount += primitives->at(t)->VertexCount();
+    { TimelineScope scope("BVH build"); bvh = new BVH(primitives, LEAFSIZE); }
+    FindEmitters();
+    report.buildSeconds = omp_get_wtime() - buildTime;
     cout << " built!" << endl << "    | " << bvh->nLeafs << " leaves over " << bvh->nNodes << " nodes." << endl;
+    cout << "    | " << emitters.size() << " emissive primitive(s), sampled by power or by a light BVH of "
+         << lightTree.Nodes() << " nodes." << endl;
 
     /* Close the file. */
     cout << endl << "[+] Scene successfully loaded!" << endl << endl;
     file.close();
 }
 
+void Renderer::FindEmitters()
+{
+    /* Find the power of every light, from its emittance facing its surface integrated over the spectrum (both of its
+     * sides emit, in every direction). Lights of zero area or emittance don't emit anything. */
+    typedef SpectralGrid<RESOLUTION_FINAL> Grid;
+    emitters.clear();
+    emitterIndices.clear();
+    vector<float> powers;
+    for (size_t t = 0; t < sceneOrder.size(); ++t)
+    {
+        Primitive* primitive = sceneOrder[t];
+        if (!primitive->light || !(primitive->Area() > 0.0f)) continue;
+
+        Vector normal = primitive->Normal(primitive->Centroid());
+        double emittance = 0.0;
+        for (int w = 0; w < Grid::wavelengths; ++w)
+            emittance += primitive->light->Emittance(ZERO - normal, normal, Grid::Wavelength(w)) * RESOLUTION_FINAL;
+
+        float power = (float)(emittance * primitive->Area() * 2.0 * PI);
+        if (!(power > 0.0f)) continue;
+
+        emitterIndices[primitive] = emitters.size();
+        emitters.push_back(primitive);
+        powers.push_back(power);
+    }
+
+    emitterTable = AliasTable(powers);
+    lightTree = LightBVH(emitters, powers);
+}
+
+float Renderer::EmitterDensity(const Primitive* emitter) const
+{
+    unordered_map<const Primitive*, uint32_t>::const_iterator index = emitterIndices.find(emitter);
+    if (index == emitterIndices.end()) return 0.0f;
+    return emitterTable.Probability(index->second) / emitters[index->second]->Area();
+}
+
+float Renderer::LightTreeRatio(const Primitive* emitter, Vector point) const
+{
+    /* Both pick a uniform point on the emitter, so only the probabilities of picking the emitter differ. */
+    unordered_map<const Primitive*, uint32_t>::const_iterator index = emitterIndices.find(emitter);
+    if (index == emitterIndices.end()) return 1.0f;
+    return lightTree.Probability(point, index->second) / emitterTable.Probability(index->second);
+}
+
+bool Renderer::UpdateVertices(const vector<Vector>& vertices, bool* rebuilt)
+{
+    if (vertices.size() != vertexCount) return false;
+
+    /* Move every primitive, then refit the BVH (the primitives are independent, so this is done in parallel). */
+    double updateTime = omp_get_wtime();
+    int64_t moveTime = TimelineEnabled() ? TimelineClock() : -1;
+    vector<size_t> offsets(sceneOrder.size());
+    for (size_t t = 0, offset = 0; t < sceneOrder.size(); offset += sceneOrder[t]->VertexCount(), ++t)
+        offsets[t] = offset;
+
+    #pragma omp parallel for schedule(static)
+    for (int64_t t = 0; t < (int64_t)sceneOrder.size(); ++t) sceneOrder[t]->SetVertices(&vertices[offsets[t]]);
+    if (moveTime >= 0) RecordTimelineEvent("Vertex update", moveTime, TimelineClock(), -1);
+
+    bool rebuiltBVH;
+    { TimelineScope scope("BVH refit"); rebuiltBVH = bvh->update(REFIT_THRESHOLD); }
+    FindEmitters();
+    report.buildSeconds += omp_get_wtime() - updateTime;
+
+    if (rebuilt) *rebuilt = rebuiltBVH;
+    return true;
+}
+
+bool Renderer::LoadVertices(string path, bool verbose)
+{
+    /* The file must hold exactly the scene's vertices. */
+    FILE* file = fopen(path.c_str(), "rb");
+    vector<float> coordinates(vertexCount * 3 + 1);
+    size_t read = file ? fread(&coordinates[0], sizeof(float), coordinates.size(), file) : 0;
+    if (file) fclose(file);
+    if (read != vertexCount * 3)
+    {
+        if (!verbose) return false;
+        if (!file) cout << "[!] Failed to open the vertex file <" << path << ">." << endl;
+        else cout << "[!] The vertex file <" << path << "> doesn't hold the scene's " << vertexCount
+                  << " vertices." << endl;
+        return false;
+    }
+
+    vector<Vector> vertices(vertexCount);
+    for (size_t t = 0; t < vertexCount; ++t)
+        vertices[t] = Vector(coordinates[t * 3 + 0], coordinates[t * 3 + 1], coordinates[t * 3 + 2]);
+
+    double updateTime = omp_get_wtime();
+    bool rebuilt;
+    UpdateVertices(vertices, &rebuilt);
+    updateTime = omp_get_wtime() - updateTime;
+
+    if (!verbose) return true;
+    if (rebuilt) printf("[+] Moved %u vertices and rebuilt the BVH, in %.2f ms.\n", (unsigned)vertexCount,
+                        updateTime * 1000.0);
+    else printf("[+] Moved %u vertices and refitted the BVH (%.0f%% of its built cost), in %.2f ms.\n",
+                (unsigned)vertexCount, bvh->degradation() * 100.0f, updateTime * 1000.0);
+    return true;
+}
+
 void Renderer::TonemapRender(Vector* pixels)
 {
-    /* Sum up the luminance logarithms over the whole render... */
-    float avgLuminance = 0.0f;
+    TimelineScope scope("Tonemapping");
+
+    /* Apply the Reinhard operator over the whole render, or only over the window rendered if the rest of the render
+     * is left black (so the black doesn't darken the key). */
+    if (window.Empty() || composite)
+    {
+        TonemapPixels(pixels, pixelCount, colorSystem);
+        return;
+    }
+
+    vector<Vector> windowPixels(window.width * window.height);
+    for (size_t t = 0; t < windowPixels.size(); ++t)
+        windowPixels[t] = pixels[(window.y + t / window.width) * renderParams.width + window.x + t % window.width];
+    TonemapPixels(&windowPixels[0], windowPixels.size(), colorSystem);
+    for (size_t t = 0; t < windowPixels.size(); ++t)
+        pixels[(window.y + t / window.width) * renderParams.width + window.x + t % window.width] = windowPixels[t];
+}
+
+void Renderer::AverageFeatures(int32_t samples, int32_t resolution, vector<Vector>* albedo, vector<Vector>* normals,
+                               vector<float>* depths)
+{
+    /* Average the albedos as the render (over the wavelengths too), relative to that of a white surface, which is
+     * the average of the color-matching curves over the spectrum. */
+    typedef SpectralGrid<RESOLUTION_FINAL> Grid;
+    const ColorPipeline pipeline(colorSystem, Grid::MatchingCurve(), Grid::wavelengths);
+    albedo->resize(pixelCount);
+    ColorsToRGB(&features->albedo[0], &(*albedo)[0], samples, resolution);
+
+    Vector matching = ZERO, white;
+    for (int32_t wavelength = WAVELENGTH_MIN; wavelength <= WAVELENGTH_MAX; ++wavelength)
+        matching += ColorMatching((float)wavelength);
+    matching = matching / (float)(WAVELENGTH_MAX - WAVELENGTH_MIN + 1);
+    matching.w = 1.0f;
+    pipeline.ToRGB(&matching, 1, &white, 1.0f);
+    white.w = 1.0f;
+
+    /* Average the normals and depths over the samples which hit anything, the normals being made unit length. */
+    normals->resize(pixelCount);
+    depths->resize(pixelCount);
     for (size_t t = 0; t < pixelCount; ++t)
     {
-        /* Compute the luminance and add its logarithm to the sum. */
-        float luminance = Luminance(pixels[t], colorSystem);
-        avgLuminance += log(luminance + EPSILON);
+        (*albedo)[t] = (*albedo)[t].cdiv(white);
+        const Vector& normal = features->normals[t];
+        (*normals)[t] = (normal * normal > 0.0f) ? normalize(normal) : ZERO;
+        (*depths)[t] = (features->hits[t] > 0) ? features->depths[t] / features->hits[t] : 0.0f;
     }
+}
+
+void Renderer::DenoiseRender(Vector* pixels, int32_t samples, const RenderSettings& settings)
+{
+    TimelineScope scope("Denoising");
+
+    vector<Vector> albedo, normals;
+    vector<float> depths;
+    AverageFeatures(samples, settings.resolution, &albedo, &normals, &depths);
+    DenoisePixels(pixels, &albedo[0], &normals[0], &depths[0], renderParams.width, renderParams.height,
+                  settings.denoise, colorSystem);
+}
+
+bool Renderer::SaveAOVs(string base, int32_t samples, int32_t resolution)
+{
+    TimelineScope scope("SaveAOVs");
 
-    /* Get the log-average luminance. */
-    avgLuminance = exp(avgLuminance / pixelCount);
+    vector<Vector> albedo, normals;
+    vector<float> depths;
+    AverageFeatures(samples, resolution, &albedo, &normals, &depths);
 
-    /* Compute the tonemapping key using an exposure of 0.18. */
-    float key = 0.18f / avgLuminance;
+    /* Number the primitives and materials in scene file order, the IDs being saved as floats (which are exact up to
+     * 2^24). Lights have no material. */
+    unordered_map<const Primitive*, uint32_t> primitiveIndices;
+    unordered_map<const Material*, uint32_t> materialIndices;
+    for (size_t t = 0; t < sceneOrder.size(); ++t) primitiveIndices[sceneOrder[t]] = t;
+    for (size_t t = 0; t < materials->size(); ++t) materialIndices[(*materials)[t]] = t;
 
-    /* Go over each pixel... */
+    vector<float> primitiveIDs(pixelCount, -1.0f), materialIDs(pixelCount, -1.0f);
     for (size_t t = 0; t < pixelCount; ++t)
     {
-        /* Apply the Reinhard operator. */
-        float luminance = Luminance(pixels[t], colorSystem);
-        pixels[t] = pixels[t] * (key / (1.0f + luminance * key));
+        const Primitive* primitive = features->primitives[t];
+        if (!primitive) continue;
+        primitiveIDs[t] = (float)primitiveIndices[primitive];
+        if (!primitive->light && primitive->material) materialIDs[t] = (float)materialIndices[primitive->material];
     }
+
+    /* Every image is saved even if one fails. */
+    int32_t width = renderParams.width, height = renderParams.height;
+    return SavePFM(base + ".depth.pfm", &depths[0], width, height)
+         & SavePFM(base + ".normal.pfm", &normals[0], width, height)
+         & SavePFM(base + ".albedo.pfm", &albedo[0], width, height)
+         & SavePFM(base + ".primitive.pfm", &primitiveIDs[0], width, height)
+         & SavePFM(base + ".material.pfm", &materialIDs[0], width, height);
 }
 
 void Renderer::GammaCorrectRender(Vector* pixels)
 {
+    TimelineScope scope("Gamma correction");
+
     /* Apply the gamma correction operator on each pixel. */
-    for (size_t t = 0; t < pixelCount; ++t) pixels[t] = GammaCorrect(pixels[t], colorSystem);
+    GammaCorrectPixels(pixels, pixelCount, colorSystem);
 }
 
-void Renderer::SaveToPPM(Vector* pixels, string render, time_t elapsedTime)
+bool Renderer::SaveToPPM(Vector* pixels, string render, time_t elapsedTime)
 {
-    /* Create the destination file. */
-    FILE* file = fopen(render.c_str(), "w");
-    if (file == 0) return;
-
-    /* Write a short header. */
-    fprintf(file, "P3\n\n# Generated by Lambda.\n# Rendered in %dh%dm%ds.\n\n%d %d 255\n",
-            (int)elapsedTime / 3600, (int)(elapsedTime % 3600) / 60, (int)elapsedTime % 60,
-            renderParams.width, renderParams.height);
+    TimelineScope scope("SaveToPPM");
 
-    /* Write the pixel buffer in. */
-    for (size_t t = 0; t < pixelCount; ++t)
-        fprintf(file, "%d %d %d ", (int)(min(pixels[t].x, 1.0f) * 255.0f),
-                                   (int)(min(pixels[t].y, 1.0f) * 255.0f),
-                                   (int)(min(pixels[t].z, 1.0f) * 255.0f));
+    /* Write the pixel buffer, with the render time in the header. */
+    char comment[64];
+    sprintf(comment, "Generated by Lambda.\nRendered in %dh%dm%ds.",
+            (int)elapsedTime / 3600, (int)(elapsedTime % 3600) / 60, (int)elapsedTime % 60);
+    return SavePPM(render, pixels, renderParams.width, renderParams.height, comment);
+}
 
-    /* Close the file. */
-    fclose(file);
+/* Notes the features of the surface a camera ray hit. */
+static void NoteFeatures(const Intersection& intersection, Vector normal, SurfaceFeatures* features)
+{
+    features->depth = intersection.t;
+    features->normal = normal;
+    features->primitive = intersection.primitive;
 }
 
-float Renderer::Radiance(Ray ray, float wavelength, mt19937* prng)
+float Renderer::Radiance(Ray ray, float wavelength, Sampler* sampler, const RenderSettings& settings,
+                         TraversalCost* cost, SurfaceFeatures* features, PathState path)
 {
+    if (path.bounce == 0) STATISTIC(paths);
+
+    /* This is the light gathered from the photon map along the path, if any. Light found through specular or glass
+     * materials after gathering it was already in the photon map, so it is left out. */
+    float caustics = 0.0f;
+
+    /* When training the guiding tree, these are the vertices to record the light found beyond into it. */
+    bool recording = guidingTree && guidingTree->recording;
+    GuidedVertex vertices[GUIDING_VERTICES];
+    int recorded = 0;
+
+    /* This ends the path with some radiance, recording the radiance each vertex found beyond it, which is what the
+     * path found since, over its throughput since the camera. */
+    auto finish = [&](float radiance) -> float
+    {
+        for (int k = 0; k < recorded; ++k)
+            guidingTree->Record(vertices[k].tree, vertices[k].direction,
+                                max(radiance - vertices[k].radiance, 0.0f) / (vertices[k].beta * vertices[k].density));
+        return radiance;
+    };
+
     /* Light path loop. */
-    while (true)
+    for (; ; ++path.bounce)
     {
         /* Intersect the ray with the scene. */
         Intersection intersection;
-        if (!bvh->getIntersection(ray, &intersection, false)) return 0.0f;
+        if (!(cost ? bvh->getIntersection(ray, &intersection, false, cost)
+                   : bvh->getIntersection(ray, &intersection, false)))
+        {
+            STATISTIC_PATH_LENGTH(path.bounce);
+            return finish(caustics);
+        }
 
         /* Move the ray forward to the intersection point. */
         Vector point = ray.o + ray.d * intersection.t;
@@ -158,174 +408,961 @@ float Renderer::Radiance(Ray ray, float wavelength, mt19937* prng)
 
         /* Get the surface normal at the intersection point. */
         Vector normal = intersection.primitive->Normal(point);
+        if (features && (path.bounce == 0)) NoteFeatures(intersection, normal, features);
 
         /* If the geometry intersected is a light source, return the emitted light. */
         if (intersection.primitive->light)
         {
             /* Note we assume light sources do not reflect light, this is usually correct. */
-            return intersection.primitive->light->Emittance(incident, normal, wavelength);
+            STATISTIC_PATH_LENGTH(path.bounce);
+            if (path.gathered && path.specular) return finish(caustics);
+            double emittance = intersection.primitive->light->Emittance(incident, normal, wavelength);
+            return finish(caustics + path.beta * emittance);
+        }
+
+        /* Gather the caustics reflected by connectable materials, attenuated by the medium as below. */
+        Material* material = intersection.primitive->material;
+        if (photonMap && material->Connectable())
+        {
+            float attenuation = exp(-intersection.t * ((incident * normal > 0.0f) ? material->e2 : material->e1));
+            caustics += path.beta * attenuation * photonMap->Radiance(point, incident, normal, wavelength, material);
+            path.gathered = true;
+            path.specular = false;
+        }
+        else path.specular = true;
+
+        /* Paths which reached the maximum depth end here, without the light beyond it. */
+        if ((settings.maxDepth > 0) && (path.bounce >= (uint32_t)settings.maxDepth))
+        {
+            STATISTIC(depthTerminations);
+            STATISTIC_PATH_LENGTH(path.bounce);
+            return finish(caustics);
         }
 
-        /* Otherwise, compute the incoming radiance using the Rendering Equation. To do this elegantly, we
-         * compute an importance-sampled ray, then calculate the correct reflectance (if the importance
-         * sampling was perfect, the reflectance would be constant, but this is not required). Note the
-         * cosine term from Lambert's cosine law is folded into the Reflectance method for efficiency. */
-        Vector exitant = intersection.primitive->material->Sample(&point, incident, normal, wavelength, prng);
-        float radiance = intersection.primitive->material->Reflectance(incident, exitant, normal, wavelength, true);
+        /* Connectable materials are guided by the region of the guiding tree they are in, once it learned something,
+         * and recorded into it when training it. */
+        bool guidable = guidingTree && material->Connectable();
+        uint32_t region = guidable ? guidingTree->Lookup(point) : 0;
+        const DirectionalTree* guide = (guidable && guidingTree->Tree(region).Trained()) ? &guidingTree->Tree(region)
+                                                                                          : nullptr;
+
+        /* This continues a path from the intersection point, returning false if it was terminated, along with the
+         * density the direction was sampled with if it is to be recorded. */
+        auto scatter = [&](PathState* state, Ray* next, float* density) -> bool
+        {
+            /* Otherwise, compute the incoming radiance using the Rendering Equation. To do this elegantly, we
+             * compute an importance-sampled ray, then calculate the correct reflectance (if the importance
+             * sampling was perfect, the reflectance would be constant, but this is not required). Note the
+             * cosine term from Lambert's cosine law is folded into the Reflectance method for efficiency. */
+            Vector origin = point, exitant;
+            float radiance, reflectance;
+            if (!guide)
+            {
+                sampler->SetDimension(BOUNCE_DIMENSION(state->bounce) + state->offset);
+                exitant = material->Sample(&origin, incident, normal, wavelength, sampler);
+                radiance = reflectance = material->Reflectance(incident, exitant, normal, wavelength, true);
+                *density = (recording && guidable) ? material->Density(incident, normalize(exitant), normal, wavelength)
+                                                   : 0.0f;
+            }
+            else
+            {
+                /* With path guiding, the direction is sampled either by the material or by the guiding tree, from
+                 * the same numbers (connectable materials draw two), and its reflectance is that of the scattering
+                 * function over the density of sampling it either way. */
+                sampler->SetDimension(BOUNCE_DIMENSION(state->bounce) + 2 + state->offset);
+                float choice = sampler->Next1D();
+                sampler->SetDimension(BOUNCE_DIMENSION(state->bounce) + state->offset);
+                if (choice < GUIDING_MATERIAL_FRACTION)
+                    exitant = normalize(material->Sample(&origin, incident, normal, wavelength, sampler));
+                else
+                {
+                    float u1, u2;
+                    sampler->Next2D(&u1, &u2);
+                    exitant = guide->Sample(u1, u2);
+                    origin = origin + ((incident * normal > 0.0f) ? ZERO - normal : normal) * EPSILON;
+                }
+
+                /* The reflectance played russian roulette with is that of the material sampling the direction, as
+                 * the guided one is lower where the tree found more light than the material reflects. */
+                float scattering = material->Evaluate(incident, exitant, normal, wavelength)
+                                 * std::abs(exitant * normal);
+                float materialDensity = material->Density(incident, exitant, normal, wavelength);
+                *density = GUIDING_MATERIAL_FRACTION * materialDensity
+                         + (1.0f - GUIDING_MATERIAL_FRACTION) * guide->Density(exitant);
+                radiance = (*density > 0.0f) ? scattering / *density : 0.0f;
+                reflectance = (materialDensity > 0.0f) ? scattering / materialDensity : radiance;
+            }
+            STATISTIC(bounces);
 
-        /* Apply the Beer-Lambert Law to attenuate the radiance as the ray travels through the medium. We just find
-         * which medium the light ray is actually in, by comparing its last direction with the direction of the
-         * normal of the object it last intersected, and compute the amount of loss using the extinction coeff. */
-        if (incident * normal > 0.0f) radiance *= exp(-intersection.t * intersection.primitive->material->e2);
-        else radiance *= exp(-intersection.t * intersection.primitive->material->e1);
+            /* Apply the Beer-Lambert Law to attenuate the radiance as the ray travels through the medium. We just
+             * find which medium the light ray is actually in, by comparing its last direction with the direction
+             * of the normal of the object it last intersected, and compute the amount of loss using the extinction
+             * coefficient. */
+            float transmittance = exp(-intersection.t * ((incident * normal > 0.0f) ? material->e2 : material->e1));
+            radiance *= transmittance;
+            reflectance *= transmittance;
 
-        /* Russian roulette for unbiased depth. Note this means the loop is guaranteed to terminate, since the
-         * reflectance is defined as being strictly less than 1. */
-        if (RandomVariable(prng) > radiance) return 0.0f;
+            /* Guided directions the material doesn't scatter light into end the path. */
+            if (guide && !(radiance > 0.0f))
+            {
+                STATISTIC_PATH_LENGTH(state->bounce + 1);
+                return false;
+            }
+
+            /* Russian roulette for unbiased depth, once past the minimum depth. By default, the path continues
+             * with the probability of the reflectance (the loop is then guaranteed to terminate, since it is
+             * strictly less than 1), otherwise it continues with the probability of its throughput over the
+             * threshold, if it is under it, and its throughput is divided by that probability (as it is for guided
+             * directions, whose reflectance differs from that of the material). */
+            if (state->bounce < (uint32_t)settings.minDepth) state->beta *= radiance;
+            else
+            {
+                sampler->SetDimension(BOUNCE_DIMENSION(state->bounce) + BOUNCE_DIMENSIONS - 1 + state->offset);
+                float survival = (settings.roulette == ROULETTE_THROUGHPUT)
+                               ? min(state->beta * radiance / settings.rouletteThreshold, 1.0f)
+                               : min(reflectance, 1.0f);
+                if ((settings.roulette == ROULETTE_THROUGHPUT) ? !(sampler->Next1D() < survival)
+                                                                : (sampler->Next1D() > survival))
+                {
+                    STATISTIC(rouletteTerminations);
+                    STATISTIC_PATH_LENGTH(state->bounce + 1);
+                    return false;
+                }
+
+                if ((settings.roulette == ROULETTE_THROUGHPUT) || guide) state->beta *= radiance / survival;
+            }
+
+            *next = Ray(origin, normalize(exitant));
+            return true;
+        };
+
+        /* Split the path into branches at its first diffuse or glossy surface, each drawing from dimensions of its
+         * own (the first one from the path's) and carrying an equal share of its throughput. */
+        if ((settings.splits > 1) && !path.split && material->Connectable())
+        {
+            float radiance = caustics;
+            for (int32_t k = 0; k < settings.splits; ++k)
+            {
+                PathState branch = path;
+                branch.offset = path.offset + k * SPLIT_DIMENSIONS;
+                branch.beta = path.beta / settings.splits;
+                branch.split = true;
+
+                Ray next = ray;
+                float density;
+                if (!scatter(&branch, &next, &density)) continue;
+                ++branch.bounce;
+                float found = Radiance(next, wavelength, sampler, settings, cost, nullptr, branch);
+                if (recording && (density > 0.0f)) guidingTree->Record(region, next.d, found / (branch.beta * density));
+                radiance += found;
+            }
+
+            return finish(radiance);
+        }
 
         /* Go to the next ray bounce. */
-        ray = Ray(point, normalize(exitant));
+        float density;
+        if (!scatter(&path, &ray, &density)) return finish(caustics);
+        if (recording && (density > 0.0f) && (recorded < GUIDING_VERTICES))
+        {
+            GuidedVertex vertex = {region, ray.d, density, path.beta, caustics};
+            vertices[recorded++] = vertex;
+        }
     }
 
     /* No light path formed. */
-    return 0.0f;
+    return finish(caustics);
 }
 
-void Renderer::Render(string render, size_t threads)
+int32_t Renderer::TileCount() const
 {
-    /* First, we need to allocate a large enough pixel buffer. */
-    Vector* pixels = new Vector[pixelCount];
+    return ((renderParams.width + TILESIZE - 1) / TILESIZE) * ((renderParams.height + TILESIZE - 1) / TILESIZE);
+}
 
-    /* Set the number of OpenMP threads. If zero was passed, default to the number
-     * of execution units available on the system for maximum performance. */
-    omp_set_num_threads((threads == 0) ? omp_get_num_procs() : threads);
-    if (threads == 0) {
-        threads = omp_get_num_procs();
-    }
-    cout << "[+] Initializing, " << threads << " threads scheduled..." << flush;
+void Renderer::TileBounds(int32_t tile, int32_t* x0, int32_t* y0, int32_t* x1, int32_t* y1) const
+{
+    /* Tiles are numbered row by row, the last row and column may be cut short. */
+    int32_t tilesX = (renderParams.width + TILESIZE - 1) / TILESIZE;
+    *x0 = (tile % tilesX) * TILESIZE, *x1 = min(*x0 + TILESIZE, renderParams.width);
+    *y0 = (tile / tilesX) * TILESIZE, *y1 = min(*y0 + TILESIZE, renderParams.height);
 
-    /* Now, create PRNG states for each thread. Note the seeds are actually
-     * deterministic to thread count, which can often be an advantage. */
-    vector<mt19937*>* threadPRNG = new vector<mt19937*>();
-    for (size_t t = 0; t < threads; ++t)
+    /* They are cut to the window being rendered, if any. */
+    if (window.Empty()) return;
+    *x0 = max(*x0, window.x), *x1 = min(*x1, window.x + window.width);
+    *y0 = max(*y0, window.y), *y1 = min(*y1, window.y + window.height);
+}
+
+vector<int32_t> Renderer::WindowTiles() const
+{
+    vector<int32_t> tiles;
+    for (int32_t t = 0; t < TileCount(); ++t)
     {
-        mt19937* prng = new mt19937();
-        prng->seed(0x530FD819 * (t + 1));
-        threadPRNG->push_back(prng);
+        int32_t x0, y0, x1, y1;
+        TileBounds(t, &x0, &y0, &x1, &y1);
+        if ((x1 > x0) && (y1 > y0)) tiles.push_back(t);
     }
 
-    /* We're all set, record the starting time. */
-    time_t startTime = time(nullptr);
-    cout << " ready!" << endl;
-    cout << "[+] Raytracing..." << flush;
-    time_t lastTime = startTime;
+    return tiles;
+}
+
+template <typename Grid>
+void Renderer::RenderTiles(Vector* colors, const vector<int32_t>& tiles, int32_t firstSample, int32_t sampleCount,
+                           const RenderSettings& settings, bool showProgress)
+{
+    TimelineScope scope("Raytracing");
+
+    /* These are shared by all threads to integrate spectra into colors, and importance-sample wavelengths. */
+    const ColorPipeline pipeline(colorSystem, Grid::MatchingCurve(), Grid::wavelengths);
+    const WavelengthSampler wavelengthSampler;
+    const int stride = pipeline.Stride();
+    const Vector* matchingCurve = Grid::MatchingCurve();
+
+    /* Bidirectional path tracing adds the light tracing contributions to any pixel of the image, from any thread. */
+    bool bidirectional = (settings.integrator == INTEGRATOR_BIDIRECTIONAL);
+    float* splats = bidirectional ? new float[pixelCount * 4]() : nullptr;
+
+    /* Keep track of the progress, for display purposes. */
+    time_t lastTime = time(nullptr);
     size_t lastProgress = 0;
     float lastSpeed = 0.0f;
     size_t progress = 0;
+    size_t total = 0;
+    for (size_t t = 0; t < tiles.size(); ++t)
+    {
+        int32_t x0, y0, x1, y1;
+        TileBounds(tiles[t], &x0, &y0, &x1, &y1);
+        total += (x1 - x0) * (y1 - y0);
+    }
 
-    /* Go over each pixel in the image, in parallel. */
-    #pragma omp parallel for schedule(dynamic, 1)
-    for (size_t t = 0; t < pixelCount; ++t)
+    #pragma omp parallel
     {
-        /* Get the current thread's PRNG state. */
-        mt19937* prng = threadPRNG->at(threadID);
+        /* Each thread has a buffer for the spectra and integrated colors of the tile it is working on. */
+        float* spectra = (float*)_mm_malloc(TILESIZE * TILESIZE * stride * sizeof(float), 16);
+        Vector* tileColors = new Vector[TILESIZE * TILESIZE];
 
-        /* Get this pixel's position. */
-        int x = t % renderParams.width;
-        int y = t / renderParams.width;
+        /* And the same for the albedo spectra and colors, if the features are to be found. */
+        float* albedoSpectra = features ? (float*)_mm_malloc(TILESIZE * TILESIZE * stride * sizeof(float), 16)
+                                        : nullptr;
+        Vector* tileAlbedo = features ? new Vector[TILESIZE * TILESIZE] : nullptr;
 
-        /* Create a spectral radiance array. */
-        float radiance[WAVELENGTHS] = {0.0f};
+        /* Each thread has its own sampler, and subpaths for bidirectional path tracing. */
+        Sampler* sampler = GetSampler(settings.sampler, settings.seed);
+        BidirectionalPaths paths;
+        paths.lightTree = (settings.lightSampling == LIGHTS_BVH);
 
-        /* Iterate for the number of desired samples... */
-        for (int s = 0; s < renderParams.samples; ++s)
+        /* Go over each tile, in parallel. */
+        #pragma omp for schedule(dynamic, 1)
+        for (int t = 0; t < (int)tiles.size(); ++t)
         {
-            /* Normalize the pixel's coordinates with jitter. */
-            float u = 2.0f * ((float)x + RandomVariable(prng) - 0.5f) / renderParams.width - 1.0f;
-            float v = 2.0f * ((float)y + RandomVariable(prng) - 0.5f) / renderParams.height - 1.0f;
+            int tile = tiles[t];
+            TimelineScope tileScope("Tile", tile);
+
+            /* Get this tile's bounds. */
+            int32_t x0, y0, x1, y1;
+            TileBounds(tile, &x0, &y0, &x1, &y1);
+            int tileWidth = x1 - x0, tilePixels = (x1 - x0) * (y1 - y0);
+            memset(spectra, 0, tilePixels * stride * sizeof(float));
+            if (features) memset(albedoSpectra, 0, tilePixels * stride * sizeof(float));
+
+            for (int p = 0; p < tilePixels; ++p)
+            {
+                /* Get this pixel's position. */
+                int x = x0 + p % tileWidth;
+                int y = y0 + p / tileWidth;
 
-            /* Multiply the u-coordinate by the aspect ratio. */
-            u *= (float)renderParams.width / (float)renderParams.height;
+                /* Get the pixel's spectral radiance array, and its integrated color for importance sampling. */
+                float* radiance = spectra + p * stride;
+                Vector color = ZERO;
 
-            /* Get a camera ray. */
-            Ray ray = camera->Trace(u, v);
+                /* And its features, summed over the samples (the albedo as a spectrum, on the grid). */
+                float* albedo = features ? albedoSpectra + p * stride : nullptr;
+                Vector normal = ZERO;
+                float depth = 0.0f;
+                uint32_t hits = 0;
+                const Primitive* first = nullptr;
 
-            /* Go over each wavelength. */
-            for (int w = 0; w < WAVELENGTHS; ++w)
+                /* Iterate for the number of desired samples... */
+                for (int s = firstSample; s < firstSample + sampleCount; ++s)
+                {
+                    /* Normalize the pixel's coordinates with jitter. */
+                    float jitterX, jitterY;
+                    sampler->StartSample(y * renderParams.width + x, s);
+                    sampler->Next2D(&jitterX, &jitterY);
+                    float u = 2.0f * ((float)x + jitterX - 0.5f) / renderParams.width - 1.0f;
+                    float v = 2.0f * ((float)y + jitterY - 0.5f) / renderParams.height - 1.0f;
+
+                    /* Multiply the u-coordinate by the aspect ratio. */
+                    u *= (float)renderParams.width / (float)renderParams.height;
+
+                    /* Get a camera ray. */
+                    Ray ray = camera->Trace(u, v);
+
+                    /* The features of the first surface hit are the same at every wavelength. The path tracer notes
+                     * them as it traces the camera ray, the bidirectional one needs it traced once more. */
+                    SurfaceFeatures surface;
+                    SurfaceFeatures* found = (features && !bidirectional) ? &surface : nullptr;
+                    Intersection hit;
+                    if (features && bidirectional && bvh->getIntersection(ray, &hit, false))
+                        NoteFeatures(hit, hit.primitive->Normal(ray.o + ray.d * hit.t), &surface);
+
+                    /* Go over each wavelength. */
+                    if (settings.spectralSampling == SPECTRAL_GRID) for (int w = 0; w < Grid::wavelengths; ++w)
+                    {
+                        /* Get a radiance sample for this wavelength. */
+                        sampler->StartPath(w, Grid::wavelengths);
+                        if (bidirectional) radiance[w] += BidirectionalRadiance(ray, Grid::Wavelength(w), sampler, &paths,
+                            splats, Vector(matchingCurve[w].x, matchingCurve[w].y, matchingCurve[w].z, 1.0f));
+                        else radiance[w] += Radiance(ray, Grid::Wavelength(w), sampler, settings, nullptr, found);
+                    }
+                    else for (int w = 0; w < Grid::wavelengths; ++w)
+                    {
+                        /* Importance-sample a wavelength within this stratum of the distribution. */
+                        sampler->StartPath(w, Grid::wavelengths);
+                        float pdf, wavelength = wavelengthSampler.Sample((w + sampler->Next1D()) / Grid::wavelengths, &pdf);
+
+                        /* Weight the radiance sample so that it estimates the average over the spectrum, and integrate
+                         * the color-matching curve at that wavelength (this is the same scale as the grid). */
+                        Vector matching = ColorMatching(wavelength);
+                        float sample = (bidirectional ? BidirectionalRadiance(ray, wavelength, sampler, &paths, splats,
+                            Vector(matching.x, matching.y, matching.z, 1.0f) / (pdf * (WAVELENGTH_MAX - WAVELENGTH_MIN)))
+                            : Radiance(ray, wavelength, sampler, settings, nullptr, found))
+                            / (pdf * (WAVELENGTH_MAX - WAVELENGTH_MIN));
+                        color += Vector(matching.x, matching.y, matching.z, 1.0f) * sample;
+                    }
+
+                    /* Lights have no material, they count as white so that the denoiser filters their emission as
+                     * it is. The albedo is always found on the grid, whichever wavelengths were traced. */
+                    if (features && surface.primitive)
+                    {
+                        normal += surface.normal;
+                        depth += surface.depth;
+                        if (hits++ == 0) first = surface.primitive;
+                        Material* material = surface.primitive->light ? nullptr : surface.primitive->material;
+                        for (int w = 0; w < Grid::wavelengths; ++w)
+                            albedo[w] += material ? material->Albedo(Grid::Wavelength(w)) : 1.0f;
+                    }
+                }
+
+                /* Importance-sampled wavelengths were integrated on the fly. */
+                if (settings.spectralSampling == SPECTRAL_IMPORTANCE) tileColors[p] = color;
+                if (features)
+                {
+                    size_t index = y * renderParams.width + x;
+                    features->normals[index] += normal;
+                    features->depths[index] += depth;
+                    features->hits[index] += hits;
+                    if (!features->primitives[index]) features->primitives[index] = first;
+                }
+            }
+
+            /* Integrate the tile's spectra, if needed, and add the colors to the image. */
+            int64_t conversionTime = TimelineEnabled() ? TimelineClock() : -1;
+            if (settings.spectralSampling == SPECTRAL_GRID) pipeline.Integrate(spectra, tilePixels, tileColors);
+            for (int p = 0; p < tilePixels; ++p)
+                colors[(y0 + p / tileWidth) * renderParams.width + x0 + p % tileWidth] += tileColors[p];
+            if (features) pipeline.Integrate(albedoSpectra, tilePixels, tileAlbedo);
+            if (features) for (int p = 0; p < tilePixels; ++p)
+                features->albedo[(y0 + p / tileWidth) * renderParams.width + x0 + p % tileWidth] += tileAlbedo[p];
+            if (conversionTime >= 0) RecordTimelineEvent("Spectra to XYZ", conversionTime, TimelineClock(), tile);
+
+            /* We display progress here, so we really only want one thread at a time. */
+            #pragma omp critical
             {
-                /* Get a radiance sample for this wavelength. */
-                float wavelength = 380.0f + RESOLUTION * w;
-                radiance[w] += Radiance(ray, wavelength, prng);
+                /* This is a shared variable indicating how many pixels
+                 * of the render have been completed so far. */
+                progress += tilePixels;
+
+                /* Update every second, if at least some progress has been done. */
+                if (showProgress && (progress > 0) && ((float)difftime(time(nullptr), lastTime) >= 1.0f))
+                {
+                    /* Find the current progress, as a fraction. */
+                    float completion = progress / (float)total;
+
+                    /* Average the render speed with exponential smoothing (alpha = 0.8 works well). */
+                    float speed = (float)(progress - lastProgress) / difftime(time(nullptr), lastTime);
+                    if (lastProgress > 0) speed = 0.8f * lastSpeed + 0.2f * speed;
+
+                    /* Compute the estimated completion time. */
+                    int remaining = (int)((total - progress) / speed);
+
+                    /* Display the current progress. */
+                    printf("\r[+] Raytracing... %04.1f%% [ETC %.3dh%.2dm%.2ds]", completion * 100.0f,
+                           remaining / 3600, (remaining % 3600) / 60, remaining % 60);
+
+                    /* Reset the last time and flush the console. */
+                    lastTime = time(nullptr);
+                    lastProgress = progress;
+                    lastSpeed = speed;
+                    cout << flush;
+                }
             }
         }
 
-        /* Convert the spectral radiance distribution to an RGB color. */
-        pixels[t] = SpectrumToRGB(radiance, colorSystem) / (renderParams.samples * WAVELENGTHS);
+        /* Free the thread's tile buffers and sampler. */
+        _mm_free(spectra);
+        delete[] tileColors;
+        if (albedoSpectra) _mm_free(albedoSpectra);
+        delete[] tileAlbedo;
+        delete sampler;
 
-        /* We display progress here, so we really only want one thread at a time. */
+        /* Gather the thread's statistics, if any. */
+        RenderStatistics counters = CollectThreadStatistics();
         #pragma omp critical
+        report.counters += counters;
+    }
+
+    /* Add the light tracing contributions, which are sums over the samples like the colors. If only a window was
+     * rendered, its pixels traced fewer light paths than the whole render would have, so the contributions landing
+     * in the window are scaled up to match, and the others dropped. */
+    if (bidirectional)
+    {
+        float scale = (total < pixelCount) ? (float)pixelCount / total : 1.0f;
+        for (size_t t = 0; t < pixelCount; ++t)
         {
-            /* This is a shared variable indicating how many pixels
-             * of the render have been completed so far. */
-            ++progress;
+            if (!InWindow(t % renderParams.width, t / renderParams.width)) continue;
+            colors[t] += Vector(splats[t * 4 + 0], splats[t * 4 + 1], splats[t * 4 + 2], splats[t * 4 + 3]) * scale;
+        }
 
-            /* Update every second, if at least some progress has been done. */
-            if ((progress > 0) && ((float)difftime(time(nullptr), lastTime) >= 1.0f))
-            {
-                /* Find the current progress, as a fraction. */
-                float completion = (progress - 1) / (float)pixelCount;
+        delete[] splats;
+    }
+}
 
-                /* Average the render speed with exponential smoothing (alpha = 0.8 works well). */
-                float speed = (float)(progress - lastProgress) / difftime(time(nullptr), lastTime);
-                if (lastProgress > 0) speed = 0.8f * lastSpeed + 0.2f * speed;
+void Renderer::TraceTiles(Vector* colors, const vector<int32_t>& tiles, int32_t firstSample, int32_t sampleCount,
+                          const RenderSettings& settings, bool showProgress)
+{
+    /* Raytrace the tiles using the spectral grid for the requested resolution. */
+    switch (settings.resolution)
+    {
+        case RESOLUTION_FINAL: RenderTiles<SpectralGrid<RESOLUTION_FINAL> >(colors, tiles, firstSample,
+                                                                            sampleCount, settings, showProgress); break;
+        case RESOLUTION_PREVIEW: RenderTiles<SpectralGrid<RESOLUTION_PREVIEW> >(colors, tiles, firstSample,
+                                                                            sampleCount, settings, showProgress); break;
+        case RESOLUTION_DRAFT: RenderTiles<SpectralGrid<RESOLUTION_DRAFT> >(colors, tiles, firstSample,
+                                                                            sampleCount, settings, showProgress); break;
+    }
+}
 
-                /* Compute the estimated completion time. */
-                int remaining = (int)((pixelCount - progress) / speed);
+int32_t Renderer::TraceBudget(Vector* colors, const vector<int32_t>& tiles, double deadline, int32_t limit,
+                              const RenderSettings& settings)
+{
+    /* Start with a single sample per pixel, to measure how long a sample takes. */
+    double startTime = omp_get_wtime();
+    int32_t samples = 0, count = 1;
+    while (count > 0)
+    {
+        TraceTiles(colors, tiles, settings.firstSample + samples, count, settings, false);
+        samples += count;
 
-                /* Display the current progress. */
-                printf("\r[+] Raytracing... %04.1f%% [ETC %.3dh%.2dm%.2ds]", completion * 100.0f,
-                       remaining / 3600, (remaining % 3600) / 60, remaining % 60);
+        /* Predict how many more samples fit in the time left, at the throughput measured so far. */
+        double now = omp_get_wtime(), sampleTime = (now - startTime) / samples;
+        double fit = max(deadline - now, 0.0) / sampleTime;
+        if ((samples == 1) && (now > deadline)) cout << endl << "[!] A single sample per pixel took longer than the "
+                                                      << "budget, which is overrun." << endl;
+        else if (samples == 1) printf("\n    | About %.0f samples per pixel fit in the budget, at %.1f per second.\n",
+                                      floor(1.0 + fit), 1.0 / sampleTime);
+
+        /* The passes at most double the samples, so the throughput is measured again before the last passes, which
+         * only take the samples predicted to fit (the render is averaged over whole passes, so every pixel gets the
+         * same samples). */
+        count = (int32_t)min(fit, (double)samples);
+        if (limit > 0) count = min(count, limit - samples);
+
+        int remaining = (int)max(deadline - now, 0.0);
+        printf("\r[+] Raytracing... %d spp [ETC %.3dh%.2dm%.2ds]", samples,
+               remaining / 3600, (remaining % 3600) / 60, remaining % 60);
+        cout << flush;
+    }
+
+    return samples;
+}
+
+void Renderer::ColorsToRGB(const Vector* colors, Vector* pixels, int32_t samples, int32_t resolution)
+{
+    /* Only the XYZ to RGB matrix is used here, which doesn't depend on the spectral resolution. */
+    typedef SpectralGrid<RESOLUTION_FINAL> Grid;
+    const ColorPipeline pipeline(colorSystem, Grid::MatchingCurve(), Grid::wavelengths);
+    int32_t wavelengths = 1 + (WAVELENGTH_MAX - WAVELENGTH_MIN) / resolution;
+
+    /* Average the colors over their samples and wavelengths as they are converted. */
+    pipeline.ToRGB(colors, pixelCount, pixels, 1.0f / ((float)samples * wavelengths));
+}
 
-                /* Reset the last time and flush the console. */
-                lastTime = time(nullptr);
-                lastProgress = progress;
-                lastSpeed = speed;
-                cout << flush;
+template <typename Grid>
+void Renderer::RenderHeatmap(float* costs, int32_t samples, const RenderSettings& settings)
+{
+    TimelineScope scope("Heatmap");
+
+    /* Go over each row in the image, in parallel. */
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int y = 0; y < renderParams.height; ++y)
+    {
+        TimelineScope rowScope("Heatmap row", y);
+
+        /* Each row has its own sampler, which draws the samples as for the image itself. */
+        Sampler* sampler = GetSampler(settings.sampler, settings.seed);
+
+        for (int x = 0; x < renderParams.width; ++x)
+        {
+            /* Measure the cost of all of this pixel's samples. */
+            TraversalCost cost;
+            double startTime = omp_get_wtime();
+            for (int s = 0; s < samples; ++s)
+            {
+                /* Get the camera ray, exactly as when rendering the image. */
+                float jitterX, jitterY;
+                sampler->StartSample(y * renderParams.width + x, s);
+                sampler->Next2D(&jitterX, &jitterY);
+                float u = 2.0f * ((float)x + jitterX - 0.5f) / renderParams.width - 1.0f;
+                float v = 2.0f * ((float)y + jitterY - 0.5f) / renderParams.height - 1.0f;
+                u *= (float)renderParams.width / (float)renderParams.height;
+                Ray ray = camera->Trace(u, v);
+
+                /* Either intersect the camera ray with the scene, or trace every light path. */
+                if (settings.heatmapRays == HEATMAP_CAMERA)
+                {
+                    Intersection intersection;
+                    bvh->getIntersection(ray, &intersection, false, &cost);
+                }
+                else for (int w = 0; w < Grid::wavelengths; ++w)
+                {
+                    sampler->StartPath(w, Grid::wavelengths);
+                    Radiance(ray, Grid::Wavelength(w), sampler, settings, &cost);
+                }
+            }
+
+            /* Save the pixel's cost, averaged over its samples. */
+            double elapsed = omp_get_wtime() - startTime;
+            float* pixelCost = costs + y * renderParams.width + x;
+            switch (settings.heatmap)
+            {
+                case HEATMAP_TIME: *pixelCost = (float)(elapsed * 1e6 / samples); break;
+                case HEATMAP_NODES: *pixelCost = (float)cost.nodes / samples; break;
+                default: *pixelCost = (float)cost.primitives / samples; break;
             }
         }
+
+        delete sampler;
     }
+}
 
-    /* Tonemap, and then gamma-correct the render. */
+bool Renderer::SaveFrame(const Vector* colors, Vector* pixels, string render, int32_t samples,
+                         const RenderSettings& settings, time_t elapsedTime)
+{
+    /* Convert the colors to RGB, and denoise them if the render's features were found (the accumulation buffer keeps
+     * the sums of the samples as they are, to be merged with others, and a composited render's pixels are not all
+     * from this render). If the render is composited into an accumulation buffer, its pixels are added to the
+     * buffer's (or replace them), and the buffer is converted. */
+    int32_t wavelengths = 1 + (WAVELENGTH_MAX - WAVELENGTH_MIN) / settings.resolution;
+    if (composite)
+    {
+        for (size_t t = 0; t < pixelCount; ++t)
+        {
+            if (!InWindow(t % renderParams.width, t / renderParams.width)) continue;
+            if (settings.replace) composite->sums[t] = ZERO, composite->counts[t] = 0;
+            composite->sums[t] += colors[t] / (float)wavelengths;
+            composite->counts[t] += samples;
+        }
+
+        ResolveAccumulation(*composite, pixels);
+    }
+    else ColorsToRGB(colors, pixels, samples, settings.resolution);
+    bool success = true;
+    if (features && (settings.denoise > 0) && !settings.accumulate && !composite)
+    {
+        double denoiseTime = omp_get_wtime();
+        DenoiseRender(pixels, samples, settings);
+        report.tonemapSeconds += omp_get_wtime() - denoiseTime;
+    }
+
+    /* Save the linear render before it is tonemapped, if requested. */
+    double writeTime = omp_get_wtime();
+    int64_t linearTime = TimelineEnabled() ? TimelineClock() : -1;
+    if (!settings.linear.empty() && !SavePFM(settings.linear, pixels, renderParams.width, renderParams.height))
+    {
+        cout << endl << "[!] Failed to save the linear render in <" << settings.linear << ">." << endl;
+        success = false;
+    }
+    report.writeSeconds += omp_get_wtime() - writeTime;
+    if ((linearTime >= 0) && !settings.linear.empty())
+        RecordTimelineEvent("SavePFM", linearTime, TimelineClock(), -1);
+
+    /* Save the AOVs along with the render, if requested. */
+    writeTime = omp_get_wtime();
+    if (features && !settings.aovs.empty() && !SaveAOVs(settings.aovs, samples, settings.resolution))
+    {
+        cout << endl << "[!] Failed to save the AOVs in <" << settings.aovs << ".*.pfm>." << endl;
+        success = false;
+    }
+    report.writeSeconds += omp_get_wtime() - writeTime;
+
+    /* Save the sums of the samples, if only they are to be saved. */
+    writeTime = omp_get_wtime();
+    if (settings.accumulate)
+    {
+        /* Only the window's pixels have samples, if only it was rendered. */
+        AccumulationBuffer buffer;
+        buffer.width = renderParams.width;
+        buffer.height = renderParams.height;
+        buffer.colorSystem = colorSystem;
+        buffer.sums.resize(pixelCount);
+        buffer.counts.resize(pixelCount);
+        for (size_t t = 0; t < pixelCount; ++t)
+        {
+            buffer.sums[t] = colors[t] / (float)wavelengths;
+            buffer.counts[t] = InWindow(t % renderParams.width, t / renderParams.width) ? samples : 0;
+        }
+
+        if (!SaveAccumulation(render, composite ? *composite : buffer))
+        {
+            cout << endl << "[!] Failed to save the accumulation buffer in <" << render << ">." << endl;
+            success = false;
+        }
+
+        report.writeSeconds += omp_get_wtime() - writeTime;
+        return success;
+    }
+
+    /* Otherwise, tonemap, and then gamma-correct the render. */
+    double tonemapTime = omp_get_wtime();
     TonemapRender(pixels);
     GammaCorrectRender(pixels);
+    report.tonemapSeconds += omp_get_wtime() - tonemapTime;
+
+    /* Save the pixel buffer to a PPM file. */
+    writeTime = omp_get_wtime();
+    if (!SaveToPPM(pixels, render, elapsedTime))
+    {
+        cout << endl << "[!] Failed to save the render in <" << render << ">." << endl;
+        success = false;
+    }
+    report.writeSeconds += omp_get_wtime() - writeTime;
+    return success;
+}
+
+void Renderer::ReportStatistics(const RenderSettings& settings)
+{
+    /* Report the statistics, if they were collected. */
+    if (StatisticsEnabled())
+    {
+        cout << endl;
+        PrintStatistics(report);
+        if (!settings.statistics.empty())
+        {
+            if (SaveStatistics(settings.statistics, report))
+                cout << "    | Report saved in <" << settings.statistics << ">." << endl;
+            else cout << "[!] Failed to save the statistics report in <" << settings.statistics << ">." << endl;
+        }
+    }
+    else if (!settings.statistics.empty())
+        cout << endl << "[!] No statistics report, Lambda was not compiled with STATISTICS defined." << endl;
+}
+
+bool Renderer::Render(string render, size_t threads, RenderSettings settings)
+{
+    /* Make sure the spectral resolution is one the renderer was compiled for. */
+    if ((settings.resolution != RESOLUTION_FINAL) && (settings.resolution != RESOLUTION_PREVIEW)
+     && (settings.resolution != RESOLUTION_DRAFT))
+    {
+        cout << "[!] Unsupported spectral resolution (" << settings.resolution << "nm), expected "
+             << RESOLUTION_FINAL << ", " << RESOLUTION_PREVIEW << " or " << RESOLUTION_DRAFT << "nm." << endl;
+        return false;
+    }
+
+    /* Render a sequence of frames instead, if requested, from the scene's camera as overridden. */
+    if ((settings.orbit > 0) || !settings.keyframes.empty())
+    {
+        Camera* start = camera->Override(settings.camera);
+        vector<CameraOverride> poses = OrbitPoses(start->Pose(), settings.orbit);
+        delete start;
+
+        if (!settings.keyframes.empty() && !LoadKeyframes(settings.keyframes, &poses))
+            cout << "[!] Failed to load the camera keyframes in <" << settings.keyframes << ">." << endl;
+        else return RenderSequence(render, threads, poses, settings);
+        return false;
+    }
+
+    /* The number of samples per pixel may be overridden. */
+    int32_t samples = (settings.samples > 0) ? settings.samples : renderParams.samples;
+
+    /* Render from the overridden camera, if any, putting the scene's camera back once done. */
+    Camera* sceneCamera = camera;
+    if (!settings.camera.Empty()) camera = sceneCamera->Override(settings.camera);
+    auto restoreCamera = [&]() { if (camera != sceneCamera) delete camera; camera = sceneCamera; };
+
+    /* Only some renders can be distributed: workers render whole tiles over a set number of samples, measure
+     * nothing, don't get the moved vertices, and have no light subpaths, photon map or guiding from other tiles. */
+    const char* undistributable = nullptr;
+    if (settings.integrator == INTEGRATOR_BIDIRECTIONAL) undistributable = "Bidirectional path tracing";
+    else if (settings.photons > 0) undistributable = "Photon mapping";
+    else if (settings.guiding > 0) undistributable = "Path guiding";
+    else if (settings.budget > 0.0f) undistributable = "Time budgets";
+    else if (!settings.crop.Empty()) undistributable = "Crop windows";
+    else if (!settings.vertices.empty()) undistributable = "Moved vertices";
+    else if (settings.heatmap != HEATMAP_NONE) undistributable = "Heatmaps";
+
+    if ((settings.coordinatorPort > 0) && (undistributable != nullptr))
+    {
+        cout << "[!] " << undistributable << " can't be distributed." << endl;
+        restoreCamera();
+        return false;
+    }
+
+    /* Only render a window of the render, if requested, which must fit in it. */
+    const CropWindow& crop = settings.crop;
+    if (!crop.Empty() && ((crop.x + crop.width > renderParams.width) || (crop.y + crop.height > renderParams.height)))
+    {
+        cout << "[!] The crop window doesn't fit in the " << renderParams.width << "x" << renderParams.height
+             << " render." << endl;
+        restoreCamera();
+        return false;
+    }
+
+    /* Move the scene's vertices, if requested. */
+    if (!settings.vertices.empty())
+    {
+        if (!LoadVertices(settings.vertices, true))
+        {
+            restoreCamera();
+            return false;
+        }
+
+        cout << endl;
+    }
+
+    /* First, we need to allocate a large enough pixel buffer. */
+    Vector* pixels = new Vector[pixelCount];
+
+    /* Set the number of OpenMP threads. If zero was passed, default to the number
+     * of execution units available on the system for maximum performance. */
+    omp_set_num_threads((threads == 0) ? omp_get_num_procs() : threads);
+    if (threads == 0) {
+        threads = omp_get_num_procs();
+    }
+
+    cout << "[+] Initializing, " << threads << " threads scheduled..." << flush;
+
+    /* Describe the render, for the statistics report. */
+    report.width = renderParams.width;
+    report.height = renderParams.height;
+    report.samples = samples;
+    report.resolution = settings.resolution;
+    report.wavelengths = 1 + (WAVELENGTH_MAX - WAVELENGTH_MIN) / settings.resolution;
+    report.threads = threads;
+    report.counters = RenderStatistics();
+    report.tonemapSeconds = report.writeSeconds = 0.0;
+
+    /* We're all set, record the starting time. */
+    time_t startTime = time(nullptr);
+    double traceTime = omp_get_wtime();
+    cout << " ready!" << endl;
+
+    /* In heatmap mode, measure the cost of every pixel instead, and save it rather than the image. */
+    if (settings.heatmap != HEATMAP_NONE)
+    {
+        const char* metrics[] = {"", "microseconds", "BVH nodes", "primitive tests"};
+        cout << "[+] Measuring the " << metrics[settings.heatmap] << " per sample of the "
+             << ((settings.heatmapRays == HEATMAP_CAMERA) ? "camera rays" : "light paths") << "..." << flush;
+
+        float* costs = new float[pixelCount];
+        switch (settings.resolution)
+        {
+            case RESOLUTION_FINAL: RenderHeatmap<SpectralGrid<RESOLUTION_FINAL> >(costs, samples, settings); break;
+            case RESOLUTION_PREVIEW: RenderHeatmap<SpectralGrid<RESOLUTION_PREVIEW> >(costs, samples, settings); break;
+            case RESOLUTION_DRAFT: RenderHeatmap<SpectralGrid<RESOLUTION_DRAFT> >(costs, samples, settings); break;
+        }
+
+        report.seconds = omp_get_wtime() - traceTime;
+        cout << " done!" << endl << endl;
+
+        /* Summarize the costs. */
+        double total = 0.0;
+        float highest = 0.0f;
+        for (size_t t = 0; t < pixelCount; ++t)
+        {
+            total += costs[t];
+            highest = max(highest, costs[t]);
+        }
+
+        /* Save the raw costs, and the false-color heatmap in place of the render. */
+        double writeTime = omp_get_wtime();
+        string raw = settings.linear.empty() ? render + ".pfm" : settings.linear;
+        float low = 0.0f, high = 0.0f;
+        FalseColorPixels(costs, pixelCount, pixels, &low, &high);
+        bool saved = SaveToPPM(pixels, render, difftime(time(nullptr), startTime));
+        if (!saved) cout << "[!] Failed to save the heatmap in <" << render << ">." << endl;
+        if (!SavePFM(raw, costs, renderParams.width, renderParams.height))
+        {
+            cout << "[!] Failed to save the raw costs in <" << raw << ">." << endl;
+            saved = false;
+        }
+        report.writeSeconds = omp_get_wtime() - writeTime;
+
+        if (saved) cout << "[+] Heatmap saved in <" << render << ">, raw costs in <" << raw << ">." << endl;
+        printf("    | %.2f %s per sample on average, %.2f at most (colored from %.2f to %.2f).\n",
+               total / pixelCount, metrics[settings.heatmap], highest, low, high);
+
+        delete[] costs;
+        delete[] pixels;
+        restoreCamera();
+        return saved;
+    }
+
+    /* Load the accumulation buffer to composite the render into, if any, which must be of the same render. */
+    if (!settings.composite.empty())
+    {
+        composite = new AccumulationBuffer();
+        bool matches = false;
+        if (!LoadAccumulation(settings.composite, composite))
+            cout << "[!] Failed to load the accumulation buffer in <" << settings.composite << ">." << endl;
+        else if ((composite->width != renderParams.width) || (composite->height != renderParams.height)
+              || memcmp(&composite->colorSystem, &colorSystem, sizeof(ColorSystem)))
+            cout << "[!] The accumulation buffer in <" << settings.composite << "> is not of this render." << endl;
+        else matches = true;
+
+        if (!matches)
+        {
+            delete composite;
+            composite = nullptr;
+            delete[] pixels;
+            restoreCamera();
+            return false;
+        }
+    }
+
+    /* Shoot the photons, if any, which is part of the render's time. */
+    if ((settings.integrator == INTEGRATOR_BIDIRECTIONAL) && ((settings.roulette != ROULETTE_BOUNCE)
+     || (settings.minDepth > 0) || (settings.maxDepth > 0) || (settings.splits > 1)))
+        cout << "[!] The russian roulette, depth and splitting settings only apply to the path tracer." << endl;
+    if ((settings.photons > 0) && (settings.integrator == INTEGRATOR_BIDIRECTIONAL))
+        cout << "[!] The photon map is only used by the path tracer, no photons are shot." << endl;
+    else if (settings.photons > 0) BuildPhotonMap(settings, true);
+    bool guided = (settings.guiding > 0) && (settings.integrator == INTEGRATOR_PATH) && (settings.budget <= 0.0f);
+    if ((settings.guiding > 0) && (settings.integrator != INTEGRATOR_PATH))
+        cout << "[!] Path guiding is only used by the path tracer." << endl;
+    else if ((settings.guiding > 0) && !guided)
+        cout << "[!] Path guiding trains over a set number of samples, it is not used within a time budget." << endl;
+
+    /* Find the features of the pixels as they are raytraced, if the render is to be denoised or its AOVs saved
+     * (workers don't find them). */
+    if ((settings.denoise > 0) && settings.accumulate)
+        cout << "[!] Accumulation buffers are not denoised, they keep the sums of the samples." << endl;
+    if ((settings.denoise > 0) && composite)
+        cout << "[!] Composited renders are not denoised, their pixels are not all from this render." << endl;
+    bool denoised = (settings.denoise > 0) && !settings.accumulate && !composite;
+    if ((denoised || !settings.aovs.empty()) && (settings.coordinatorPort > 0))
+        cout << "[!] Distributed renders can't be denoised or have AOVs, workers don't find their pixels' features."
+             << endl;
+    else if (denoised || !settings.aovs.empty()) features = new FeatureBuffers(pixelCount);
+
+    /* Render only the window, if any. Samples added to an accumulation buffer follow those already in the window,
+     * unless their range was given. */
+    window = crop;
+    if (composite && !settings.replace && (settings.firstSample == 0))
+        for (size_t t = 0; t < pixelCount; ++t) if (InWindow(t % renderParams.width, t / renderParams.width))
+            settings.firstSample = max(settings.firstSample, (int32_t)composite->counts[t]);
+
+    cout << "[+] Raytracing at " << settings.resolution << "nm spectral resolution";
+    if (settings.spectralSampling == SPECTRAL_IMPORTANCE) cout << " (importance-sampled)";
+    if (settings.integrator == INTEGRATOR_BIDIRECTIONAL) cout << ", bidirectionally";
+    if (photonMap) cout << ", with caustic photons";
+    if (guided) cout << ", with path guiding";
+    if (!window.Empty()) cout << ", in a " << window.width << "x" << window.height << " crop window";
+    if (settings.budget > 0.0f) cout << ", within " << settings.budget << " seconds";
+    if ((settings.firstSample > 0) && (settings.budget > 0.0f)) cout << ", from sample " << settings.firstSample;
+    else if (settings.firstSample > 0) cout << ", samples " << settings.firstSample << " to "
+                                            << settings.firstSample + samples - 1;
+    cout << "..." << flush;
+
+    /* Raytrace every tile of the render, here or on workers, into integrated colors. */
+    Vector* colors = new Vector[pixelCount];
+    fill(colors, colors + pixelCount, ZERO);
+    int32_t passes = 0;
+    if (settings.coordinatorPort > 0)
+    {
+        if (!Coordinate(colors, samples, settings))
+        {
+            delete composite;
+            composite = nullptr;
+            delete[] colors;
+            delete[] pixels;
+            restoreCamera();
+            return false;
+        }
+    }
+    else
+    {
+        vector<int32_t> tiles = WindowTiles();
+        if (settings.budget > 0.0f) samples = TraceBudget(colors, tiles, traceTime + settings.budget,
+                                                          settings.samples, settings);
+        else if (guided) passes = TraceGuided(colors, tiles, samples, settings);
+        else TraceTiles(colors, tiles, settings.firstSample, samples, settings, true);
+    }
+
+    /* Measure the time spent raytracing precisely, for the statistics. */
+    report.seconds = omp_get_wtime() - traceTime;
+    report.samples = samples;
 
     /* We're finished raytracing, display time taken. */
     int elapsedTime = (int)difftime(time(nullptr), startTime);
     printf("\r[+] Raytracing complete, time taken: %.2dh%.2dm%.2ds.\n",
            elapsedTime / 3600, (elapsedTime % 3600) / 60, elapsedTime % 60);
+    if (guidingTree)
+        printf("    | Guided by %u regions (%u directional nodes), learned over %d passes of %d samples in all.\n",
+               (unsigned)guidingTree->Regions(), (unsigned)guidingTree->DirectionalNodes(), passes,
+               (1 << passes) - 1);
+    if (settings.budget > 0.0f) printf("    | %d samples per pixel rendered within the budget of %g seconds.\n",
+                                       samples, settings.budget);
+
+    /* Save the render, or the sums of its samples to an accumulation buffer to merge later. */
+    if (settings.accumulate) cout << endl << "[+] Saving accumulation buffer in <" << render << ">." << endl;
+    else cout << endl << "[+] Saving final render in <" << render << ">." << endl;
+    bool saved = SaveFrame(colors, pixels, render, samples, settings, elapsedTime);
+    if (saved && !settings.linear.empty())
+        cout << "    | Linear render saved in <" << settings.linear << ">." << endl;
+    if (features && denoised) cout << "    | Denoised over " << settings.denoise << " iterations, guided by the albedo,"
+                                   << " normals and depth of the pixels." << endl;
+    if (composite) cout << "    | Composited into the accumulation buffer in <" << settings.composite << ">, "
+                        << (settings.replace ? "replacing" : "adding to") << " its samples." << endl;
+    if (features && !settings.aovs.empty())
+        cout << "    | AOVs (depth, normal, albedo, primitive and material IDs) saved in <" << settings.aovs
+             << ".*.pfm>." << endl;
+
+    /* Report the statistics, if they were collected. */
+    ReportStatistics(settings);
 
-    /* Save the pixel buffer to a PPM file. */
-    cout << endl << "[+] Saving final render in <" << render << ">." << endl;
-    SaveToPPM(pixels, render, difftime(time(nullptr), startTime));
     cout << endl << "[+] Render finished!" << endl;
 
     /* We're done, clean up. */
-    for (size_t t = 0; t < threads; ++t) delete threadPRNG->at(t);
-    delete threadPRNG;
+    delete[] colors;
     delete[] pixels;
+    delete photonMap;
+    photonMap = nullptr;
+    delete guidingTree;
+    guidingTree = nullptr;
+    delete features;
+    features = nullptr;
+    delete composite;
+    composite = nullptr;
+    window = CropWindow();
+    restoreCamera();
+    return saved;
 }
 
 Renderer::~Renderer()
 {
-    /* Delete everything we used. */
-    for (size_t t = 0; t < distributions->size(); ++t) delete distributions->at(t);
-    for (size_t t = 0; t < primitives->size(); ++t) delete primitives->at(t);
-    for (size_t t = 0; t < materials->size(); ++t) delete materials->at(t);
-    for (size_t t = 0; t < lights->size(); ++t) delete lights->at(t);
+    /* Delete everything we used (the scene entities are freed along with their arenas). */
+    delete distributionArena;
+    delete primitiveArena;
+    delete materialArena;
+    delete lightArena;
     delete distributions;
     delete primitives;
     delete materials;
     delete lights;
     delete camera;
     delete bvh;
+    delete photonMap;
+    delete guidingTree;
+    delete features;
+    delete composite;
 }
@@ -0,0 +1,256 @@
+/* This renders sequences of frames from different camera poses (turntables, or animations from keyframes) with the
+ * scene loaded and its BVH built only once. The frames are pipelined: while a frame is being raytraced, the previous
+ * one is converted, tonemapped and written on another thread, so the file writes don't hold up the raytracing. */
+
+#include <renderer/renderer.hpp>
+#include <iostream>
+#include <cstdio>
+#include <cctype>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <time.h>
+#include <omp.h>
+
+using namespace std;
+
+/* Finds the frame number in a file name pattern, a % followed by an optional 0 (to pad with zeros), an optional
+ * width and a d, returning false unless there is exactly one and no other % sign. */
+static bool ParsePattern(const string& pattern, size_t* start, size_t* length, int* width, bool* padded)
+{
+    *start = pattern.find('%');
+    if ((*start == string::npos) || (pattern.find('%', *start + 1) != string::npos)) return false;
+
+    size_t t = *start + 1;
+    *padded = (t < pattern.size()) && (pattern[t] == '0');
+    if (*padded) ++t;
+    for (*width = 0; (t < pattern.size()) && isdigit(pattern[t]) && (*width < 100); ++t)
+        *width = *width * 10 + (pattern[t] - '0');
+    if ((t >= pattern.size()) || (pattern[t] != 'd')) return false;
+
+    *length = t + 1 - *start;
+    return true;
+}
+
+/* Returns the file name of a frame, from a pattern with a frame number in it (checked with ParsePattern, the name is
+ * never used as a format string) or by appending the frame number to the name. */
+static string FrameName(string pattern, int frame)
+{
+    char number[128];
+    size_t start, length;
+    int width;
+    bool padded;
+    if (ParsePattern(pattern, &start, &length, &width, &padded))
+    {
+        snprintf(number, sizeof(number), padded ? "%0*d" : "%*d", width, frame);
+        return pattern.substr(0, start) + number + pattern.substr(start + length);
+    }
+
+    size_t extension = pattern.rfind('.');
+    if ((extension == string::npos) || (pattern.find('/', extension) != string::npos)) extension = pattern.size();
+    snprintf(number, sizeof(number), "_%04d", frame);
+    return pattern.substr(0, extension) + number + pattern.substr(extension);
+}
+
+/* Returns whether a file name either has no % sign, or a single frame number (see ParsePattern). */
+static bool ValidPattern(const string& pattern)
+{
+    size_t start, length;
+    int width;
+    bool padded;
+    return (pattern.find('%') == string::npos) || ParsePattern(pattern, &start, &length, &width, &padded);
+}
+
+bool Renderer::RenderSequence(string render, size_t threads, const vector<CameraOverride>& poses,
+                              RenderSettings settings)
+{
+    /* Every frame is raytraced locally, as an image. */
+    if ((settings.heatmap != HEATMAP_NONE) || (settings.coordinatorPort > 0))
+    {
+        cout << "[!] Sequences can't be rendered as heatmaps, or distributed." << endl;
+        return false;
+    }
+
+    if ((settings.resolution != RESOLUTION_FINAL) && (settings.resolution != RESOLUTION_PREVIEW)
+     && (settings.resolution != RESOLUTION_DRAFT))
+    {
+        cout << "[!] Unsupported spectral resolution (" << settings.resolution << "nm)." << endl;
+        return false;
+    }
+
+    if (poses.empty())
+    {
+        cout << "[!] The sequence has no frames." << endl;
+        return false;
+    }
+
+    /* The file names may have a frame number in them, but no other % sign. */
+    string patterns[] = {render, settings.linear, settings.vertices};
+    for (int t = 0; t < 3; ++t) if (!ValidPattern(patterns[t]))
+    {
+        cout << "[!] Invalid frame file name <" << patterns[t] << ">, expected at most one frame number, like %d or "
+             << "%04d." << endl;
+        return false;
+    }
+
+    /* Frames are saved while the next one is raytraced, so they don't keep the features to denoise them with. */
+    if ((settings.denoise > 0) || !settings.aovs.empty()) cout << "[!] Sequences are not denoised, nor have AOVs." << endl;
+
+    /* Each frame is of the whole render, on its own. */
+    if (!settings.crop.Empty() || !settings.composite.empty())
+        cout << "[!] Sequences are not cropped, nor composited into accumulation buffers." << endl;
+    if (settings.budget > 0.0f) cout << "[!] Sequences render a set number of samples, not within a time budget." << endl;
+
+    int32_t samples = (settings.samples > 0) ? settings.samples : renderParams.samples;
+    omp_set_num_threads((threads == 0) ? omp_get_num_procs() : threads);
+    if (threads == 0) threads = omp_get_num_procs();
+
+    cout << "[+] Rendering " << poses.size() << " frame(s), " << threads << " threads scheduled." << endl;
+    cout << "    | " << samples << " spp at " << settings.resolution << "nm spectral resolution." << endl << endl;
+
+    /* Describe the sequence, for the statistics report. */
+    report.width = renderParams.width;
+    report.height = renderParams.height;
+    report.samples = samples;
+    report.resolution = settings.resolution;
+    report.wavelengths = 1 + (WAVELENGTH_MAX - WAVELENGTH_MIN) / settings.resolution;
+    report.threads = threads;
+    report.counters = RenderStatistics();
+    report.seconds = report.tonemapSeconds = report.writeSeconds = 0.0;
+
+    /* Two frames are in flight at once, one being raytraced and the previous one being saved. */
+    vector<int32_t> tiles(TileCount());
+    for (size_t t = 0; t < tiles.size(); ++t) tiles[t] = t;
+    Vector* colors[2] = {new Vector[pixelCount], new Vector[pixelCount]};
+    Vector* pixels[2] = {new Vector[pixelCount], new Vector[pixelCount]};
+    RenderSettings frameSettings[2] = {settings, settings};
+    string names[2];
+    time_t frameTimes[2];
+
+    /* The writer thread saves each frame it is handed, using one thread to leave the others to raytrace the next
+     * frame. It is handed a frame by setting the queued frame, which it resets once the frame is saved. */
+    mutex lock;
+    condition_variable handoff;
+    int queued = -1;
+    bool finished = false, saved = true;
+    thread writer([&]()
+    {
+        omp_set_num_threads(1);
+        unique_lock<mutex> guard(lock);
+        while (true)
+        {
+            handoff.wait(guard, [&]() { return (queued >= 0) || finished; });
+            if (queued < 0) return;
+
+            int buffer = queued % 2;
+            guard.unlock();
+            saved &= SaveFrame(colors[buffer], pixels[buffer], names[buffer], samples, frameSettings[buffer],
+                               frameTimes[buffer]);
+            guard.lock();
+            queued = -1;
+            handoff.notify_all();
+        }
+    });
+
+    /* The vertices are either moved once, or for every frame if their file name is numbered. */
+    bool animated = (settings.vertices.find('%') != string::npos);
+    bool moved = settings.vertices.empty() || animated || LoadVertices(settings.vertices, true);
+    double moveSeconds = report.buildSeconds;
+
+    /* The photons are shot once, or for every frame if the vertices move (they don't depend on the camera). */
+    bool photons = (settings.photons > 0) && (settings.integrator == INTEGRATOR_PATH);
+    if (moved && photons && !animated)
+    {
+        BuildPhotonMap(settings, true);
+        cout << endl;
+    }
+
+    Camera* sceneCamera = camera;
+    time_t startTime = time(nullptr);
+    for (size_t frame = 0; moved && (frame < poses.size()); ++frame)
+    {
+        int buffer = frame % 2;
+        time_t frameTime = time(nullptr);
+
+        /* Move the frame's vertices first, if animated. */
+        if (animated && !(moved = LoadVertices(FrameName(settings.vertices, frame), false)))
+        {
+            cout << endl << "[!] Failed to load the vertices of frame " << frame << " from <"
+                 << FrameName(settings.vertices, frame) << ">." << endl;
+            break;
+        }
+
+        double traceTime = omp_get_wtime();
+        if (photons && animated) BuildPhotonMap(settings, false);
+
+        /* Raytrace the frame from its camera pose. */
+        camera = sceneCamera->Override(poses[frame]);
+        fill(colors[buffer], colors[buffer] + pixelCount, ZERO);
+        TraceTiles(colors[buffer], tiles, settings.firstSample, samples, settings, false);
+        delete camera;
+        camera = sceneCamera;
+        report.seconds += omp_get_wtime() - traceTime;
+
+        /* Wait for the previous frame to be saved, and hand this one to the writer. */
+        {
+            unique_lock<mutex> guard(lock);
+            handoff.wait(guard, [&]() { return queued < 0; });
+            names[buffer] = FrameName(render, frame);
+            frameSettings[buffer].linear = settings.linear.empty() ? "" : FrameName(settings.linear, frame);
+            frameTimes[buffer] = time(nullptr) - frameTime;
+            queued = frame;
+            handoff.notify_all();
+        }
+
+        printf("\r[+] Rendered frame %u of %u (%.2f seconds per frame).", (unsigned)(frame + 1),
+               (unsigned)poses.size(), report.seconds / (frame + 1));
+        cout << flush;
+    }
+
+    /* Wait for the last frame to be saved. */
+    {
+        unique_lock<mutex> guard(lock);
+        handoff.wait(guard, [&]() { return queued < 0; });
+        finished = true;
+        handoff.notify_all();
+    }
+
+    writer.join();
+    delete photonMap;
+    photonMap = nullptr;
+
+    if (!moved)
+    {
+        cout << "[!] The sequence was aborted." << endl;
+        for (int t = 0; t < 2; ++t)
+        {
+            delete[] colors[t];
+            delete[] pixels[t];
+        }
+
+        return false;
+    }
+
+    int elapsedTime = (int)difftime(time(nullptr), startTime);
+    printf("\n[+] Sequence complete, time taken: %.2dh%.2dm%.2ds.\n",
+           elapsedTime / 3600, (elapsedTime % 3600) / 60, elapsedTime % 60);
+    cout << endl << "[+] Frames saved as <" << FrameName(render, 0) << "> to <"
+         << FrameName(render, poses.size() - 1) << ">." << endl;
+    printf("    | %.2f seconds tonemapping and saving, overlapped with raytracing.\n",
+           report.tonemapSeconds + report.writeSeconds);
+    if (animated) printf("    | %.2f seconds moving the vertices and refitting the BVH.\n",
+                         report.buildSeconds - moveSeconds);
+
+    if (!saved) cout << "[!] Some of the frames could not be saved." << endl;
+
+    ReportStatistics(settings);
+    cout << endl << "[+] Render finished!" << endl;
+
+    for (int t = 0; t < 2; ++t)
+    {
+        delete[] colors[t];
+        delete[] pixels[t];
+    }
+
+    return saved;
+}
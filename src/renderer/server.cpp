@@ -0,0 +1,178 @@
+#include <renderer/server.hpp>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <thread>
+#include <chrono>
+#include <omp.h>
+
+using namespace std;
+
+/* Returns the modification time of a file in nanoseconds, or zero if it does not exist (Windows only keeps seconds,
+ * so a file modified twice within a second there looks unmodified). */
+static int64_t ModificationTime(string path)
+{
+    struct stat status;
+    if (stat(path.c_str(), &status) != 0) return 0;
+
+    #if defined(_WIN32)
+    return (int64_t)status.st_mtime * 1000000000;
+    #elif defined(__APPLE__)
+    return (int64_t)status.st_mtimespec.tv_sec * 1000000000 + status.st_mtimespec.tv_nsec;
+    #else
+    return (int64_t)status.st_mtim.tv_sec * 1000000000 + status.st_mtim.tv_nsec;
+    #endif
+}
+
+/* Returns whether a file name ends with some suffix. */
+static bool EndsWith(const string& name, const string& suffix)
+{
+    return (name.size() >= suffix.size()) && (name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0);
+}
+
+RenderServer::RenderServer(size_t threads) : threads(threads), jobs(0) { }
+
+Renderer* RenderServer::GetScene(string scene, bool hugePages)
+{
+    int64_t modified = ModificationTime(scene);
+    if (modified == 0) return nullptr;
+
+    /* Use the loaded scene, unless its file was modified since it was loaded, or it was loaded with a different
+     * huge pages setting. */
+    map<string, LoadedScene>::iterator loaded = scenes.find(scene);
+    if ((loaded != scenes.end()) && (loaded->second.modified == modified) && (loaded->second.hugePages == hugePages))
+    {
+        cout << "[+] Using the loaded scene <" << scene << ">." << endl << endl;
+        loaded->second.lastJob = jobs;
+        return loaded->second.renderer;
+    }
+
+    if (loaded != scenes.end())
+    {
+        if (loaded->second.modified != modified) cout << "[+] The scene <" << scene << "> was modified, reloading it."
+                                                      << endl;
+        else cout << "[+] The scene <" << scene << "> was loaded " << (hugePages ? "without" : "with")
+                  << " huge pages, reloading it." << endl;
+        delete loaded->second.renderer;
+        scenes.erase(loaded);
+    }
+
+    /* Make room for the scene by unloading the least recently used one, if needed. */
+    if (scenes.size() >= SERVER_SCENES)
+    {
+        map<string, LoadedScene>::iterator oldest = scenes.begin();
+        for (map<string, LoadedScene>::iterator t = scenes.begin(); t != scenes.end(); ++t)
+            if (t->second.lastJob < oldest->second.lastJob) oldest = t;
+
+        cout << "[+] Unloading the scene <" << oldest->first << ">." << endl;
+        delete oldest->second.renderer;
+        scenes.erase(oldest);
+    }
+
+    /* Load the scene, and build its BVH, using all the server's threads. */
+    omp_set_num_threads((threads == 0) ? omp_get_num_procs() : threads);
+    LoadedScene loadedScene = {new Renderer(scene, hugePages), modified, hugePages, jobs};
+    scenes[scene] = loadedScene;
+    return loadedScene.renderer;
+}
+
+bool RenderServer::Run(string scene, string render, const RenderSettings& settings)
+{
+    ++jobs;
+
+    /* Start recording the timeline before loading the scene, if requested. */
+    if (!settings.timeline.empty()) StartTimeline();
+
+    Renderer* renderer = GetScene(scene, settings.hugePages);
+    if (!renderer)
+    {
+        cout << "[!] The scene file <" << scene << "> does not exist." << endl;
+        return false;
+    }
+
+    /* Render the scene, unless working for a coordinator. */
+    bool rendered = true;
+    if (!settings.worker.empty()) renderer->Work(settings.worker, threads);
+    else rendered = renderer->Render(render, threads, settings);
+
+    /* Moving the vertices leaves them moved, and the scene file can't tell, so unload the scene to load it afresh
+     * for the next job. */
+    if (!settings.vertices.empty() && settings.worker.empty())
+    {
+        cout << endl << "[+] Unloading the scene <" << scene << ">, its vertices were moved." << endl;
+        delete renderer;
+        scenes.erase(scene);
+    }
+
+    /* Save the timeline. */
+    if (!settings.timeline.empty())
+    {
+        if (SaveTimeline(settings.timeline)) cout << "[+] Timeline saved in <" << settings.timeline << ">." << endl;
+        else cout << "[!] Failed to save the timeline in <" << settings.timeline << ">." << endl;
+    }
+
+    return rendered;
+}
+
+void RenderServer::Serve(string directory)
+{
+    cout << "[+] Serving render jobs from <" << directory << ">..." << endl << endl;
+
+    while (ModificationTime(directory + "/stop") == 0)
+    {
+        /* Find the pending jobs, and take the first one by name. */
+        vector<string> pending;
+        DIR* listing = opendir(directory.c_str());
+        if (!listing)
+        {
+            cout << "[!] Failed to open the job directory <" << directory << ">." << endl;
+            return;
+        }
+
+        while (dirent* entry = readdir(listing))
+            if (EndsWith(entry->d_name, ".job")) pending.push_back(entry->d_name);
+        closedir(listing);
+
+        if (pending.empty())
+        {
+            this_thread::sleep_for(chrono::milliseconds(SERVER_POLL));
+            continue;
+        }
+
+        /* Claim the job, so that it isn't run twice (even by another server on the same directory). */
+        string name = *min_element(pending.begin(), pending.end());
+        string base = directory + "/" + name.substr(0, name.size() - 4);
+        if (rename((base + ".job").c_str(), (base + ".running").c_str()) != 0) continue;
+
+        /* Read the scene, output and options. */
+        ifstream file(base + ".running");
+        vector<string> arguments;
+        string argument;
+        while (file >> argument) arguments.push_back(argument);
+        file.close();
+
+        cout << "[+] Running job <" << name << ">." << endl << endl;
+        double jobTime = omp_get_wtime();
+        RenderSettings settings;
+        bool success = (arguments.size() >= 2);
+        if (!success) cout << "[!] Expected a scene and an output file." << endl;
+        else success = ParseSettings(vector<string>(arguments.begin() + 2, arguments.end()), &settings)
+                    && Run(arguments[0], arguments[1], settings);
+
+        printf("\n[+] Job <%s> %s in %.2f seconds.\n\n", name.c_str(), success ? "done" : "failed",
+               omp_get_wtime() - jobTime);
+        rename((base + ".running").c_str(), (base + (success ? ".done" : ".failed")).c_str());
+    }
+
+    remove((directory + "/stop").c_str());
+    cout << "[+] Stopped serving render jobs." << endl;
+}
+
+RenderServer::~RenderServer()
+{
+    /* Unload every scene. */
+    for (map<string, LoadedScene>::iterator t = scenes.begin(); t != scenes.end(); ++t) delete t->second.renderer;
+}
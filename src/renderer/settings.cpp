@@ -0,0 +1,349 @@
+#include <renderer/renderer.hpp>
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cerrno>
+
+using namespace std;
+
+/* Parses a vector given as x,y,z. */
+static bool ParseVector(const string& text, Vector* vector)
+{
+    float x, y, z;
+    if (sscanf(text.c_str(), "%f,%f,%f", &x, &y, &z) != 3) return false;
+    *vector = Vector(x, y, z);
+    return true;
+}
+
+/* Parses a whole number, which must be within some range. */
+static bool ParseInteger(const string& text, int32_t minimum, int32_t maximum, int32_t* value)
+{
+    char* end;
+    errno = 0;
+    long parsed = strtol(text.c_str(), &end, 10);
+    if (text.empty() || *end || errno || (parsed < minimum) || (parsed > maximum)) return false;
+    *value = (int32_t)parsed;
+    return true;
+}
+
+/* Parses render settings from command line options. */
+bool ParseSettings(const vector<string>& options, RenderSettings* settings)
+{
+    for (size_t t = 0; t < options.size(); ++t)
+    {
+        /* Every option takes a value. */
+        if (t + 1 >= options.size())
+        {
+            cout << "[!] Missing value for option <" << options[t] << ">." << endl;
+            return false;
+        }
+
+        const string& option = options[t];
+        const string& value = options[++t];
+        if (option == "--resolution") settings->resolution = atoi(value.c_str()); else
+        if (option == "--stats") settings->statistics = value; else
+        if (option == "--samples") settings->samples = atoi(value.c_str()); else
+        if (option == "--seed") settings->seed = strtoul(value.c_str(), nullptr, 0); else
+        if (option == "--linear") settings->linear = value; else
+        if (option == "--timeline") settings->timeline = value; else
+        if (option == "--coordinator")
+        {
+            if (!ParseInteger(value, 1, 65535, &settings->coordinatorPort))
+            {
+                cout << "[!] Invalid coordinator port <" << value << ">, expected 1 to 65535." << endl;
+                return false;
+            }
+        }
+        else
+        if (option == "--worker") settings->worker = value; else
+        if (option == "--worker-timeout")
+        {
+            /* How long the coordinator waits for a worker, in seconds (which must fit in milliseconds). */
+            if (!ParseInteger(value, 1, 0x7FFFFFFF / 1000, &settings->workerTimeout))
+            {
+                cout << "[!] Invalid worker timeout <" << value << ">, expected 1 to " << (0x7FFFFFFF / 1000)
+                     << " seconds." << endl;
+                return false;
+            }
+        }
+        else
+        if (option == "--heatmap")
+        {
+            /* The cost to measure, optionally followed by the rays to measure it for. */
+            size_t colon = value.find(':');
+            string metric = value.substr(0, colon);
+            string rays = (colon == string::npos) ? "camera" : value.substr(colon + 1);
+
+            if (metric == "time") settings->heatmap = HEATMAP_TIME; else
+            if (metric == "nodes") settings->heatmap = HEATMAP_NODES; else
+            if (metric == "primitives") settings->heatmap = HEATMAP_PRIMITIVES; else
+            {
+                cout << "[!] Unknown heatmap <" << metric << ">, expected time, nodes or primitives." << endl;
+                return false;
+            }
+
+            if (rays == "camera") settings->heatmapRays = HEATMAP_CAMERA; else
+            if (rays == "paths") settings->heatmapRays = HEATMAP_PATHS; else
+            {
+                cout << "[!] Unknown heatmap rays <" << rays << ">, expected camera or paths." << endl;
+                return false;
+            }
+        }
+        else
+        if (option == "--spectral")
+        {
+            /* Either the fixed grid, or importance-sampled wavelengths. */
+            if (value == "grid") settings->spectralSampling = SPECTRAL_GRID; else
+            if (value == "importance") settings->spectralSampling = SPECTRAL_IMPORTANCE; else
+            {
+                cout << "[!] Unknown spectral sampling <" << value << ">." << endl;
+                return false;
+            }
+        }
+        else
+        if (option == "--sampler")
+        {
+            /* Independent random numbers, or a low-discrepancy sequence. */
+            if (value == "independent") settings->sampler = SAMPLER_INDEPENDENT; else
+            if (value == "sobol") settings->sampler = SAMPLER_SOBOL; else
+            if (value == "halton") settings->sampler = SAMPLER_HALTON; else
+            {
+                cout << "[!] Unknown sampler <" << value << ">, expected independent, sobol or halton." << endl;
+                return false;
+            }
+        }
+        else
+        if (option == "--integrator")
+        {
+            /* Unidirectional or bidirectional path tracing. */
+            if (value == "path") settings->integrator = INTEGRATOR_PATH; else
+            if (value == "bdpt") settings->integrator = INTEGRATOR_BIDIRECTIONAL; else
+            {
+                cout << "[!] Unknown integrator <" << value << ">, expected path or bdpt." << endl;
+                return false;
+            }
+        }
+        else
+        if (option == "--lights")
+        {
+            /* How the bidirectional path tracer picks the lights of direct connections. */
+            if (value == "power") settings->lightSampling = LIGHTS_POWER; else
+            if (value == "bvh") settings->lightSampling = LIGHTS_BVH; else
+            {
+                cout << "[!] Unknown light sampling <" << value << ">, expected power or bvh." << endl;
+                return false;
+            }
+        }
+        else
+        if (option == "--range")
+        {
+            /* The first sample and the end of the range, exclusive. */
+            int first, end;
+            if ((sscanf(value.c_str(), "%d:%d", &first, &end) != 2) || (first < 0) || (end <= first))
+            {
+                cout << "[!] Invalid sample range <" << value << ">, expected first:end." << endl;
+                return false;
+            }
+
+            settings->firstSample = first;
+            settings->samples = end - first;
+        }
+        else
+        if (option == "--format")
+        {
+            /* Either a tonemapped image, or the sums of the samples. */
+            if (value == "ppm") settings->accumulate = false; else
+            if (value == "accumulation") settings->accumulate = true; else
+            {
+                cout << "[!] Unknown output format <" << value << ">, expected ppm or accumulation." << endl;
+                return false;
+            }
+        }
+        else
+        if ((option == "--position") || (option == "--target"))
+        {
+            /* The camera position or target, overriding the scene's. */
+            bool position = (option == "--position");
+            if (!ParseVector(value, position ? &settings->camera.position : &settings->camera.target))
+            {
+                cout << "[!] Invalid camera " << (position ? "position" : "target") << " <" << value
+                     << ">, expected x,y,z." << endl;
+                return false;
+            }
+
+            if (position) settings->camera.hasPosition = true;
+            else settings->camera.hasTarget = true;
+        }
+        else
+        if (option == "--orbit")
+        {
+            /* The number of frames of the turntable, zero for a single render. */
+            if (!ParseInteger(value, 0, 0x7FFFFFFF, &settings->orbit))
+            {
+                cout << "[!] Invalid number of frames <" << value << ">, expected 0 or more." << endl;
+                return false;
+            }
+        }
+        else
+        if (option == "--keyframes") settings->keyframes = value; else
+        if (option == "--vertices") settings->vertices = value; else
+        if (option == "--photons")
+        {
+            if (!ParseInteger(value, 1, 0x7FFFFFFF, &settings->photons))
+            {
+                cout << "[!] Invalid number of photons <" << value << ">, expected at least 1." << endl;
+                return false;
+            }
+        }
+        else
+        if (option == "--photon-memory")
+        {
+            if (!ParseInteger(value, 1, 0x7FFFFFFF, &settings->photonMemory))
+            {
+                cout << "[!] Invalid photon memory <" << value << ">, expected at least 1 MiB." << endl;
+                return false;
+            }
+        }
+        else
+        if (option == "--photon-radius")
+        {
+            /* The gathering radius, zero deriving it from the scene. */
+            settings->photonRadius = atof(value.c_str());
+            if (!(settings->photonRadius >= 0.0f))
+            {
+                cout << "[!] Invalid photon radius <" << value << ">, expected a distance (or 0 for automatic)."
+                     << endl;
+                return false;
+            }
+        }
+        else
+        if (option == "--roulette")
+        {
+            /* Russian roulette by the reflectance of each bounce, or by the throughput of the path. */
+            if (value == "bounce") settings->roulette = ROULETTE_BOUNCE; else
+            if (value == "throughput") settings->roulette = ROULETTE_THROUGHPUT; else
+            {
+                cout << "[!] Unknown russian roulette <" << value << ">, expected bounce or throughput." << endl;
+                return false;
+            }
+        }
+        else
+        if (option == "--roulette-threshold")
+        {
+            settings->rouletteThreshold = atof(value.c_str());
+            if (!(settings->rouletteThreshold > 0.0f))
+            {
+                cout << "[!] Invalid russian roulette threshold <" << value << ">, expected a positive number." << endl;
+                return false;
+            }
+        }
+        else
+        if (option == "--depth")
+        {
+            /* The minimum and maximum depth, the latter being zero for no limit. */
+            int minimum, maximum;
+            if ((sscanf(value.c_str(), "%d:%d", &minimum, &maximum) != 2) || (minimum < 0) || (maximum < 0)
+             || ((maximum > 0) && (maximum < minimum)))
+            {
+                cout << "[!] Invalid path depth <" << value << ">, expected min:max (max being 0 for none)." << endl;
+                return false;
+            }
+
+            settings->minDepth = minimum;
+            settings->maxDepth = maximum;
+        }
+        else
+        if (option == "--split")
+        {
+            if (!ParseInteger(value, 1, 0x7FFFFFFF, &settings->splits))
+            {
+                cout << "[!] Invalid number of branches <" << value << ">, expected at least 1." << endl;
+                return false;
+            }
+        }
+        else
+        if (option == "--guiding")
+        {
+            /* The number of training passes, zero for no path guiding. */
+            if (!ParseInteger(value, 0, 0x7FFFFFFF, &settings->guiding))
+            {
+                cout << "[!] Invalid number of training passes <" << value << ">, expected 0 or more." << endl;
+                return false;
+            }
+        }
+        else
+        if (option == "--denoise")
+        {
+            /* The number of filter iterations, zero for no denoising. */
+            if (!ParseInteger(value, 0, DENOISE_MAX_ITERATIONS, &settings->denoise))
+            {
+                cout << "[!] Invalid number of denoising iterations <" << value << ">, expected 0 to "
+                     << DENOISE_MAX_ITERATIONS << "." << endl;
+                return false;
+            }
+        }
+        else
+        if (option == "--aovs") settings->aovs = value; else
+        if (option == "--composite") settings->composite = value; else
+        if (option == "--budget")
+        {
+            /* The wall-clock time to render within, in seconds. */
+            char* end;
+            settings->budget = strtod(value.c_str(), &end);
+            if (value.empty() || *end || !(settings->budget > 0.0f) || !isfinite(settings->budget))
+            {
+                cout << "[!] Invalid time budget <" << value << ">, expected a positive number of seconds." << endl;
+                return false;
+            }
+        }
+        else
+        if (option == "--crop")
+        {
+            /* The first column and row of the window, and its size. */
+            CropWindow& crop = settings->crop;
+            if ((sscanf(value.c_str(), "%d,%d,%d,%d", &crop.x, &crop.y, &crop.width, &crop.height) != 4)
+             || (crop.x < 0) || (crop.y < 0) || crop.Empty())
+            {
+                cout << "[!] Invalid crop window <" << value << ">, expected x,y,width,height." << endl;
+                return false;
+            }
+        }
+        else
+        if (option == "--composite-mode")
+        {
+            /* Whether the crop window's samples are added to the accumulation buffer's, or replace them. */
+            if (value == "add") settings->replace = false; else
+            if (value == "replace") settings->replace = true; else
+            {
+                cout << "[!] Unknown composite mode <" << value << ">, expected add or replace." << endl;
+                return false;
+            }
+        }
+        else
+        if (option == "--hugepages")
+        {
+            /* Whether to store the scene's primitives in huge pages. */
+            if (value == "on") settings->hugePages = true; else
+            if (value == "off") settings->hugePages = false; else
+            {
+                cout << "[!] Invalid huge pages setting <" << value << ">, expected on or off." << endl;
+                return false;
+            }
+        }
+        else
+        if (option == "--fov")
+        {
+            /* The camera's field of view, in degrees. */
+            settings->camera.fieldOfView = atof(value.c_str()) * PI / 180.0f;
+            settings->camera.hasFieldOfView = true;
+        }
+        else
+        {
+            cout << "[!] Unknown option <" << option << ">." << endl;
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,46 @@
+#include <samplers/halton.hpp>
+#include <util/rtmath.hpp>
+#include <algorithm>
+
+/* The prime bases of the Halton sequence. */
+static const uint32_t primes[HALTON_BASES] =
+{
+      2,   3,   5,   7,  11,  13,  17,  19,  23,  29,  31,  37,  41,  43,  47,  53,
+     59,  61,  67,  71,  73,  79,  83,  89,  97, 101, 103, 107, 109, 113, 127, 131,
+    137, 139, 149, 151, 157, 163, 167, 173, 179, 181, 191, 193, 197, 199, 211, 223,
+    227, 229, 233, 239, 241, 251, 257, 263, 269, 271, 277, 281, 283, 293, 307, 311
+};
+
+/* Returns the scrambled radical inverse of an index in a base. Every digit is shifted by a random amount drawn from
+ * the seed and the digits before it, down to single precision (including the zero digits past the index's). */
+static float ScrambledRadicalInverse(uint32_t index, uint32_t base, uint32_t seed)
+{
+    const double inverseBase = 1.0 / base;
+    double result = 0.0, scale = inverseBase;
+    uint32_t prefix = 0;
+
+    for (uint32_t level = 0; scale > 1.0 / 16777216.0; ++level, scale *= inverseBase)
+    {
+        uint32_t digit = index % base;
+        index /= base;
+
+        /* The node of the digit tree is identified by the digits before this one. */
+        uint32_t shift = SampleSeed(seed, prefix, level) % base;
+        result += ((digit + shift) % base) * scale;
+        prefix = prefix * base + digit + 1;
+    }
+
+    return std::min((float)result, 0.99999994f);
+}
+
+float HaltonSampler::Next1D()
+{
+    uint32_t base = primes[dimension % HALTON_BASES];
+    return ScrambledRadicalInverse(index, base, SampleSeed(seed, pixel, dimension++));
+}
+
+void HaltonSampler::Next2D(float* u1, float* u2)
+{
+    *u1 = Next1D();
+    *u2 = Next1D();
+}
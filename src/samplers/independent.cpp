@@ -0,0 +1,25 @@
+#include <samplers/independent.hpp>
+#include <util/rtmath.hpp>
+
+void IndependentSampler::StartSample(uint32_t pixel, uint32_t sample)
+{
+    /* Reseed the PRNG deterministically at the start of each block of samples. A sample which doesn't follow the
+     * previous one of the same pixel (such as the start of a range of samples within a block) gets a seed of its own,
+     * so that it doesn't repeat the start of the block. */
+    if (sample % SEEDBLOCK == 0) prng.seed(SampleSeed(seed, pixel, sample / SEEDBLOCK));
+    else if ((pixel != this->pixel) || (sample != this->sample + 1))
+        prng.seed(SampleSeed(seed, pixel, 0x80000000u | sample));
+
+    Sampler::StartSample(pixel, sample);
+}
+
+float IndependentSampler::Next1D()
+{
+    return RandomVariable((&prng));
+}
+
+void IndependentSampler::Next2D(float* u1, float* u2)
+{
+    *u1 = RandomVariable((&prng));
+    *u2 = RandomVariable((&prng));
+}
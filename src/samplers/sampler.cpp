@@ -0,0 +1,20 @@
+#include <samplers/sampler.hpp>
+
+/* All sampler types. */
+#include <samplers/independent.hpp>
+#include <samplers/sobol.hpp>
+#include <samplers/halton.hpp>
+
+/* This creates a sampler of some type, for a render seed. */
+Sampler* GetSampler(SamplerType type, uint32_t seed)
+{
+    switch (type)
+    {
+        case SAMPLER_INDEPENDENT: return new IndependentSampler(seed);
+        case SAMPLER_SOBOL: return new SobolSampler(seed);
+        case SAMPLER_HALTON: return new HaltonSampler(seed);
+    }
+
+    /* Unknown type. */
+    return nullptr;
+}
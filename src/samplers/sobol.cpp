@@ -0,0 +1,59 @@
+#include <samplers/sobol.hpp>
+#include <util/rtmath.hpp>
+
+/* Reverses the bits of an integer. */
+static inline uint32_t ReverseBits(uint32_t x)
+{
+    x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+    x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+    x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+    x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+/* Owen-scrambles the bits of a 0.32 fixed-point number: each bit is flipped depending on a hash of the bits above it
+ * (this is the Laine-Karras permutation, on the reversed bits, with Burley's constants). */
+static inline uint32_t OwenScramble(uint32_t x, uint32_t seed)
+{
+    x = ReverseBits(x);
+    x += seed;
+    x ^= x * 0x6C50B47Cu;
+    x ^= x * 0xB82F1E52u;
+    x ^= x * 0xC7AFE638u;
+    x ^= x * 0x8D22F6E6u;
+    return ReverseBits(x);
+}
+
+/* Returns the second dimension of a Sobol point, as a 0.32 fixed-point number (the first is its reversed index). */
+static inline uint32_t SobolSecond(uint32_t index)
+{
+    uint32_t result = 0;
+    for (uint32_t v = 0x80000000u; index != 0; index >>= 1, v ^= v >> 1)
+        if (index & 1) result ^= v;
+    return result;
+}
+
+/* Converts a 0.32 fixed-point number to a float in [0, 1). */
+static inline float FixedToFloat(uint32_t x)
+{
+    return (x >> 8) * (1.0f / 16777216.0f);
+}
+
+float SobolSampler::Next1D()
+{
+    /* This is the first dimension of a shuffled, scrambled point (without the shuffle, the dimensions drawn for the
+     * same point would all be stratified alike, and so correlated). */
+    uint32_t hash = SampleSeed(seed, pixel, dimension++);
+    uint32_t shuffled = OwenScramble(index, hash);
+    return FixedToFloat(OwenScramble(ReverseBits(shuffled), SampleSeed(hash, pixel, 0)));
+}
+
+void SobolSampler::Next2D(float* u1, float* u2)
+{
+    /* Shuffle the points, so that pairs of dimensions are not correlated, then scramble each coordinate. */
+    uint32_t hash = SampleSeed(seed, pixel, dimension);
+    uint32_t shuffled = OwenScramble(index, hash);
+    *u1 = FixedToFloat(OwenScramble(ReverseBits(shuffled), SampleSeed(hash, pixel, 0)));
+    *u2 = FixedToFloat(OwenScramble(SobolSecond(shuffled), SampleSeed(hash, pixel, 1)));
+    dimension += 2;
+}
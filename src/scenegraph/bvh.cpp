@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <scenegraph/bvh.hpp>
+#include <util/statistics.hpp>
 #include <limits>
 
 //! Node for storing state information during traversal.
@@ -18,9 +19,24 @@ struct BVHTraversal {
 //!   set occlusion == true, in which case we exit on the first hit, rather
 //!   than find the closest.
 bool BVH::getIntersection(const Ray& ray, Intersection* intersection, bool occlusion) const {
-    /* Initialize intersection. */
-	intersection->t = std::numeric_limits<float>::infinity();
+ return traverse<false>(ray, intersection, occlusion, std::numeric_limits<float>::infinity(), nullptr);
+}
+
+bool BVH::getIntersection(const Ray& ray, Intersection* intersection, bool occlusion, TraversalCost* cost) const {
+ return traverse<true>(ray, intersection, occlusion, std::numeric_limits<float>::infinity(), cost);
+}
+
+bool BVH::occluded(const Ray& ray, float distance) const {
+ Intersection intersection;
+ return traverse<false>(ray, &intersection, true, distance, nullptr);
+}
+
+template <bool Counted>
+bool BVH::traverse(const Ray& ray, Intersection* intersection, bool occlusion, float maxDistance, TraversalCost* cost) const {
+    /* Initialize intersection, only looking for intersections closer than the maximum distance. */
+	intersection->t = maxDistance;
 	intersection->primitive = nullptr;
+ STATISTIC(rays);
  float bbhits[4];
  int32_t closer, other;
 
@@ -42,9 +58,13 @@ bool BVH::getIntersection(const Ray& ray, Intersection* intersection, bool occlu
   // If this node is further than the closest found intersection, continue
   if(near > intersection->t)
    continue;
+  STATISTIC(nodeVisits);
+  if (Counted) cost->nodes++;
 
   // Is leaf -> Intersect
   if( node.rightOffset == 0 ) {
+   STATISTIC_ADD(primitiveTests, node.nPrims);
+   if (Counted) cost->primitives += node.nPrims;
    for(uint32_t o=0;o<node.nPrims;++o) {
                 Primitive* primitive = (*build_prims)[node.start+o];
                 float distance = primitive->Intersect(ray);
@@ -60,6 +80,7 @@ bool BVH::getIntersection(const Ray& ray, Intersection* intersection, bool occlu
 
   } else { // Not a leaf
 
+   STATISTIC_ADD(boxTests, 2);
    bool hitc0 = flatTree[ni+1].bbox.intersect(ray, bbhits, bbhits+1);
    bool hitc1 = flatTree[ni+node.rightOffset].bbox.intersect(ray, bbhits+2, bbhits+3);
 
@@ -110,12 +131,100 @@ BVH::~BVH() {
 }
 
 BVH::BVH(std::vector<Primitive*>* objects, uint32_t leafSize)
-: leafSize(leafSize), build_prims(objects), flatTree(NULL), nNodes(0), nLeafs(0) {
+: leafSize(leafSize), build_prims(objects), flatTree(NULL), builtCost(0), nNodes(0), nLeafs(0) {
 
  // Build the tree based on the input object data set.
 	build();
 }
 
+void BVH::rebuild() {
+ delete[] flatTree;
+ flatTree = NULL;
+ nNodes = nLeafs = 0;
+ build();
+}
+
+//! - Children always come after their parent in the flat tree, so the nodes are
+//!   sorted by depth once, and the refit goes up one level at a time, fitting
+//!   the nodes of each level in parallel (they only read the level below).
+//! - Leaves are fitted to their primitives, other nodes to their two children.
+void BVH::refit() {
+ for(size_t l = 0; l + 1 < levelStarts.size(); ++l) {
+  const int64_t begin = levelStarts[l], end = levelStarts[l+1];
+
+  #pragma omp parallel for if(end - begin >= 256) schedule(static)
+  for(int64_t i = begin; i < end; ++i) {
+   BVHFlatNode &node(flatTree[ levelNodes[i] ]);
+   if( node.rightOffset == 0 ) {
+    AABB bb( (*build_prims)[node.start]->BoundingBox());
+    for(uint32_t p = node.start+1; p < node.start+node.nPrims; ++p)
+     bb.expandToInclude( (*build_prims)[p]->BoundingBox());
+    node.bbox = bb;
+   } else {
+    AABB bb( flatTree[ levelNodes[i]+1 ].bbox );
+    bb.expandToInclude( flatTree[ levelNodes[i]+node.rightOffset ].bbox );
+    node.bbox = bb;
+   }
+  }
+ }
+}
+
+//! Each node is visited by a ray with probability (its area / the root's area),
+//! traversing it costs 1, and testing each primitive of a leaf costs 1.
+float BVH::cost() const {
+ const float rootArea = flatTree[0].bbox.surfaceArea();
+ if(!(rootArea > 0))
+  return 0;
+
+ double sum = 0;
+ for(uint32_t n = 0; n < nNodes; ++n) {
+  const BVHFlatNode &node(flatTree[n]);
+  sum += node.bbox.surfaceArea() * (node.rightOffset == 0 ? node.nPrims : 1);
+ }
+
+ return (float)(sum / rootArea);
+}
+
+float BVH::degradation() const {
+ return (builtCost > 0) ? cost() / builtCost : 1.f;
+}
+
+bool BVH::update(float maxDegradation) {
+ refit();
+ if(degradation() <= maxDegradation)
+  return false;
+
+ rebuild();
+ return true;
+}
+
+void BVH::finishBuild() {
+ // Depth of every node, from its parent's
+ std::vector<uint32_t> depth(nNodes, 0);
+ uint32_t maxDepth = 0;
+ for(uint32_t n = 0; n < nNodes; ++n) {
+  maxDepth = std::max(maxDepth, depth[n]);
+  if( flatTree[n].rightOffset != 0 ) {
+   depth[n+1] = depth[n] + 1;
+   depth[n+flatTree[n].rightOffset] = depth[n] + 1;
+  }
+ }
+
+ // Counting sort of the nodes by depth, deepest first
+ levelStarts.assign(maxDepth + 2, 0);
+ for(uint32_t n = 0; n < nNodes; ++n)
+  levelStarts[maxDepth - depth[n] + 1]++;
+ for(uint32_t l = 1; l < levelStarts.size(); ++l)
+  levelStarts[l] += levelStarts[l-1];
+
+ std::vector<uint32_t> next(levelStarts.begin(), levelStarts.end() - 1);
+ levelNodes.resize(nNodes);
+ for(uint32_t n = 0; n < nNodes; ++n)
+  levelNodes[ next[maxDepth - depth[n]]++ ] = n;
+
+ builtCost = cost();
+}
+
 struct BVHBuildEntry {
  // If non-zero then this is the index of the parent. (used in offsets)
  uint32_t parent;
@@ -231,5 +340,7 @@ void BVH::build()
 	flatTree = new BVHFlatNode[nNodes];
 	for(uint32_t n=0; n<nNodes; ++n)
 		flatTree[n] = buildnodes[n];
+
+	finishBuild();
 }
 
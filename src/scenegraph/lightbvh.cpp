@@ -0,0 +1,125 @@
+#include <scenegraph/lightbvh.hpp>
+#include <algorithm>
+
+using namespace std;
+
+LightBVH::LightBVH(const vector<Primitive*>& lights, const vector<float>& powers)
+{
+    if (lights.empty()) return;
+
+    vector<AABB> bounds(lights.size());
+    vector<uint32_t> order(lights.size());
+    for (size_t t = 0; t < lights.size(); ++t)
+    {
+        bounds[t] = lights[t]->BoundingBox();
+        order[t] = t;
+    }
+
+    nodes.reserve(2 * lights.size() - 1);
+    trails.resize(lights.size());
+    Build(order.begin(), order.end(), bounds, powers, 0, 0);
+}
+
+uint32_t LightBVH::Build(vector<uint32_t>::iterator first, vector<uint32_t>::iterator last,
+                         const vector<AABB>& bounds, const vector<float>& powers, uint32_t depth, uint64_t trail)
+{
+    uint32_t index = nodes.size();
+    nodes.push_back(LightNode());
+
+    /* A single light makes a leaf. */
+    if (last - first == 1)
+    {
+        nodes[index].bounds = bounds[*first];
+        nodes[index].power = powers[*first];
+        nodes[index].index = *first;
+        nodes[index].leaf = true;
+        trails[*first] = trail;
+        return index;
+    }
+
+    /* Otherwise, split the lights at the median along the longest axis of their centroids. */
+    AABB centroids((bounds[*first].min + bounds[*first].max) * 0.5f);
+    for (vector<uint32_t>::iterator t = first + 1; t != last; ++t)
+        centroids.expandToInclude((bounds[*t].min + bounds[*t].max) * 0.5f);
+    uint32_t axis = centroids.maxDimension();
+
+    vector<uint32_t>::iterator middle = first + (last - first) / 2;
+    nth_element(first, middle, last, [&](uint32_t a, uint32_t b)
+                { return bounds[a].min[axis] + bounds[a].max[axis] < bounds[b].min[axis] + bounds[b].max[axis]; });
+
+    Build(first, middle, bounds, powers, depth + 1, trail);
+    uint32_t second = Build(middle, last, bounds, powers, depth + 1, trail | ((uint64_t)1 << depth));
+
+    /* The node covers both of its children. */
+    nodes[index].bounds = nodes[index + 1].bounds;
+    nodes[index].bounds.expandToInclude(nodes[second].bounds);
+    nodes[index].power = nodes[index + 1].power + nodes[second].power;
+    nodes[index].index = second;
+    nodes[index].leaf = false;
+    return index;
+}
+
+float LightBVH::Importance(const LightNode& node, Vector point) const
+{
+    /* The power over the squared distance to the node's center, no closer than its half diagonal. */
+    Vector offset = (node.bounds.min + node.bounds.max) * 0.5f - point;
+    float distance2 = max(offset * offset, 0.25f * (node.bounds.extent * node.bounds.extent));
+    return (distance2 > 0.0f) ? node.power / distance2 : node.power;
+}
+
+uint32_t LightBVH::Sample(Vector point, float u, float* probability) const
+{
+    /* Descend from the root, choosing children by importance and reusing the rest of the number each time. */
+    *probability = 1.0f;
+    uint32_t index = 0;
+    while (!nodes[index].leaf)
+    {
+        float first = Importance(nodes[index + 1], point);
+        float second = Importance(nodes[nodes[index].index], point);
+        float p = (first + second > 0.0f) ? first / (first + second) : 0.5f;
+
+        if (u < p)
+        {
+            u = min(u / p, 0.99999994f);
+            *probability *= p;
+            index = index + 1;
+        }
+        else
+        {
+            u = min((u - p) / (1.0f - p), 0.99999994f);
+            *probability *= 1.0f - p;
+            index = nodes[index].index;
+        }
+    }
+
+    return nodes[index].index;
+}
+
+float LightBVH::Probability(Vector point, uint32_t light) const
+{
+    /* Follow the light's trail from the root, as it would have been picked. */
+    float probability = 1.0f;
+    uint64_t trail = trails[light];
+    uint32_t index = 0;
+    while (!nodes[index].leaf)
+    {
+        float first = Importance(nodes[index + 1], point);
+        float second = Importance(nodes[nodes[index].index], point);
+        float p = (first + second > 0.0f) ? first / (first + second) : 0.5f;
+
+        if (trail & 1)
+        {
+            probability *= 1.0f - p;
+            index = nodes[index].index;
+        }
+        else
+        {
+            probability *= p;
+            index = index + 1;
+        }
+
+        trail >>= 1;
+    }
+
+    return probability;
+}
@@ -6,15 +6,15 @@
 #include <spectral/peak.hpp>
 #include <spectral/sellmeier.hpp>
 
-/* This creates the correct distribution type based on a scene file entity subtype. */
-Distribution* GetDistribution(uint32_t subtype, std::fstream& file)
+/* This creates the correct distribution type based on a scene file entity subtype, in an arena. */
+Distribution* GetDistribution(uint32_t subtype, std::fstream& file, Arena* arena)
 {
     switch (subtype)
     {
-        case ID_BLACKBODY: return new BlackBody(file);
-        case ID_FLAT: return new Flat(file);
-        case ID_PEAK: return new Peak(file);
-        case ID_SELLMEIER: return new Sellmeier(file);
+        case ID_BLACKBODY: return new (*arena) BlackBody(file);
+        case ID_FLAT: return new (*arena) Flat(file);
+        case ID_PEAK: return new (*arena) Peak(file);
+        case ID_SELLMEIER: return new (*arena) Sellmeier(file);
     }
 
     /* Unknown subtype. */
@@ -0,0 +1,100 @@
+#include <util/accumulation.hpp>
+#include <cstring>
+#include <cstdio>
+
+/* This identifies accumulation buffer files, and their format version. */
+#define ACCUMULATION_MAGIC 0x43434C4C
+#define ACCUMULATION_VERSION 1
+
+/* This is the accumulation buffer file header, which is followed by the sums (four floats per pixel) and then by
+ * the counts, both from top to bottom. */
+#pragma pack(1)
+struct AccumulationHeader
+{
+    uint32_t magic, version;
+    int32_t width, height;
+    ColorSystem colorSystem;
+};
+#pragma pack()
+
+/* Saves an accumulation buffer to a file. */
+bool SaveAccumulation(std::string path, const AccumulationBuffer& buffer)
+{
+    /* Create the destination file. */
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == 0) return false;
+
+    AccumulationHeader header = {ACCUMULATION_MAGIC, ACCUMULATION_VERSION, buffer.width, buffer.height,
+                                 buffer.colorSystem};
+    fwrite(&header, sizeof(AccumulationHeader), 1, file);
+
+    /* Write the sums, and then the counts. */
+    fwrite(&buffer.sums[0], sizeof(Vector), buffer.sums.size(), file);
+    fwrite(&buffer.counts[0], sizeof(uint32_t), buffer.counts.size(), file);
+
+    /* Close the file. */
+    bool success = !ferror(file);
+    fclose(file);
+    return success;
+}
+
+/* Loads an accumulation buffer from a file. */
+bool LoadAccumulation(std::string path, AccumulationBuffer* buffer)
+{
+    /* Open the source file. */
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == 0) return false;
+
+    /* Read and check the header. */
+    AccumulationHeader header;
+    if ((fread(&header, sizeof(AccumulationHeader), 1, file) != 1) || (header.magic != ACCUMULATION_MAGIC)
+     || (header.version != ACCUMULATION_VERSION) || (header.width <= 0) || (header.height <= 0))
+    {
+        fclose(file);
+        return false;
+    }
+
+    buffer->width = header.width;
+    buffer->height = header.height;
+    buffer->colorSystem = header.colorSystem;
+    buffer->sums.resize(header.width * header.height);
+    buffer->counts.resize(header.width * header.height);
+
+    /* Read the sums, and then the counts. */
+    bool success = (fread(&buffer->sums[0], sizeof(Vector), buffer->sums.size(), file) == buffer->sums.size());
+    if (success) success = (fread(&buffer->counts[0], sizeof(uint32_t), buffer->counts.size(), file)
+                            == buffer->counts.size());
+
+    /* Close the file. */
+    fclose(file);
+    return success;
+}
+
+/* Adds an accumulation buffer to another. */
+bool MergeAccumulation(AccumulationBuffer* buffer, const AccumulationBuffer& other)
+{
+    /* The buffers must be of the same image. */
+    if ((buffer->width != other.width) || (buffer->height != other.height)
+     || memcmp(&buffer->colorSystem, &other.colorSystem, sizeof(ColorSystem))) return false;
+
+    for (size_t t = 0; t < buffer->sums.size(); ++t)
+    {
+        buffer->sums[t] += other.sums[t];
+        buffer->counts[t] += other.counts[t];
+    }
+
+    return true;
+}
+
+/* Averages the samples of an accumulation buffer and converts them to linear RGB. */
+void ResolveAccumulation(const AccumulationBuffer& buffer, Vector* pixels)
+{
+    /* Only the XYZ to RGB matrix is used here, which doesn't depend on the spectral resolution. */
+    typedef SpectralGrid<RESOLUTION_FINAL> Grid;
+    const ColorPipeline pipeline(buffer.colorSystem, Grid::MatchingCurve(), Grid::wavelengths);
+
+    for (size_t t = 0; t < buffer.sums.size(); ++t)
+        pixels[t] = (buffer.counts[t] > 0) ? buffer.sums[t] / (float)buffer.counts[t] : ZERO;
+
+    pipeline.ToRGB(pixels, buffer.sums.size(), pixels, 1.0f);
+}
@@ -0,0 +1,56 @@
+#include <util/alias.hpp>
+#include <algorithm>
+
+using namespace std;
+
+AliasTable::AliasTable(const vector<float>& weights)
+{
+    size_t count = weights.size();
+    probabilities.resize(count);
+    thresholds.resize(count);
+    aliases.resize(count);
+
+    double total = 0.0;
+    for (size_t t = 0; t < count; ++t) total += weights[t];
+
+    /* Scale the probabilities so that they average to one slot, and split them into those under and over a slot. */
+    vector<double> scaled(count);
+    vector<uint32_t> under, over;
+    for (size_t t = 0; t < count; ++t)
+    {
+        probabilities[t] = (total > 0.0) ? (float)(weights[t] / total) : 1.0f / count;
+        scaled[t] = (total > 0.0) ? weights[t] / total * count : 1.0;
+        if (scaled[t] < 1.0) under.push_back(t);
+        else over.push_back(t);
+    }
+
+    /* Fill each slot under one with the rest of a slot over one, which may then fall under one in turn. */
+    while (!under.empty() && !over.empty())
+    {
+        uint32_t small = under.back(), large = over.back();
+        under.pop_back();
+        thresholds[small] = (float)scaled[small];
+        aliases[small] = large;
+
+        scaled[large] -= 1.0 - scaled[small];
+        if (scaled[large] < 1.0)
+        {
+            over.pop_back();
+            under.push_back(large);
+        }
+    }
+
+    /* Whatever is left is a whole slot, up to rounding. */
+    for (size_t t = 0; t < under.size(); ++t) thresholds[under[t]] = 1.0f, aliases[under[t]] = under[t];
+    for (size_t t = 0; t < over.size(); ++t) thresholds[over[t]] = 1.0f, aliases[over[t]] = over[t];
+}
+
+uint32_t AliasTable::Sample(float u, float* probability) const
+{
+    /* Pick a slot, and reuse the rest of the number to pick between its index and its alias. */
+    float scaled = u * thresholds.size();
+    uint32_t slot = min((uint32_t)scaled, (uint32_t)thresholds.size() - 1);
+    uint32_t index = (scaled - slot < thresholds[slot]) ? slot : aliases[slot];
+    if (probability) *probability = probabilities[index];
+    return index;
+}
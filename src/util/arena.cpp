@@ -0,0 +1,67 @@
+#include <util/arena.hpp>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#define AlignedFree _aligned_free
+#else
+#include <sys/mman.h>
+#define AlignedFree free
+#endif
+
+Arena::Arena(size_t blockSize, bool hugePages) : cursor(nullptr), end(nullptr), blockSize(blockSize), allocated(0),
+                                                used(0), hugePages(hugePages)
+{
+    /* Huge pages are only worth it for whole huge pages. */
+    if (hugePages) this->blockSize = (blockSize + HUGEPAGE_SIZE - 1) / HUGEPAGE_SIZE * HUGEPAGE_SIZE;
+}
+
+char* Arena::AllocateBlock(size_t size)
+{
+    /* Huge pages must be aligned to their size, otherwise the sub-allocations only need the SSE alignment. */
+    size_t alignment = hugePages ? HUGEPAGE_SIZE : ARENA_ALIGNMENT;
+    if (hugePages) size = (size + HUGEPAGE_SIZE - 1) / HUGEPAGE_SIZE * HUGEPAGE_SIZE;
+
+    #ifdef _WIN32
+    void* block = _aligned_malloc(size, alignment);
+    if (!block) throw std::bad_alloc();
+    #else
+    void* block;
+    if (posix_memalign(&block, alignment, size) != 0) throw std::bad_alloc();
+
+    /* Ask for the block to be backed by transparent huge pages (this is only advice, and may be ignored). */
+    #ifdef MADV_HUGEPAGE
+    if (hugePages) madvise(block, size, MADV_HUGEPAGE);
+    #endif
+    #endif
+
+    blocks.push_back((char*)block);
+    allocated += size;
+    return (char*)block;
+}
+
+void* Arena::Allocate(size_t size)
+{
+    size = (size + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+    used += size;
+
+    /* Allocations larger than a quarter of a block get a block of their own, so as not to waste the current one. */
+    if (size > blockSize / 4) return AllocateBlock(size);
+
+    /* Otherwise, carve the allocation out of the current block, starting a new one when it is full. */
+    if ((size_t)(end - cursor) < size)
+    {
+        cursor = AllocateBlock(blockSize);
+        end = cursor + blockSize;
+    }
+
+    void* allocation = cursor;
+    cursor += size;
+    return allocation;
+}
+
+Arena::~Arena()
+{
+    for (size_t t = 0; t < blocks.size(); ++t) AlignedFree(blocks[t]);
+}
@@ -30,60 +30,165 @@ static Vector ColorMatchingCurve[81] = {
     Vector(0.0002,0.0001,0.0000), Vector(0.0002,0.0001,0.0000), Vector(0.0001,0.0000,0.0000),
     Vector(0.0001,0.0000,0.0000), Vector(0.0001,0.0000,0.0000), Vector(0.0000,0.0000,0.0000)};
 
-/* Converts a spectral radiance distribution to an RGB color. */
-Vector SpectrumToRGB(float spectralRadiance[WAVELENGTHS], ColorSystem colorSystem)
+/* Filters the color-matching curves down to a coarser resolution (this is a tent filter). */
+void FilterMatchingCurve(int resolution, Vector* curve)
 {
-    /* Simply integrate the color-matching curve. */
-    float radiance = 0;
-    Vector color = Vector(0, 0, 0);
-    for (int w = 0; w < WAVELENGTHS; w++)
+    /* Each grid sample averages the native samples within one grid interval of it, so that narrow features of
+     * the curves still contribute at coarse resolutions. At the native resolution, this is the identity. */
+    int wavelengths = 1 + (WAVELENGTH_MAX - WAVELENGTH_MIN) / resolution;
+    int samples = 1 + (WAVELENGTH_MAX - WAVELENGTH_MIN) / CIE_RESOLUTION;
+    for (int w = 0; w < wavelengths; ++w)
     {
-        color = color + ColorMatchingCurve[w * (RESOLUTION / 5)] * spectralRadiance[w];
-        radiance += spectralRadiance[w];
+        float weights = 0.0f;
+        curve[w] = Vector(0, 0, 0);
+        for (int t = 0; t < samples; ++t)
+        {
+            float weight = 1.0f - std::abs(t * CIE_RESOLUTION - w * resolution) / (float)resolution;
+            if (weight <= 0.0f) continue;
+
+            curve[w] = curve[w] + ColorMatchingCurve[t] * weight;
+            weights += weight;
+        }
+
+        curve[w] = curve[w] / weights;
     }
+}
+
+/* Returns the color-matching curve at any wavelength in the visible spectrum (this is linearly interpolated). */
+Vector ColorMatching(float wavelength)
+{
+    /* Find the interval of the curve this wavelength falls in. */
+    float position = (wavelength - WAVELENGTH_MIN) / CIE_RESOLUTION;
+    int last = (WAVELENGTH_MAX - WAVELENGTH_MIN) / CIE_RESOLUTION;
+    int t = std::max(0, std::min((int)position, last - 1));
+
+    /* Interpolate between its two endpoints. */
+    return lerp(ColorMatchingCurve[t], ColorMatchingCurve[t + 1], std::max(0.0f, std::min(position - t, 1.0f)));
+}
+
+/* Builds the wavelength distribution from the color-matching curves. */
+WavelengthSampler::WavelengthSampler()
+{
+    /* Integrate the sum of the three curves over each interval with the trapezoidal rule. */
+    const int intervals = (WAVELENGTH_MAX - WAVELENGTH_MIN) / CIE_RESOLUTION;
+    float weight[intervals], total = 0.0f;
+    for (int t = 0; t < intervals; ++t)
+    {
+        Vector a = ColorMatchingCurve[t], b = ColorMatchingCurve[t + 1];
+        weight[t] = (a.x + a.y + a.z + b.x + b.y + b.z) * 0.5f;
+        total += weight[t];
+    }
+
+    /* Mix in a uniform distribution, and accumulate the interval probabilities. */
+    cdf[0] = 0.0f;
+    for (int t = 0; t < intervals; ++t)
+    {
+        float probability = (1.0f - WAVELENGTH_DEFENSIVE) * weight[t] / total + WAVELENGTH_DEFENSIVE / intervals;
+        cdf[t + 1] = cdf[t] + probability;
+    }
+
+    /* Make sure the distribution ends at exactly one. */
+    cdf[intervals] = 1.0f;
+}
+
+/* Returns a wavelength, in nanometers, from a uniform random number. */
+float WavelengthSampler::Sample(float u, float* pdf) const
+{
+    /* Find the interval the random number falls in, by binary search. */
+    const int intervals = (WAVELENGTH_MAX - WAVELENGTH_MIN) / CIE_RESOLUTION;
+    int t = (int)(std::upper_bound(cdf, cdf + intervals + 1, u) - cdf) - 1;
+    t = std::max(0, std::min(t, intervals - 1));
+
+    /* The density is uniform within the interval. */
+    float probability = cdf[t + 1] - cdf[t];
+    *pdf = probability / CIE_RESOLUTION;
+    return WAVELENGTH_MIN + CIE_RESOLUTION * (t + std::min((u - cdf[t]) / probability, 1.0f));
+}
 
-    /* Normalize the XYZ color. */
-    float sum = color.x + color.y + color.z;
-    if (sum > EPSILON) color = color / sum;
+/* Builds the pipeline for a color system, from a matching curve at some spectral resolution. */
+ColorPipeline::ColorPipeline(ColorSystem colorSystem, const Vector* matchingCurve, int wavelengths)
+{
+    /* Bake the matching curves, transposed so that they can be read four wavelengths at a time. */
+    stride = (wavelengths + 3) & ~3;
+    for (int w = 0; w < stride; ++w)
+    {
+        curves[0][w] = (w < wavelengths) ? matchingCurve[w].x : 0.0f;
+        curves[1][w] = (w < wavelengths) ? matchingCurve[w].y : 0.0f;
+        curves[2][w] = (w < wavelengths) ? matchingCurve[w].z : 0.0f;
+        curves[3][w] = (w < wavelengths) ? 1.0f : 0.0f;
+    }
 
     /* Decode the color system. */
-    float xr = colorSystem.xRed;   float yr = colorSystem.yRed;   float zr = 1 - (xr + yr);
-    float xg = colorSystem.xGreen; float yg = colorSystem.yGreen; float zg = 1 - (xg + yg);
-    float xb = colorSystem.xBlue;  float yb = colorSystem.yBlue;  float zb = 1 - (xb + yb);
-    float xw = colorSystem.xWhite; float yw = colorSystem.yWhite; float zw = 1 - (xw + yw);
+    double xr = colorSystem.xRed;   double yr = colorSystem.yRed;   double zr = 1 - (xr + yr);
+    double xg = colorSystem.xGreen; double yg = colorSystem.yGreen; double zg = 1 - (xg + yg);
+    double xb = colorSystem.xBlue;  double yb = colorSystem.yBlue;  double zb = 1 - (xb + yb);
+    double xw = colorSystem.xWhite; double yw = colorSystem.yWhite; double zw = 1 - (xw + yw);
 
     /* Compute the XYZ to RGB matrix. */
-    float rx = (yg * zb) - (yb * zg);
-    float ry = (xb * zg) - (xg * zb);
-    float rz = (xg * yb) - (xb * yg);
-    float gx = (yb * zr) - (yr * zb);
-    float gy = (xr * zb) - (xb * zr);
-    float gz = (xb * yr) - (xr * yb);
-    float bx = (yr * zg) - (yg * zr);
-    float by = (xg * zr) - (xr * zg);
-    float bz = (xr * yg) - (xg * yr);
+    double rx = (yg * zb) - (yb * zg);
+    double ry = (xb * zg) - (xg * zb);
+    double rz = (xg * yb) - (xb * yg);
+    double gx = (yb * zr) - (yr * zb);
+    double gy = (xr * zb) - (xb * zr);
+    double gz = (xb * yr) - (xr * yb);
+    double bx = (yr * zg) - (yg * zr);
+    double by = (xg * zr) - (xr * zg);
+    double bz = (xr * yg) - (xg * yr);
 
     /* Compute the RGB luminance scaling factor. */
-    float rw = ((rx * xw) + (ry * yw) + (rz * zw)) / yw;
-    float gw = ((gx * xw) + (gy * yw) + (gz * zw)) / yw;
-    float bw = ((bx * xw) + (by * yw) + (bz * zw)) / yw;
-
-    /* Scale the XYZ to RGB matrix to white. */
-    rx = rx / rw;  ry = ry / rw;  rz = rz / rw;
-    gx = gx / gw;  gy = gy / gw;  gz = gz / gw;
-    bx = bx / bw;  by = by / bw;  bz = bz / bw;
-
-    /* Calculate the desired RGB. */
-    Vector rgb = Vector((rx * color.x) + (ry * color.y) + (rz * color.z),
-                        (gx * color.x) + (gy * color.y) + (gz * color.z),
-                        (bx * color.x) + (by * color.y) + (bz * color.z));
-
-    /* Constrain the RGB color within the RGB gamut. */
-    float w = std::min(0.0f, std::min(rgb.x, std::min(rgb.y, rgb.z)));
-    rgb = rgb - Vector(w, w, w);
-
-    /* Multiply the final RGB color by the pixel's radiance. */
-    return rgb * radiance;
+    double rw = ((rx * xw) + (ry * yw) + (rz * zw)) / yw;
+    double gw = ((gx * xw) + (gy * yw) + (gz * zw)) / yw;
+    double bw = ((bx * xw) + (by * yw) + (bz * zw)) / yw;
+
+    /* Scale the XYZ to RGB matrix to white, and store it by columns. */
+    matrix[0] = Vector(rx / rw, gx / gw, bx / bw);
+    matrix[1] = Vector(ry / rw, gy / gw, by / bw);
+    matrix[2] = Vector(rz / rw, gz / gw, bz / bw);
+}
+
+/* Integrates a batch of spectra into XYZ colors and total radiances. */
+void ColorPipeline::Integrate(const float* spectra, size_t count, Vector* colors) const
+{
+    for (size_t t = 0; t < count; ++t)
+    {
+        /* Accumulate the four dot products, four wavelengths at a time. */
+        const float* spectrum = spectra + t * stride;
+        __m128 x = _mm_setzero_ps(), y = _mm_setzero_ps(), z = _mm_setzero_ps(), l = _mm_setzero_ps();
+        for (int w = 0; w < stride; w += 4)
+        {
+            __m128 radiance = _mm_load_ps(spectrum + w);
+            x = _mm_add_ps(x, _mm_mul_ps(radiance, _mm_load_ps(curves[0] + w)));
+            y = _mm_add_ps(y, _mm_mul_ps(radiance, _mm_load_ps(curves[1] + w)));
+            z = _mm_add_ps(z, _mm_mul_ps(radiance, _mm_load_ps(curves[2] + w)));
+            l = _mm_add_ps(l, _mm_mul_ps(radiance, _mm_load_ps(curves[3] + w)));
+        }
+
+        /* Reduce the partial sums, giving (X, Y, Z, radiance). */
+        _MM_TRANSPOSE4_PS(x, y, z, l);
+        colors[t] = _mm_add_ps(_mm_add_ps(x, y), _mm_add_ps(z, l));
+    }
+}
+
+/* Converts a batch of integrated colors to RGB colors, multiplied by some scale. */
+void ColorPipeline::ToRGB(const Vector* colors, size_t count, Vector* rgb, float scale) const
+{
+    for (size_t t = 0; t < count; ++t)
+    {
+        /* Normalize the XYZ color. */
+        Vector color = colors[t];
+        float sum = color.x + color.y + color.z;
+        if (sum > EPSILON) color = color / sum;
+
+        /* Calculate the desired RGB. */
+        Vector c = matrix[0] * color.x + matrix[1] * color.y + matrix[2] * color.z;
+
+        /* Constrain the RGB color within the RGB gamut. */
+        float w = std::min(0.0f, std::min(c.x, std::min(c.y, c.z)));
+        c = c - Vector(w, w, w);
+
+        /* Multiply the final RGB color by the pixel's radiance. */
+        rgb[t] = c * (colors[t].w * scale);
+    }
 }
 
 /* Returns the luminance of an RGB color according to a given color system. */
@@ -0,0 +1,135 @@
+#include <util/imageio.hpp>
+#include <algorithm>
+#include <cstdio>
+
+/* Returns whether this machine is little-endian, which is what the PFM files are written as. */
+static bool LittleEndian()
+{
+    uint32_t word = 1;
+    return *(uint8_t*)&word == 1;
+}
+
+/* Swaps the byte order of a float in place. */
+static void SwapBytes(float* value)
+{
+    uint8_t* bytes = (uint8_t*)value;
+    std::swap(bytes[0], bytes[3]);
+    std::swap(bytes[1], bytes[2]);
+}
+
+/* Saves a pixel array to a PFM file. */
+bool SavePFM(std::string path, const Vector* pixels, int32_t width, int32_t height)
+{
+    /* Create the destination file. */
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == 0) return false;
+
+    /* A negative scale means little-endian. */
+    fprintf(file, "PF\n%d %d\n%s\n", width, height, LittleEndian() ? "-1.0" : "1.0");
+
+    /* Write the rows in, from the bottom up. */
+    std::vector<float> row(width * 3);
+    for (int32_t y = height - 1; y >= 0; --y)
+    {
+        for (int32_t x = 0; x < width; ++x)
+        {
+            row[x * 3 + 0] = pixels[y * width + x].x;
+            row[x * 3 + 1] = pixels[y * width + x].y;
+            row[x * 3 + 2] = pixels[y * width + x].z;
+        }
+
+        fwrite(&row[0], sizeof(float), row.size(), file);
+    }
+
+    /* Close the file. */
+    bool success = !ferror(file);
+    fclose(file);
+    return success;
+}
+
+/* Saves a single-channel float array to a grayscale PFM file. */
+bool SavePFM(std::string path, const float* values, int32_t width, int32_t height)
+{
+    /* Create the destination file. */
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == 0) return false;
+
+    /* A negative scale means little-endian. */
+    fprintf(file, "Pf\n%d %d\n%s\n", width, height, LittleEndian() ? "-1.0" : "1.0");
+
+    /* Write the rows in, from the bottom up. */
+    for (int32_t y = height - 1; y >= 0; --y) fwrite(values + y * width, sizeof(float), width, file);
+
+    /* Close the file. */
+    bool success = !ferror(file);
+    fclose(file);
+    return success;
+}
+
+/* Saves a tonemapped pixel array to a plain text PPM file. */
+bool SavePPM(std::string path, const Vector* pixels, int32_t width, int32_t height, std::string comment)
+{
+    /* Create the destination file. */
+    FILE* file = fopen(path.c_str(), "w");
+    if (file == 0) return false;
+
+    /* Write a short header, with the comment. */
+    fprintf(file, "P3\n\n");
+    for (size_t start = 0; start < comment.size(); )
+    {
+        size_t end = std::min(comment.find('\n', start), comment.size());
+        fprintf(file, "# %s\n", comment.substr(start, end - start).c_str());
+        start = end + 1;
+    }
+    fprintf(file, "\n%d %d 255\n", width, height);
+
+    /* Write the pixel buffer in. */
+    for (int32_t t = 0; t < width * height; ++t)
+        fprintf(file, "%d %d %d ", (int)(std::min(pixels[t].x, 1.0f) * 255.0f),
+                                   (int)(std::min(pixels[t].y, 1.0f) * 255.0f),
+                                   (int)(std::min(pixels[t].z, 1.0f) * 255.0f));
+
+    /* Close the file. */
+    bool success = !ferror(file);
+    fclose(file);
+    return success;
+}
+
+/* Loads a pixel array from a PFM file. */
+bool LoadPFM(std::string path, std::vector<Vector>* pixels, int32_t* width, int32_t* height)
+{
+    /* Open the source file. */
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == 0) return false;
+
+    /* Read the header, only color images are supported. */
+    char magic[3] = {0};
+    float scale;
+    if ((fscanf(file, "%2s %d %d %f", magic, width, height, &scale) != 4) || (magic[0] != 'P')
+     || (magic[1] != 'F') || (*width <= 0) || (*height <= 0) || (fgetc(file) == EOF))
+    {
+        fclose(file);
+        return false;
+    }
+
+    /* Read the rows, from the bottom up, swapping bytes if the file is not in the machine's order. */
+    bool swap = (scale < 0.0f) != LittleEndian();
+    std::vector<float> row(*width * 3);
+    pixels->resize(*width * *height);
+    for (int32_t y = *height - 1; y >= 0; --y)
+    {
+        if (fread(&row[0], sizeof(float), row.size(), file) != row.size())
+        {
+            fclose(file);
+            return false;
+        }
+
+        if (swap) for (size_t t = 0; t < row.size(); ++t) SwapBytes(&row[t]);
+        for (int32_t x = 0; x < *width; ++x)
+            pixels->at(y * *width + x) = Vector(row[x * 3 + 0], row[x * 3 + 1], row[x * 3 + 2]);
+    }
+
+    /* Close the file. */
+    fclose(file);
+    return true;
+}
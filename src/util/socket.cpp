@@ -0,0 +1,169 @@
+#include <util/socket.hpp>
+#include <cstring>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#define CloseSocket closesocket
+#define INVALID(handle) ((SOCKET)(handle) == INVALID_SOCKET)
+typedef int socklen_t;
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <unistd.h>
+#define CloseSocket close
+#define INVALID(handle) ((handle) < 0)
+#endif
+
+/* Don't raise SIGPIPE when a peer disconnects, the send just fails. */
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+/* Initializes the socket library, once (this is only needed on Windows). */
+static bool InitializeSockets()
+{
+    #ifdef _WIN32
+    static bool initialized = false;
+    if (!initialized)
+    {
+        WSADATA data;
+        initialized = (WSAStartup(MAKEWORD(2, 2), &data) == 0);
+    }
+    return initialized;
+    #else
+    return true;
+    #endif
+}
+
+/* Connects to a listening socket. */
+Socket* Socket::Connect(std::string host, uint16_t port)
+{
+    if (!InitializeSockets()) return nullptr;
+
+    /* Resolve the host. */
+    char service[8];
+    sprintf(service, "%u", (unsigned)port);
+    addrinfo hints, *addresses;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host.c_str(), service, &hints, &addresses) != 0) return nullptr;
+
+    /* Try each of its addresses in turn. */
+    Socket* socket = nullptr;
+    for (addrinfo* address = addresses; address && !socket; address = address->ai_next)
+    {
+        intptr_t handle = ::socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (INVALID(handle)) continue;
+
+        if (connect(handle, address->ai_addr, address->ai_addrlen) == 0) socket = new Socket(handle);
+        else CloseSocket(handle);
+    }
+
+    freeaddrinfo(addresses);
+    if (!socket) return nullptr;
+
+    /* Messages are small and answered right away, so don't delay them. */
+    int enable = 1;
+    setsockopt(socket->handle, IPPROTO_TCP, TCP_NODELAY, (const char*)&enable, sizeof(enable));
+    return socket;
+}
+
+/* Listens for connections on every interface. */
+Socket* Socket::Listen(uint16_t port)
+{
+    if (!InitializeSockets()) return nullptr;
+
+    intptr_t handle = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (INVALID(handle)) return nullptr;
+
+    /* Allow restarting the coordinator right away on the same port. */
+    int enable = 1;
+    setsockopt(handle, SOL_SOCKET, SO_REUSEADDR, (const char*)&enable, sizeof(enable));
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if ((bind(handle, (sockaddr*)&address, sizeof(address)) != 0) || (listen(handle, 16) != 0))
+    {
+        CloseSocket(handle);
+        return nullptr;
+    }
+
+    return new Socket(handle);
+}
+
+/* Waits for a connection on a listening socket. */
+Socket* Socket::Accept(int32_t timeout)
+{
+    /* Wait until a connection is pending. */
+    fd_set pending;
+    FD_ZERO(&pending);
+    FD_SET(handle, &pending);
+    timeval wait = {timeout / 1000, (timeout % 1000) * 1000};
+    if (select(handle + 1, &pending, nullptr, nullptr, &wait) <= 0) return nullptr;
+
+    intptr_t client = accept(handle, nullptr, nullptr);
+    if (INVALID(client)) return nullptr;
+
+    int enable = 1;
+    setsockopt(client, IPPROTO_TCP, TCP_NODELAY, (const char*)&enable, sizeof(enable));
+    return new Socket(client);
+}
+
+/* Sends some data, returning false if the connection was lost. */
+bool Socket::Send(const void* data, size_t size)
+{
+    const char* bytes = (const char*)data;
+    while (size > 0)
+    {
+        int sent = send(handle, bytes, size, SEND_FLAGS);
+        if (sent <= 0) return false;
+        bytes += sent;
+        size -= sent;
+    }
+
+    return true;
+}
+
+/* Receives exactly some amount of data, returning false if the connection was lost first. */
+bool Socket::Receive(void* data, size_t size)
+{
+    char* bytes = (char*)data;
+    while (size > 0)
+    {
+        int received = recv(handle, bytes, size, 0);
+        if (received <= 0) return false;
+        bytes += received;
+        size -= received;
+    }
+
+    return true;
+}
+
+/* Sets the longest time receiving waits for data. */
+void Socket::SetTimeout(int32_t timeout)
+{
+    #ifdef _WIN32
+    DWORD wait = timeout;
+    #else
+    timeval wait = {timeout / 1000, (timeout % 1000) * 1000};
+    #endif
+    setsockopt(handle, SOL_SOCKET, SO_RCVTIMEO, (const char*)&wait, sizeof(wait));
+}
+
+/* Closes the socket. */
+Socket::~Socket()
+{
+    CloseSocket(handle);
+}
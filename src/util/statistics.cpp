@@ -0,0 +1,134 @@
+#include <util/statistics.hpp>
+#include <cstdio>
+
+#ifdef STATISTICS
+/* These are the counters of the current thread. */
+thread_local RenderStatistics threadStatistics;
+#endif
+
+/* Adds another set of counters to these. */
+void RenderStatistics::operator+=(const RenderStatistics& other)
+{
+    paths += other.paths;
+    rays += other.rays;
+    nodeVisits += other.nodeVisits;
+    boxTests += other.boxTests;
+    primitiveTests += other.primitiveTests;
+    bounces += other.bounces;
+    rouletteTerminations += other.rouletteTerminations;
+    depthTerminations += other.depthTerminations;
+    for (int t = 0; t < PATH_LENGTHS; ++t) pathLengths[t] += other.pathLengths[t];
+}
+
+/* Returns whether statistics were compiled in. */
+bool StatisticsEnabled()
+{
+    #ifdef STATISTICS
+    return true;
+    #else
+    return false;
+    #endif
+}
+
+/* Takes the current thread's counters, and resets them to zero. */
+RenderStatistics CollectThreadStatistics()
+{
+    #ifdef STATISTICS
+    RenderStatistics counters = threadStatistics;
+    threadStatistics = RenderStatistics();
+    return counters;
+    #else
+    return RenderStatistics();
+    #endif
+}
+
+/* Divides two counters, returning zero if the denominator is zero. */
+static double Ratio(double numerator, double denominator)
+{
+    return (denominator > 0) ? numerator / denominator : 0.0;
+}
+
+/* Writes a statistics report in JSON format. */
+bool SaveStatistics(std::string path, const StatisticsReport& report)
+{
+    /* Create the destination file. */
+    FILE* file = fopen(path.c_str(), "w");
+    if (file == 0) return false;
+
+    /* Escape the scene path, as it may contain backslashes or quotes. */
+    std::string scene;
+    for (size_t t = 0; t < report.scene.size(); ++t)
+    {
+        if ((report.scene[t] == '\\') || (report.scene[t] == '"')) scene += '\\';
+        scene += report.scene[t];
+    }
+
+    const RenderStatistics& c = report.counters;
+    fprintf(file, "{\n");
+    fprintf(file, "  \"scene\": \"%s\",\n", scene.c_str());
+    fprintf(file, "  \"width\": %d,\n  \"height\": %d,\n  \"samples\": %d,\n",
+            report.width, report.height, report.samples);
+    fprintf(file, "  \"resolution\": %d,\n  \"wavelengths\": %d,\n", report.resolution, report.wavelengths);
+    fprintf(file, "  \"threads\": %u,\n  \"seconds\": %.6f,\n", (unsigned)report.threads, report.seconds);
+    fprintf(file, "  \"phases\": {\n");
+    fprintf(file, "    \"load\": %.6f,\n    \"bvh\": %.6f,\n", report.loadSeconds, report.buildSeconds);
+    fprintf(file, "    \"trace\": %.6f,\n    \"tonemap\": %.6f,\n", report.seconds, report.tonemapSeconds);
+    fprintf(file, "    \"write\": %.6f\n", report.writeSeconds);
+    fprintf(file, "  },\n");
+    fprintf(file, "  \"counters\": {\n");
+    fprintf(file, "    \"paths\": %llu,\n", (unsigned long long)c.paths);
+    fprintf(file, "    \"rays\": %llu,\n", (unsigned long long)c.rays);
+    fprintf(file, "    \"nodeVisits\": %llu,\n", (unsigned long long)c.nodeVisits);
+    fprintf(file, "    \"boxTests\": %llu,\n", (unsigned long long)c.boxTests);
+    fprintf(file, "    \"primitiveTests\": %llu,\n", (unsigned long long)c.primitiveTests);
+    fprintf(file, "    \"bounces\": %llu,\n", (unsigned long long)c.bounces);
+    fprintf(file, "    \"rouletteTerminations\": %llu,\n", (unsigned long long)c.rouletteTerminations);
+    fprintf(file, "    \"depthTerminations\": %llu\n", (unsigned long long)c.depthTerminations);
+    fprintf(file, "  },\n");
+
+    /* The path lengths are listed from zero bounces, the last one counting the longer paths too. */
+    fprintf(file, "  \"pathLengths\": [");
+    for (int t = 0; t < PATH_LENGTHS; ++t)
+        fprintf(file, "%s%llu", (t == 0) ? "" : ", ", (unsigned long long)c.pathLengths[t]);
+    fprintf(file, "],\n");
+    fprintf(file, "  \"raysPerSecond\": %.1f,\n", Ratio(c.rays, report.seconds));
+    fprintf(file, "  \"nodeVisitsPerRay\": %.4f,\n", Ratio(c.nodeVisits, c.rays));
+    fprintf(file, "  \"boxTestsPerRay\": %.4f,\n", Ratio(c.boxTests, c.rays));
+    fprintf(file, "  \"primitiveTestsPerRay\": %.4f,\n", Ratio(c.primitiveTests, c.rays));
+    fprintf(file, "  \"bouncesPerPath\": %.4f\n", Ratio(c.bounces, c.paths));
+    fprintf(file, "}\n");
+
+    /* Close the file. */
+    fclose(file);
+    return true;
+}
+
+/* Prints a short summary of a statistics report to the console. */
+void PrintStatistics(const StatisticsReport& report)
+{
+    const RenderStatistics& c = report.counters;
+    printf("[+] Render statistics:\n");
+    printf("    | %.3f Mrays/s (%llu rays in %.2fs).\n", Ratio(c.rays, report.seconds) * 1e-6,
+           (unsigned long long)c.rays, report.seconds);
+    printf("    | %.2f nodes, %.2f boxes and %.2f primitives tested per ray.\n",
+           Ratio(c.nodeVisits, c.rays), Ratio(c.boxTests, c.rays), Ratio(c.primitiveTests, c.rays));
+    printf("    | %.2f bounces per path, %.1f%% of paths ended by russian roulette.\n",
+           Ratio(c.bounces, c.paths), Ratio(c.rouletteTerminations, c.paths) * 100.0);
+    if (c.depthTerminations > 0)
+        printf("    | %.1f%% of paths cut short at the maximum depth.\n", Ratio(c.depthTerminations, c.paths) * 100.0);
+
+    /* The share of the paths ending after each number of bounces, leaving out the lengths no path had. */
+    uint64_t ended = 0;
+    for (int t = 0; t < PATH_LENGTHS; ++t) ended += c.pathLengths[t];
+    if (ended == 0) return;
+
+    const char* separator = "";
+    printf("    | Path lengths:");
+    for (int t = 0; t < PATH_LENGTHS; ++t) if (c.pathLengths[t] > 0)
+    {
+        printf("%s %d%s: %.1f%%", separator, t, (t == PATH_LENGTHS - 1) ? "+" : "",
+               Ratio(c.pathLengths[t], ended) * 100.0);
+        separator = ",";
+    }
+    printf(".\n");
+}
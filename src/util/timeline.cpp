@@ -0,0 +1,131 @@
+#include <util/timeline.hpp>
+#include <chrono>
+#include <cstdio>
+
+/* Whether the timeline is recording. */
+std::atomic<bool> timelineEnabled(false);
+
+/* This is an event on a thread's timeline. */
+struct TimelineEvent
+{
+    /* The name of the event. */
+    const char* name;
+    /* The start and end time of the event, in nanoseconds. */
+    int64_t start, end;
+    /* The index attached to the event, if any. */
+    int32_t index;
+};
+
+/* This is a thread's ring buffer of events. Only the thread itself writes to it, and it is read once recording is
+ * over, so the only synchronization needed is to publish the number of events written. */
+struct TimelineBuffer
+{
+    /* The events, of which the last TIMELINE_CAPACITY written are kept. */
+    TimelineEvent events[TIMELINE_CAPACITY];
+    /* The number of events written since the timeline was started. */
+    std::atomic<uint64_t> written;
+    /* The first event written after the timeline was last started. */
+    uint64_t first;
+    /* The index of the thread, in the order threads recorded their first event. */
+    uint32_t thread;
+    /* The next buffer in the list of all threads' buffers. */
+    TimelineBuffer* next;
+};
+
+/* This is the list of all threads' buffers, which is only ever pushed to (the buffers live until the program exits,
+ * since threads such as the OpenMP workers outlive renders). */
+static std::atomic<TimelineBuffer*> timelineBuffers(nullptr);
+static std::atomic<uint32_t> timelineThreads(0);
+
+/* This is the current thread's buffer, created on its first event. */
+static thread_local TimelineBuffer* threadBuffer = nullptr;
+
+/* Times are measured from when the timeline was started. */
+static std::chrono::steady_clock::time_point timelineEpoch = std::chrono::steady_clock::now();
+
+/* Returns the current time of the timeline, in nanoseconds. */
+int64_t TimelineClock()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()
+                                                                - timelineEpoch).count();
+}
+
+/* Creates the current thread's buffer, and adds it to the list without locking. */
+static TimelineBuffer* RegisterThread()
+{
+    TimelineBuffer* buffer = new TimelineBuffer();
+    buffer->written.store(0, std::memory_order_relaxed);
+    buffer->first = 0;
+    buffer->thread = timelineThreads.fetch_add(1);
+    buffer->next = timelineBuffers.load();
+    while (!timelineBuffers.compare_exchange_weak(buffer->next, buffer)) { }
+    return threadBuffer = buffer;
+}
+
+/* Records an event on the current thread's timeline. */
+void RecordTimelineEvent(const char* name, int64_t start, int64_t end, int32_t index)
+{
+    TimelineBuffer* buffer = threadBuffer ? threadBuffer : RegisterThread();
+
+    /* Write the event, overwriting the oldest one if the buffer is full, and then publish it. */
+    uint64_t written = buffer->written.load(std::memory_order_relaxed);
+    TimelineEvent& event = buffer->events[written % TIMELINE_CAPACITY];
+    event.name = name;
+    event.start = start;
+    event.end = end;
+    event.index = index;
+    buffer->written.store(written + 1, std::memory_order_release);
+}
+
+/* Starts recording the timeline, discarding any previously recorded events. */
+void StartTimeline()
+{
+    timelineEnabled.store(false);
+    for (TimelineBuffer* buffer = timelineBuffers.load(); buffer; buffer = buffer->next)
+        buffer->first = buffer->written.load(std::memory_order_acquire);
+
+    timelineEpoch = std::chrono::steady_clock::now();
+    timelineEnabled.store(true);
+}
+
+/* Stops recording the timeline, and saves it in the Chrome trace event format. */
+bool SaveTimeline(std::string path)
+{
+    timelineEnabled.store(false);
+
+    /* Create the destination file. */
+    FILE* file = fopen(path.c_str(), "w");
+    if (file == 0) return false;
+
+    /* Name the process and the threads, the first thread being the one which started rendering. */
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    fprintf(file, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"Lambda\"}}");
+    for (TimelineBuffer* buffer = timelineBuffers.load(); buffer; buffer = buffer->next)
+        fprintf(file, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, "
+                      "\"args\": {\"name\": \"Thread %u\"}}", buffer->thread, buffer->thread);
+
+    /* Write every thread's events, as complete events with times in microseconds. Only the most recent events are
+     * left if a buffer overflowed. */
+    for (TimelineBuffer* buffer = timelineBuffers.load(); buffer; buffer = buffer->next)
+    {
+        uint64_t written = buffer->written.load(std::memory_order_acquire);
+        uint64_t first = buffer->first;
+        if (written - first > TIMELINE_CAPACITY) first = written - TIMELINE_CAPACITY;
+
+        for (uint64_t t = first; t < written; ++t)
+        {
+            const TimelineEvent& event = buffer->events[t % TIMELINE_CAPACITY];
+            fprintf(file, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f",
+                    event.name, buffer->thread, event.start * 1e-3, (event.end - event.start) * 1e-3);
+            if (event.index >= 0) fprintf(file, ", \"args\": {\"index\": %d}", event.index);
+            fprintf(file, "}");
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+
+    /* Close the file. */
+    bool success = !ferror(file);
+    fclose(file);
+    return success;
+}
@@ -0,0 +1,86 @@
+/* This merges accumulation buffers rendered over different sample ranges of the same scene (with the --range and
+ * --format accumulation options), possibly on different machines, into a single render. The sums and sample counts
+ * are added up, and only then averaged and tonemapped, so the result is the same as rendering all the samples at
+ * once. The merged buffer can also be saved, to be merged again with more samples later. */
+
+#include <renderer/postprocess.hpp>
+#include <util/accumulation.hpp>
+#include <util/imageio.hpp>
+#include <iostream>
+#include <cstring>
+
+using namespace std;
+
+int main(int argc, char* argv[])
+{
+    /* Read the options, and the buffers to merge. */
+    string output, linear, accumulation;
+    vector<string> inputs;
+    for (int t = 1; t < argc; ++t)
+    {
+        if (!strcmp(argv[t], "--linear") && (t + 1 < argc)) linear = argv[++t]; else
+        if (!strcmp(argv[t], "--accumulation") && (t + 1 < argc)) accumulation = argv[++t]; else
+        if (output.empty()) output = argv[t]; else inputs.push_back(argv[t]);
+    }
+
+    if (inputs.empty())
+    {
+        cout << "Usage: LambdaMerge <output> <buffer> [buffer...] [--linear <file>] [--accumulation <file>]" << endl;
+        return 1;
+    }
+
+    /* Add up every buffer. */
+    cout << "[+] Merging " << inputs.size() << " accumulation buffer(s)..." << endl;
+    AccumulationBuffer merged, buffer;
+    for (size_t t = 0; t < inputs.size(); ++t)
+    {
+        if (!LoadAccumulation(inputs[t], (t == 0) ? &merged : &buffer))
+        {
+            cout << "[!] Failed to load the accumulation buffer <" << inputs[t] << ">." << endl;
+            return 1;
+        }
+
+        if ((t > 0) && !MergeAccumulation(&merged, buffer))
+        {
+            cout << "[!] The accumulation buffer <" << inputs[t] << "> is not of the same render." << endl;
+            return 1;
+        }
+    }
+
+    /* Report the range of sample counts, which is the same everywhere unless parts of the render were skipped. */
+    uint32_t fewest = merged.counts[0], most = merged.counts[0];
+    for (size_t t = 0; t < merged.counts.size(); ++t)
+    {
+        fewest = min(fewest, merged.counts[t]);
+        most = max(most, merged.counts[t]);
+    }
+
+    cout << "    | " << merged.width << "×" << merged.height << "." << endl;
+    if (fewest == most) cout << "    | " << most << " spp." << endl;
+    else cout << "    | " << fewest << " to " << most << " spp." << endl;
+
+    /* Save the merged buffer, if requested. */
+    if (!accumulation.empty() && !SaveAccumulation(accumulation, merged))
+        cout << "[!] Failed to save the merged accumulation buffer in <" << accumulation << ">." << endl;
+
+    /* Average the samples, and save the linear render if requested. */
+    size_t count = merged.sums.size();
+    vector<Vector> pixels(count);
+    ResolveAccumulation(merged, &pixels[0]);
+    if (!linear.empty() && !SavePFM(linear, &pixels[0], merged.width, merged.height))
+        cout << "[!] Failed to save the linear render in <" << linear << ">." << endl;
+
+    /* Tonemap, gamma-correct and save the render. */
+    TonemapPixels(&pixels[0], count, merged.colorSystem);
+    GammaCorrectPixels(&pixels[0], count, merged.colorSystem);
+    if (!SavePPM(output, &pixels[0], merged.width, merged.height, "Generated by Lambda."))
+    {
+        cout << "[!] Failed to save the merged render in <" << output << ">." << endl;
+        return 1;
+    }
+
+    cout << endl << "[+] Merged render saved in <" << output << ">." << endl;
+    if (!accumulation.empty()) cout << "    | Merged accumulation buffer saved in <" << accumulation << ">." << endl;
+    if (!linear.empty()) cout << "    | Linear render saved in <" << linear << ">." << endl;
+    return 0;
+}